@@ -0,0 +1,425 @@
+/**
+ * @file    driver_bench.c
+ * @author  Jie Liu
+ * @version V1.0
+ * @date    2026-10-18
+ * @brief Micro-benchmarks of the compute paths of the drivers
+ * @note Runs NMEA checksum and field parsing, the MLX90632 compensation, the
+ * LIS2DW12 conversions, an LSM6DSL read on the simulated shield (sim.h),
+ * sample_decode() and sample_format() over generated inputs, and reports the best of
+ * BENCH_RUNS runs as ns/op, heap allocations per op and input throughput.
+ * The LSM has no raw-to-physical conversion, only the byte assembly in
+ * lsm_single_measure(), so that case times the driver with the SPI model
+ * and no bus time. Allocations are counted by interposing the glibc
+ * allocator.
+ *
+ * Results go to stdout and, with a file given, are appended to it as CSV
+ * with a label (e.g. the git revision), so runs of two versions can be
+ * compared line by line. Build and run from the drivers directory:
+ *
+ *     gcc -O2 -Iinc bench/driver_bench.c src/gnss.c src/lis2.c src/lsm.c \
+ *         src/mlx.c src/sample.c src/common.c src/regcache.c src/timestamp.c \
+ *         src/bus.c src/sim.c src/sim_models.c -lm -pthread -o driver_bench
+ *     ./driver_bench bench.csv $(git describe --always --dirty)
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "common.h"
+#include "error.h"
+#include "gnss.h"
+#include "lis2.h"
+#include "lsm.h"
+#include "mlx.h"
+#include "sample.h"
+#include "sensor.h"
+#include "bus.h"
+#include "sim.h"
+#include "timestamp.h"
+
+/** generated inputs per case, cycled through */
+#define BENCH_INPUTS 4096
+/** operations per run */
+#define BENCH_OPS 200000
+/** operations per run over the simulated bus */
+#define BENCH_BUS_OPS 20000
+/** runs, the best one is reported */
+#define BENCH_RUNS 5
+
+/*
+ * heap allocations, counted by wrapping the glibc allocator
+ */
+
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t n, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+
+static uint64_t allocations;
+
+void* malloc(size_t size) {
+    ++allocations;
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t n, size_t size) {
+    ++allocations;
+    return __libc_calloc(n, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+    ++allocations;
+    return __libc_realloc(ptr, size);
+}
+
+/*
+ * registry, sample.c looks the drivers up here instead of in sensor.c
+ */
+
+static struct mlx mlx;
+
+static struct sensor sensors[SENSOR_COUNT] = {
+    [SENSOR_LIS2] = { .id = SENSOR_LIS2, .driver = &lis2_driver },
+    [SENSOR_MLX] = { .id = SENSOR_MLX, .driver = &mlx_driver, .ctx = &mlx },
+};
+
+struct sensor* sensor_get(enum sensor_id id) {
+    return id < SENSOR_COUNT && sensors[id].driver ? &sensors[id] : NULL;
+}
+
+int sensor_decode(const struct sensor* sensor, const struct sensor_raw* raw,
+                  int32_t values[SENSOR_MAX_VALUES]) {
+    return sensor->driver->decode(sensor, raw, values);
+}
+
+/** calibration of the Melexis reference example */
+static const struct mlx_calib calib = {
+    .P_R = 0x00587f5b, .P_G = 0x04a10289, .P_T = 0xfff966f8, .P_O = 0x00001e0f,
+    .Ea = 4859535, .Eb = 5686508, .Fa = 53855361, .Fb = 42874149, .Ga = -14556410,
+    .Gb = 9728, .Ka = 10752, .Ha = 16384, .Hb = 0,
+};
+
+/*
+ * inputs
+ */
+
+static char nmea[BENCH_INPUTS][MESSAGE_SIZE];
+static size_t nmea_len[BENCH_INPUTS];
+static struct sensor_raw lis2_raw[BENCH_INPUTS];
+static struct sensor_raw mlx_raw[BENCH_INPUTS];
+static struct sample_record lis2_record[BENCH_INPUTS];
+static struct sample_record mlx_record[BENCH_INPUTS];
+static int lsm_bus = -1;
+
+static volatile double sink;
+
+/** RMC and GGA alternating, positions around the globe, valid checksums */
+static void bench_nmea_generate(void) {
+
+    for (int i = 0; i < BENCH_INPUTS; ++i) {
+        int hh = rand() % 24, mm = rand() % 60, ss = rand() % 60;
+        double lat = rand() % 90 * 100 + rand() % 60000 / 1000.0;
+        double lon = rand() % 180 * 100 + rand() % 60000 / 1000.0;
+        char ns = rand() % 2 ? 'N' : 'S';
+        char ew = rand() % 2 ? 'E' : 'W';
+        int len;
+
+        if (i % 2)
+            len = snprintf(nmea[i], MESSAGE_SIZE,
+                           "$GPRMC,%02d%02d%02d.00,A,%09.4f,%c,%010.4f,%c,%.1f,%.1f,%02d%02d%02d,,,A",
+                           hh, mm, ss, lat, ns, lon, ew, rand() % 500 / 10.0,
+                           rand() % 3600 / 10.0, 1 + rand() % 28, 1 + rand() % 12, rand() % 100);
+        else
+            len = snprintf(nmea[i], MESSAGE_SIZE,
+                           "$GPGGA,%02d%02d%02d.00,%09.4f,%c,%010.4f,%c,1,%02d,%.1f,%.1f,M,%.1f,M,,",
+                           hh, mm, ss, lat, ns, lon, ew, 4 + rand() % 9,
+                           rand() % 30 / 10.0 + 0.6, rand() % 20000 / 10.0, rand() % 900 / 10.0);
+        snprintf(nmea[i] + len, MESSAGE_SIZE - len, "*%02X\r\n", nmea_checksum(nmea[i]));
+        nmea_len[i] = strlen(nmea[i]);
+    }
+}
+
+/** accelerations within +-2 g, MLX raw values of -10 to ~100 °C objects */
+static void bench_raw_generate(void) {
+
+    struct mlx_raw raw;
+    uint8_t n;
+
+    for (int i = 0; i < BENCH_INPUTS; ++i) {
+        for (int b = 0; b < LIS2DW12_SAMPLE_SIZE; b += 2) {
+            // 14-bit left aligned, as the FIFO returns them
+            int16_t counts = (rand() % 16384 - 8192) * 4;
+
+            lis2_raw[i].data[b] = counts & 0xFF;
+            lis2_raw[i].data[b + 1] = (uint16_t)counts >> 8;
+        }
+        // streaming at 100 Hz
+        memcpy(&lis2_raw[i].data[LIS2DW12_SAMPLE_SIZE], &(uint32_t){ 100000 }, sizeof(uint32_t));
+        lis2_raw[i].len = LIS2DW12_SAMPLE_SIZE + sizeof(uint32_t);
+        lis2_raw[i].records = 1;
+
+        raw.ambient_new = 22000 + rand() % 1000;
+        raw.ambient_old = 23000 + rand() % 100;
+        raw.object_new = 200 + rand() % 3000;
+        raw.object_old = raw.object_new + rand() % 20;
+        memcpy(mlx_raw[i].data, &raw, sizeof(raw));
+        mlx_raw[i].len = sizeof(raw);
+        mlx_raw[i].records = 1;
+
+        sample_decode(&sensors[SENSOR_LIS2], &lis2_raw[i], &lis2_record[i], &n);
+        sample_decode(&sensors[SENSOR_MLX], &mlx_raw[i], &mlx_record[i], &n);
+    }
+}
+
+/*
+ * cases, each returns the input bytes it went through
+ */
+
+static size_t bench_nmea_checksum(size_t ops) {
+
+    size_t bytes = 0;
+    uint8_t checksum = 0;
+
+    for (size_t i = 0; i < ops; ++i) {
+        checksum ^= nmea_checksum(nmea[i % BENCH_INPUTS]);
+        bytes += nmea_len[i % BENCH_INPUTS];
+    }
+    sink += checksum;
+    return bytes;
+}
+
+static size_t bench_nmea_parse_fields(size_t ops) {
+
+    static char fields[NMEA_MAX_FIELDS][NMEA_FIELD_BUFFER];
+    size_t bytes = 0;
+    uint8_t number_of_fields;
+    uint8_t checksum;
+
+    for (size_t i = 0; i < ops; ++i) {
+        if (nmea_parse_fields(nmea[i % BENCH_INPUTS], fields, &number_of_fields, &checksum)
+                == EXIT_SUCCESS)
+            bytes += nmea_len[i % BENCH_INPUTS];
+        sink += checksum;
+    }
+    return bytes;
+}
+
+static size_t bench_mlx_calc_temp_object(size_t ops) {
+
+    struct mlx_raw raw;
+    double ambient, object, sum = 0;
+
+    for (size_t i = 0; i < ops; ++i) {
+        memcpy(&raw, mlx_raw[i % BENCH_INPUTS].data, sizeof(raw));
+        ambient = mlx_preprocess_temp_ambient(raw.ambient_new, raw.ambient_old, calib.Gb);
+        object = mlx_preprocess_temp_object(raw.object_new, raw.object_old,
+                raw.ambient_new, raw.ambient_old, calib.Ka);
+        sum += mlx_calc_temp_object(object, ambient, calib.Ea, calib.Eb, calib.Ga,
+                calib.Fa, calib.Fb, calib.Ha, calib.Hb);
+    }
+    sink += sum;
+    return ops * sizeof(raw);
+}
+
+static size_t bench_decode(enum sensor_id id, const struct sensor_raw* raw, size_t ops) {
+
+    struct sample_record records[SAMPLE_MAX_RECORDS];
+    uint8_t n;
+    size_t bytes = 0;
+    int64_t sum = 0;
+
+    for (size_t i = 0; i < ops; ++i) {
+        sample_decode(&sensors[id], &raw[i % BENCH_INPUTS], records, &n);
+        sum += records[0].value[0];
+        bytes += raw[i % BENCH_INPUTS].len;
+    }
+    sink += sum;
+    return bytes;
+}
+
+static size_t bench_sample_decode_mlx(size_t ops) {
+    return bench_decode(SENSOR_MLX, mlx_raw, ops);
+}
+
+static size_t bench_lis2_decode(size_t ops) {
+
+    struct lis2_sample sample;
+    double sum = 0;
+
+    for (size_t i = 0; i < ops; ++i) {
+        lis2_decode(lis2_raw[i % BENCH_INPUTS].data, &sample);
+        sum += sample.x + sample.y + sample.z;
+    }
+    sink += sum;
+    return ops * LIS2DW12_SAMPLE_SIZE;
+}
+
+static size_t bench_sample_decode_lis2(size_t ops) {
+    return bench_decode(SENSOR_LIS2, lis2_raw, ops);
+}
+
+static size_t bench_lsm_single_measure(size_t ops) {
+
+    uint16_t angular[3];
+    uint16_t linear[3];
+    uint64_t sum = 0;
+
+    for (size_t i = 0; i < ops; ++i) {
+        lsm_single_measure(&lsm_bus, angular, linear);
+        sum += angular[0] + linear[2];
+    }
+    sink += sum;
+    return ops * 12;
+}
+
+static size_t bench_format(const struct sample_record* records, size_t ops) {
+
+    char str[SENSOR_STRING_SIZE];
+    size_t bytes = 0;
+
+    for (size_t i = 0; i < ops; ++i) {
+        sample_format(&records[i % BENCH_INPUTS], str, sizeof(str));
+        bytes += sizeof(records[0]);
+    }
+    sink += str[0];
+    return bytes;
+}
+
+static size_t bench_sample_format_lis2(size_t ops) {
+    return bench_format(lis2_record, ops);
+}
+
+static size_t bench_sample_format_mlx(size_t ops) {
+    return bench_format(mlx_record, ops);
+}
+
+/**
+ * @struct bench_case
+ * @brief one benchmark
+ * @var name name in the results
+ * @var ops operations per run
+ * @var run the benchmark, returns the input bytes
+ */
+struct bench_case {
+    const char* name;
+    size_t ops;
+    size_t (*run)(size_t ops);
+};
+
+static const struct bench_case cases[] = {
+    { "nmea_checksum", BENCH_OPS, bench_nmea_checksum },
+    { "nmea_parse_fields", BENCH_OPS, bench_nmea_parse_fields },
+    { "mlx_calc_temp_object", BENCH_OPS, bench_mlx_calc_temp_object },
+    { "sample_decode_mlx", BENCH_OPS, bench_sample_decode_mlx },
+    { "lis2_decode", BENCH_OPS, bench_lis2_decode },
+    { "sample_decode_lis2", BENCH_OPS, bench_sample_decode_lis2 },
+    { "lsm_single_measure_sim", BENCH_BUS_OPS, bench_lsm_single_measure },
+    { "sample_format_lis2", BENCH_OPS, bench_sample_format_lis2 },
+    { "sample_format_mlx", BENCH_OPS, bench_sample_format_mlx },
+};
+
+/**
+ * @struct bench_result
+ * @brief best run of a case
+ * @var ns_per_op time per operation [ns]
+ * @var allocs_per_op heap allocations per operation
+ * @var mb_per_s input throughput [MB/s]
+ */
+struct bench_result {
+    double ns_per_op;
+    double allocs_per_op;
+    double mb_per_s;
+};
+
+static void bench_run(const struct bench_case* c, struct bench_result* result) {
+
+    uint64_t start, elapsed, best = UINT64_MAX;
+    uint64_t allocs = 0;
+    size_t bytes = 0;
+
+    c->run(c->ops / 10); // warm up caches and branch predictors
+    for (int run = 0; run < BENCH_RUNS; ++run) {
+        allocations = 0;
+        start = timestamp_ns();
+        bytes = c->run(c->ops);
+        elapsed = timestamp_ns() - start;
+        if (elapsed < best) {
+            best = elapsed;
+            allocs = allocations;
+        }
+    }
+
+    result->ns_per_op = (double)best / c->ops;
+    result->allocs_per_op = (double)allocs / c->ops;
+    result->mb_per_s = best ? bytes * 1e3 / best : 0;
+}
+
+static int bench_lsm_open(void) {
+
+    int ret;
+
+    sim_init(NULL);
+    ret = sim_add(SIM_LSM, 0, 0);
+    if (ret != EXIT_SUCCESS)
+        return ret;
+    bus_set_backend(&sim_backend);
+
+    ret = lsm_init(&lsm_bus, "/dev/spidev0.0");
+    if (ret != EXIT_SUCCESS)
+        return ret;
+
+    // both cores running, so the output registers carry samples
+    return lsm_activate_acc_gyro(lsm_bus);
+}
+
+int main(int argc, char* argv[]) {
+
+    struct bench_result results[ARRAY_SIZE(cases)];
+    const char* label = argc > 2 ? argv[2] : "-";
+    FILE* csv = NULL;
+    time_t now = time(NULL);
+    size_t i;
+
+    if (argc > 1 && !(csv = fopen(argv[1], "a"))) {
+        print_errno("cannot open the results file");
+        return EXIT_FAILURE;
+    }
+
+    srand(1);
+    mlx.calib = calib;
+    mlx_calc_terms(&calib, &mlx.terms);
+    pthread_mutex_init(&mlx.lock, NULL);
+    bench_nmea_generate();
+    bench_raw_generate();
+    if (bench_lsm_open() != EXIT_SUCCESS) {
+        print_error(ERROR_UNDEFINED_STATE, "simulated LSM did not come up");
+        return EXIT_FAILURE;
+    }
+
+    printf("%-24s %12s %10s %12s\n", "benchmark", "ns/op", "allocs/op", "MB/s");
+    for (i = 0; i < ARRAY_SIZE(cases); ++i) {
+        bench_run(&cases[i], &results[i]);
+        printf("%-24s %12.1f %10.2f %12.1f\n", cases[i].name,
+               results[i].ns_per_op, results[i].allocs_per_op, results[i].mb_per_s);
+    }
+
+    if (csv) {
+        if (ftell(csv) == 0)
+            fprintf(csv, "time,label,benchmark,ops,ns_per_op,allocs_per_op,mb_per_s\n");
+        for (i = 0; i < ARRAY_SIZE(cases); ++i)
+            fprintf(csv, "%lld,%s,%s,%zu,%.2f,%.3f,%.2f\n", (long long)now, label,
+                    cases[i].name, cases[i].ops, results[i].ns_per_op,
+                    results[i].allocs_per_op, results[i].mb_per_s);
+        fclose(csv);
+    }
+
+    bus_close(lsm_bus);
+    sim_close();
+
+    return sink != sink; // NaN guard keeps the results alive
+}
+
+// vim: expandtab ts=4 sw=4
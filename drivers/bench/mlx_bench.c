@@ -0,0 +1,125 @@
+/**
+ * @file    mlx_bench.c
+ * @author  Jie Liu
+ * @version V1.0
+ * @date    2026-10-18
+ * @brief Micro-benchmark of the MLX90632 temperature compensation
+ * @note Compares mlx_calc_temp_object (double, 5 iterations) with the
+ * single precision mlx_compensate and mlx_compensate_batch, on synthetic
+ * raw values. The reference divides the raw ambient by MLX_REF_3 in single
+ * precision before truncating, so near a truncation boundary it can land one
+ * LSB (~0.014 °C) away from the fast paths; the mean error shows how rare
+ * that is. Build from the drivers directory:
+ *
+ *     gcc -O3 -fno-math-errno -Iinc bench/mlx_bench.c src/mlx.c -lm -pthread -o mlx_bench
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#include "mlx.h"
+
+/** measurements per run */
+#define BENCH_SAMPLES 200000
+/** runs, the best one is reported */
+#define BENCH_RUNS 5
+
+/* the benchmark never touches the bus */
+int8_t i2c_slave_read_16bit(const i2c_slave *slave, uint16_t reg_addr, uint16_t *reg_data,
+                            uint16_t len) {
+    (void)slave; (void)reg_addr; (void)reg_data; (void)len;
+    return 1;
+}
+int8_t i2c_slave_write_16bit(const i2c_slave *slave, uint16_t reg_addr, uint16_t reg_data) {
+    (void)slave; (void)reg_addr; (void)reg_data;
+    return 1;
+}
+
+/** calibration of the Melexis reference example */
+static const struct mlx_calib calib = {
+    .P_R = 0x00587f5b, .P_G = 0x04a10289, .P_T = 0xfff966f8, .P_O = 0x00001e0f,
+    .Ea = 4859535, .Eb = 5686508, .Fa = 53855361, .Fb = 42874149, .Ga = -14556410,
+    .Gb = 9728, .Ka = 10752, .Ha = 16384, .Hb = 0,
+};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static double reference(const struct mlx_raw* raw) {
+    double ambient = mlx_preprocess_temp_ambient(raw->ambient_new, raw->ambient_old, calib.Gb);
+    double object = mlx_preprocess_temp_object(raw->object_new, raw->object_old,
+            raw->ambient_new, raw->ambient_old, calib.Ka);
+
+    return mlx_calc_temp_object(object, ambient, calib.Ea, calib.Eb, calib.Ga,
+            calib.Fa, calib.Fb, calib.Ha, calib.Hb);
+}
+
+int main(void) {
+
+    static struct mlx_raw raw[BENCH_SAMPLES];
+    static double ref[BENCH_SAMPLES];
+    static float fast[BENCH_SAMPLES];
+    static float batch[BENCH_SAMPLES];
+    struct mlx_terms terms;
+    uint64_t start, best_ref = UINT64_MAX, best_fast = UINT64_MAX, best_batch = UINT64_MAX;
+    double err_fast = 0, err_batch = 0, sum_fast = 0, sum_batch = 0;
+    volatile double sink = 0;
+    int run;
+    int i;
+
+    // ambient around room temperature, objects from below zero to ~100 °C
+    srand(1);
+    for (i = 0; i < BENCH_SAMPLES; ++i) {
+        raw[i].ambient_new = 22000 + rand() % 1000;
+        raw[i].ambient_old = 23000 + rand() % 100;
+        raw[i].object_new = 200 + rand() % 3000;
+        raw[i].object_old = raw[i].object_new + rand() % 20;
+    }
+
+    mlx_calc_terms(&calib, &terms);
+
+    for (run = 0; run < BENCH_RUNS; ++run) {
+        start = now_ns();
+        for (i = 0; i < BENCH_SAMPLES; ++i)
+            ref[i] = reference(&raw[i]);
+        if (now_ns() - start < best_ref)
+            best_ref = now_ns() - start;
+
+        start = now_ns();
+        for (i = 0; i < BENCH_SAMPLES; ++i)
+            fast[i] = mlx_compensate(&terms, &raw[i]);
+        if (now_ns() - start < best_fast)
+            best_fast = now_ns() - start;
+
+        start = now_ns();
+        mlx_compensate_batch(&terms, raw, batch, BENCH_SAMPLES);
+        if (now_ns() - start < best_batch)
+            best_batch = now_ns() - start;
+
+        sink += ref[run] + fast[run] + batch[run];
+    }
+
+    for (i = 0; i < BENCH_SAMPLES; ++i) {
+        err_fast = fmax(err_fast, fabs(fast[i] - ref[i]));
+        err_batch = fmax(err_batch, fabs(batch[i] - ref[i]));
+        sum_fast += fabs(fast[i] - ref[i]);
+        sum_batch += fabs(batch[i] - ref[i]);
+    }
+
+    printf("samples %d, e.g. %.3f °C\n", BENCH_SAMPLES, ref[0]);
+    printf("%-10s %8.1f ns/sample\n", "reference", (double)best_ref / BENCH_SAMPLES);
+    printf("%-10s %8.1f ns/sample  error max %.4f mean %.5f °C\n", "fast",
+           (double)best_fast / BENCH_SAMPLES, err_fast, sum_fast / BENCH_SAMPLES);
+    printf("%-10s %8.1f ns/sample  error max %.4f mean %.5f °C\n", "batch",
+           (double)best_batch / BENCH_SAMPLES, err_batch, sum_batch / BENCH_SAMPLES);
+
+    return sink != sink; // NaN guard keeps the results alive
+}
+
+// vim: expandtab ts=4 sw=4
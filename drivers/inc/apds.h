@@ -11,9 +11,15 @@
 #define APDS_H
 
 #include <stdlib.h>
+#include <stdint.h>
+
+#include "sensor.h"
 
 #define APDS_MAIN_CTRL 0x00 // addresses refering to iol/datasheets/APDS-9151.pdf
 #define APDS_LS_MEAS_RATE 0x04
+#define APDS_LS_GAIN 0x05
+#define APDS_PART_ID 0x06
+#define APDS_MAIN_STATUS 0x07
 #define APDS_LS_DATA_IR_0 0x0A
 #define APDS_LS_DATA_IR_1 0x0B
 #define APDS_LS_DATA_IR_2 0x0C
@@ -26,22 +32,154 @@
 #define APDS_LS_DATA_RED_0 0x13
 #define APDS_LS_DATA_RED_1 0x14
 #define APDS_LS_DATA_RED_2 0x15
+#define APDS_INT_CFG 0x19
+#define APDS_LS_THRES_VAR 0x27
+
+///PART_ID: part number in the upper nibble, revision in the lower one
+#define APDS_PART_ID_DEF 0xC0
+#define APDS_PART_ID_MASK 0xF0
+
+///MAIN_STATUS: new light sensor data available, cleared on read
+#define APDS_LS_DATA_STATUS 0x08
+///MAIN_STATUS: light sensor interrupt condition met, cleared on read
+#define APDS_LS_INT_STATUS 0x10
+
+///INT_CFG: green channel as interrupt source, variance mode, interrupt enabled
+#define APDS_INT_CFG_GREEN_VARIANCE 0x1C
+
+///bytes from APDS_LS_DATA_IR_0 up to APDS_LS_DATA_RED_2
+#define APDS_LS_DATA_SIZE 12
+
+/** ADC resolution, LS_MEAS_RATE[6:4]; higher resolution converts longer */
+enum apds_resolution {
+    APDS_RES_20BIT = 0, /// 400 ms conversion
+    APDS_RES_19BIT,     /// 200 ms conversion
+    APDS_RES_18BIT,     /// 100 ms conversion
+    APDS_RES_17BIT,     /// 50 ms conversion
+    APDS_RES_16BIT,     /// 25 ms conversion
+    APDS_RES_13BIT      /// 3.125 ms conversion
+};
+
+/** measurement repetition rate, LS_MEAS_RATE[2:0] */
+enum apds_rate {
+    APDS_RATE_25MS = 0,
+    APDS_RATE_50MS,
+    APDS_RATE_100MS,
+    APDS_RATE_200MS,
+    APDS_RATE_500MS,
+    APDS_RATE_1000MS,
+    APDS_RATE_2000MS
+};
+
+/** analog gain, LS_GAIN[2:0] */
+enum apds_gain {
+    APDS_GAIN_1X = 0,
+    APDS_GAIN_3X,
+    APDS_GAIN_6X,
+    APDS_GAIN_9X,
+    APDS_GAIN_18X
+};
+
+/**
+ * @struct apds_profile
+ * @brief trade between conversion time and precision
+ * @note when the rate is shorter than the conversion time, the sensor
+ * repeats at the conversion time
+ */
+struct apds_profile {
+    enum apds_resolution resolution;
+    enum apds_rate rate;
+    enum apds_gain gain;
+};
+
+/**
+ * @defgroup apds_profiles predefined profiles
+ * @{
+ */
+///fast tracking: 13 bit every 25 ms
+#define APDS_PROFILE_FAST ((struct apds_profile){ APDS_RES_13BIT, APDS_RATE_25MS, APDS_GAIN_3X })
+///power-on default: 18 bit every 100 ms
+#define APDS_PROFILE_DEFAULT ((struct apds_profile){ APDS_RES_18BIT, APDS_RATE_100MS, APDS_GAIN_3X })
+///accuracy: 20 bit (400 ms conversion) every 500 ms
+#define APDS_PROFILE_ACCURATE ((struct apds_profile){ APDS_RES_20BIT, APDS_RATE_500MS, APDS_GAIN_3X })
+///@}
+
+/** registry descriptor: infrared, green, blue, red */
+extern const struct sensor_driver apds_driver;
 
 /**
 * @brief  initialize the APDS sensor
-* @details Register APDS_MAIN_CTRL and APDS_LS_MEAS_RATE are activated
+* @details Register APDS_MAIN_CTRL is activated and APDS_PROFILE_DEFAULT is set
+* @return error code
+*/
+int apds_init(uint8_t dev);
+
+/**
+* @brief  select resolution, rate and gain
+* @param[in] dev device file
+* @param[in] profile profile to set
+* @return error code
+*/
+int apds_set_profile(uint8_t dev, const struct apds_profile* profile);
+
+/**
+* @brief  time between two new results of a profile
+* @param[in] profile profile to evaluate
+* @return period [us]
+*/
+uint32_t apds_profile_period_us(const struct apds_profile* profile);
+
+/**
+* @brief  only report data when green changed by more than a variance
+* @details uses the variance interrupt; the INT pin and APDS_LS_INT_STATUS
+*          then flag changed data, instead of APDS_LS_DATA_STATUS flagging
+*          every conversion
+* @param[in] dev device file
+* @param[in] variance LS_THRES_VAR code, change of 8 << variance counts; 0xFF disables
+* @return error code
 */
-void apds_init(uint8_t dev);
+int apds_set_variance_gate(uint8_t dev, uint8_t variance);
 
 /**
 * @brief  get measurement values
-* @details data in APDS_LS_DATA_IR_0,1,2; APDS_LS_DATA_GREEN_0,1,2; APDS_LS_DATA_BLUE_0,1,2; APDS_LS_DATA_RED_0,1,2; values are read like address structure IR-G-B-R 
+* @details MAIN_STATUS is checked first, the data registers are only read
+*          when a new (or, with the variance gate, a changed) result is
+*          available; data in APDS_LS_DATA_IR_0,1,2; APDS_LS_DATA_GREEN_0,1,2;
+*          APDS_LS_DATA_BLUE_0,1,2; APDS_LS_DATA_RED_0,1,2 are read in one
+*          burst like address structure IR-G-B-R
 * @param infrared value of infrared light
 * @param green value of green light
 * @param blue value of blue light
 * @param red value of red light
+* @return error code, ERROR_DATA_NOT_READY if nothing new was converted
+*/
+int apds_measure(uint8_t dev, uint32_t* infrared, uint32_t* green, uint32_t* blue, uint32_t* red);
+
+/**
+* @brief  check MAIN_STATUS for a new result
+* @details reading MAIN_STATUS clears it, so every result is reported once
+* @param[in] dev device file
+* @return error code, ERROR_DATA_NOT_READY if nothing new was converted
+*/
+int apds_ready(uint8_t dev);
 
+/**
+* @brief  read the data registers in one burst, without conversion
+* @param[in] dev device file
+* @param[out] data APDS_LS_DATA_IR_0 up to APDS_LS_DATA_RED_2
+* @return error code
+*/
+int apds_read_raw(uint8_t dev, uint8_t data[APDS_LS_DATA_SIZE]);
+
+/**
+* @brief  unpack the 20 bit channels of a burst
+* @param[in] data as read by apds_read_raw()
+* @param infrared value of infrared light
+* @param green value of green light
+* @param blue value of blue light
+* @param red value of red light
 */
-void apds_measure(uint8_t dev, uint32_t* infrared, uint32_t* green, uint32_t* blue, uint32_t* red);
+void apds_decode(const uint8_t data[APDS_LS_DATA_SIZE], uint32_t* infrared, uint32_t* green,
+                 uint32_t* blue, uint32_t* red);
 
 #endif //APDS_H
@@ -11,20 +11,264 @@
 #define BME_H
 
 #include <stdlib.h>
+#include <stdint.h>
+#include "bme68x_defs.h"
+#include "common.h"
+#include "sensor.h"
+
+/** maximum number of results a single read returns (parallel mode) */
+#define BME_MAX_FIELDS 3
+/** BME68x one registry sensor drives, at BME_ADD and BME2_ADD */
+#define BME_MAX_SENSORS 2
+
+/** acquisition modes */
+enum bme_mode {
+    BME_MODE_FORCED,  /// one measurement per trigger, fixed heater step
+    BME_MODE_PARALLEL /// free running through the 10 step heater profile
+};
+
+/** measurement profiles, trading latency against noise */
+enum bme_profile {
+    BME_PROFILE_LOW_LATENCY, /// 1x oversampling, no filter, short heater
+    BME_PROFILE_BALANCED,    /// the former fixed setting (hum 16x, temp 2x, pres 1x)
+    BME_PROFILE_LOW_NOISE    /// high oversampling, IIR filter, long heater
+};
+
+/**
+* @struct bme_field
+* @brief  one result as returned by the sensor
+* @var temp temperature [0.01 degC]
+* @var pres pressure [Pa]
+* @var hum humidity [0.001 %]
+* @var gas_res gas resistance [Ohm]
+* @var status BME68X_*_MSK status bits (new data, gas valid, heater stable)
+* @var gas_index heater profile step the gas resistance was measured at
+* @var meas_index measurement counter, to detect skipped results
+* @var addr slave address of the sensor
+* @var heatr_temp heater temperature of that step [degC]
+*/
+struct bme_field {
+    int32_t temp;
+    uint32_t pres;
+    uint32_t hum;
+    uint32_t gas_res;
+    uint8_t status;
+    uint8_t gas_index;
+    uint8_t meas_index;
+    uint8_t addr;
+    uint16_t heatr_temp;
+};
+
+/** trigger/collect state */
+enum bme_state {
+    BME_IDLE,      /// nothing triggered
+    BME_MEASURING, /// triggered, result pending
+    BME_RUNNING    /// parallel mode, results keep coming
+};
+
+/**
+* @struct bme_ctx
+* @brief  one BME68x; several can share a bus at different addresses
+* @var dev Bosch API device
+* @var conf oversampling and filter settings
+* @var heatr_conf heater settings
+* @var slave bus and address, dev.intf_ptr points here
+* @var mode selected mode
+* @var profile selected profile
+* @var state trigger/collect state
+* @var ready_us monotonic time at which the triggered measurement is complete
+*/
+struct bme_ctx {
+    struct bme68x_dev dev;
+    struct bme68x_conf conf;
+    struct bme68x_heatr_conf heatr_conf;
+    i2c_slave slave;
+    enum bme_mode mode;
+    enum bme_profile profile;
+    enum bme_state state;
+    uint64_t ready_us;
+};
+
+/**
+* @struct bme_set
+* @brief  the BME68x behind the registry sensor, on the same bus and channel
+* @var ctx contexts of the sensors that came up, the registry address first
+* @var n number of sensors up
+* @var next sensor the next one-at-a-time collect starts with
+* @var mode mode they are brought up in, see bme_sensor_set_mode()
+*/
+struct bme_set {
+    struct bme_ctx ctx[BME_MAX_SENSORS];
+    uint8_t n;
+    uint8_t next;
+    enum bme_mode mode;
+};
 
 /**
 * @brief  initialize bme68x sensor
-* @details call the BOSCH driver
+* @details call the BOSCH driver, forced mode and the balanced profile are
+*          selected
+* @param[out] ctx sensor context, has to stay valid while the sensor is used
+* @param[in] fd i2c bus device file
+* @param[in] addr slave address, BME_ADD or BME2_ADD
+* @return error code
 */
-void bme_init(uint8_t chip_id);
+int bme_init(struct bme_ctx *ctx, uint8_t fd, uint8_t addr);
 
 /**
-* @brief  carry out measurement
+* @brief  select forced or parallel mode at runtime
+* @details the sensor is put to sleep and reconfigured, no bme68x_init needed
+* @param[inout] ctx sensor context
+* @param[in] new_mode mode to select
+* @return error code
+*/
+int bme_set_mode(struct bme_ctx *ctx, enum bme_mode new_mode);
+
+/**
+* @brief  currently selected mode
+* @param[in] ctx sensor context
+* @return mode
+*/
+enum bme_mode bme_get_mode(const struct bme_ctx *ctx);
+
+/**
+* @brief  select a measurement profile at runtime
+* @details oversampling, IIR filter and heater duration are set together,
+*          no bme68x_init needed
+* @param[inout] ctx sensor context
+* @param[in] new_profile profile to select
+* @return error code
+*/
+int bme_set_profile(struct bme_ctx *ctx, enum bme_profile new_profile);
+
+/**
+* @brief  currently selected profile
+* @param[in] ctx sensor context
+* @return profile
+*/
+enum bme_profile bme_get_profile(const struct bme_ctx *ctx);
+
+/**
+* @brief  expected timing of a profile in forced mode
+* @param[in] ctx sensor context
+* @param[in] prof profile to evaluate
+* @param[out] meas_dur_us TPH and gas conversion duration [us]
+* @param[out] period_us conversion plus heater phase, one sample [us]
+* @param[out] rate_mhz sustainable sample rate [mHz]
+* @return error code
+*/
+int bme_profile_info(struct bme_ctx *ctx, enum bme_profile prof,
+                     uint32_t *meas_dur_us, uint32_t *period_us,
+                     uint32_t *rate_mhz);
+
+/** samples taken by bme_measure() callers that want the heater settled */
+#define BME_SAMPLE_COUNT UINT16_C(300)
+
+/**
+* @brief  start a measurement and return immediately
+* @details the result can be collected with bme_collect() once the
+*          measurement duration and the heater phase have passed; in parallel
+*          mode the sensor keeps running and later calls only return when
+*          the next results are due
+* @param[inout] ctx sensor context
+* @param[out] ready_at monotonic time when the result is ready [us], may be NULL
+* @return error code
+*/
+int bme_trigger(struct bme_ctx *ctx, uint64_t *ready_at);
+
+/**
+* @brief  collect every result of the last bme_trigger()
+* @details nothing is filtered; in parallel mode up to BME_MAX_FIELDS results
+*          (one per heater step) come with each read
+* @param[inout] ctx sensor context
+* @param[out] fields results
+* @param[out] n_fields number of results
+* @return error code, ERROR_DATA_NOT_READY if called too early,
+*         ERROR_STATE_MACHINE if nothing was triggered
+*/
+int bme_collect_fields(struct bme_ctx *ctx, struct bme_field fields[BME_MAX_FIELDS],
+                       uint8_t *n_fields);
+
+/**
+* @brief  collect the result of the last bme_trigger()
+* @details outputs are only written with a stable heater, like bme_measure()
+* @param[inout] ctx sensor context
+* @param[out] temp temperature [degC]
+* @param[out] pres pressure [Pa]
+* @param[out] hum humidity [%]
+* @param[out] gas_res gas resistance [Ohm]
+* @return error code, ERROR_DATA_NOT_READY if called too early or the heater
+*         was not stable, ERROR_STATE_MACHINE if nothing was triggered
+*/
+int bme_collect(struct bme_ctx *ctx, int32_t *temp, uint32_t *pres,
+                uint32_t *hum, uint32_t *gas_res);
+
+/**
+* @brief  carry out blocking measurements, keeping the last stable one
+* @param[inout] ctx sensor context
+* @param[in] sample_count number of measurements
 * @param[out] temp temperature
 * @param[out] pres pressure
 * @param[out] hum humidity
 * @param[out] gas_res gas resistance
+* @return error code
+*/
+int bme_measure(struct bme_ctx *ctx, uint16_t sample_count, int32_t *temp,
+                uint32_t *pres, uint32_t *hum, uint32_t *gas_res);
+
+/**
+* @brief  trigger several sensors, their conversions then run side by side
+* @param[inout] ctx sensors
+* @param[in] n number of sensors
+* @param[out] ready_at monotonic time when the last one is done [us], may be NULL
+* @return error code, the first failing sensor's; the others are triggered anyway
+*/
+int bme_trigger_interleaved(struct bme_ctx *ctx[], size_t n, uint64_t *ready_at);
+
+/**
+* @brief  collect the forced measurements of bme_trigger_interleaved()
+* @details in the order the sensors finish, waiting for each one that is
+*          not done yet; sensors without a pending measurement are skipped
+* @param[inout] ctx sensors
+* @param[in] n number of sensors
+* @param[out] fields one result per sensor, the last of its read
+* @param[out] got non-zero for each sensor whose fields entry is a result
+* @return error code, the first failing sensor's
+*/
+int bme_collect_interleaved(struct bme_ctx *ctx[], size_t n, struct bme_field fields[],
+                            uint8_t got[]);
+
+/**
+* @brief  one forced measurement on several sensors, overlapping their waits
+* @details every sensor is triggered first and then collected in the order
+*          they finish, so the heater phase of one runs during the
+*          conversion of the others instead of after it
+* @param[in] ctx sensors
+* @param[in] n number of sensors
+* @param[out] fields one result per sensor
+* @return error code, the first failing sensor's
+*/
+int bme_measure_interleaved(struct bme_ctx *ctx[], size_t n, struct bme_field fields[]);
+
+/**
+* @brief  registry descriptor, ctx points to a struct bme_set
+* @details one row per result: temp, pres, hum, gas_res, gas_index,
+*          heatr_temp, status, addr; collect goes through the Bosch API, so
+*          the collected results are already compensated. With several
+*          sensors in forced mode they are triggered and collected together
+*          (bme_trigger_interleaved()), one row each; in parallel mode each
+*          collect reads the next sensor with results
+*/
+extern const struct sensor_driver bme_driver;
+
+/**
+* @brief  select the mode a registry BME68x is brought up in
+* @details kept across sensor_open(), which applies it; bme_set_mode() on the
+*          context switches a sensor that is up
+* @param[inout] sensor registry sensor of bme_driver
+* @param[in] mode mode to select
+* @return error code
 */
-void bme_measure(int32_t *temp, uint32_t *pres, uint32_t *hum, uint32_t *gas_res);
+int bme_sensor_set_mode(struct sensor *sensor, enum bme_mode mode);
 
 #endif //BME_H
@@ -0,0 +1,126 @@
+/**
+ * @file bringup.h
+ * @author  Jie Liu
+ * @version V1.0
+ * @date    2026-10-18
+ * @brief Concurrent sensor bring-up with a start-up trace
+ * @note Every sensor is brought up on a thread of its own, on its own open
+ * file of the bus: the selected slave address lives in the open file, and the
+ * kernel serializes the transfers of different files on one adapter, so the
+ * soft resets, calibration reads and first conversions of different sensors
+ * overlap. A sensor is initialized and sampled once while it is still
+ * inactive in the registry, and only then published as active, so
+ * acquisition that is already running picks it up on its next run without
+ * ever sharing it with the bring-up thread. The mux setting is bus-wide:
+ * when the sensors need more than one (see sensor_plan_mux()), the ones
+ * behind the mux are brought up one after the other.
+ */
+
+#ifndef BRINGUP_H
+#define BRINGUP_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "sensor.h"
+
+struct bringup;
+
+/**
+ * @struct bringup_job
+ * @brief bring-up of one sensor and its trace, times since bringup_start() [ns]
+ * @var bringup bring-up the job belongs to
+ * @var sensor registry sensor
+ * @var thread bring-up thread
+ * @var fd bus file of the sensor, -1 if not open
+ * @var open_ns bus file opened
+ * @var init_ns init returned
+ * @var first_ns first result handed to the sink
+ * @var result error code of the bring-up
+ */
+struct bringup_job {
+    struct bringup* bringup;
+    struct sensor* sensor;
+    pthread_t thread;
+    int fd;
+    uint64_t open_ns;
+    uint64_t init_ns;
+    uint64_t first_ns;
+    int result;
+};
+
+/**
+ * @struct bringup
+ * @brief bring-up state
+ * @var bus bus device file, e.g. "/dev/i2c-1"
+ * @var jobs one per sensor
+ * @var n_jobs number of jobs
+ * @var start_ns time of bringup_start(), CLOCK_MONOTONIC [ns]
+ * @var sink gets the first result of every sensor, calls are serialized
+ * @var sink_arg argument of sink
+ * @var lock serializes sink
+ * @var mux_lock held through a whole bring-up when serial is set
+ * @var serial the sensors need more than one mux setting
+ */
+struct bringup {
+    const char* bus;
+    struct bringup_job jobs[SENSOR_COUNT];
+    size_t n_jobs;
+    uint64_t start_ns;
+    void (*sink)(const struct sensor* sensor, const struct sensor_raw* raw, void* arg);
+    void* sink_arg;
+    pthread_mutex_t lock;
+    pthread_mutex_t mux_lock;
+    uint8_t serial;
+};
+
+/**
+ * @brief Start with no sensor
+ * @param[out] bringup bring-up state
+ * @param[in] bus bus device file
+ * @param[in] sink gets the first result of every sensor, NULL to drop it
+ * @param[in] sink_arg argument of sink
+ */
+void bringup_init(struct bringup* bringup, const char* bus,
+        void (*sink)(const struct sensor* sensor, const struct sensor_raw* raw, void* arg),
+        void* sink_arg);
+
+/**
+ * @brief Add a registry sensor
+ * @param[inout] bringup bring-up state
+ * @param[in] id sensor, inactive
+ * @return error code
+ */
+int bringup_add(struct bringup* bringup, enum sensor_id id);
+
+/**
+ * @brief Start bringing every added sensor up, returns at once
+ * @param[inout] bringup bring-up state
+ * @return error code, sensors already started keep going
+ */
+int bringup_start(struct bringup* bringup);
+
+/**
+ * @brief Wait until every sensor is up or has failed
+ * @param[inout] bringup bring-up state
+ * @return number of sensors that failed
+ */
+size_t bringup_wait(struct bringup* bringup);
+
+/**
+ * @brief Print open, init and time to first sample of every sensor
+ * @param[in] bringup bring-up state, after bringup_wait()
+ * @param[in] stream output
+ */
+void bringup_report(const struct bringup* bringup, FILE* stream);
+
+/**
+ * @brief Close the bus files, after acquisition stopped
+ * @param[inout] bringup bring-up state
+ */
+void bringup_close(struct bringup* bringup);
+
+#endif /* BRINGUP_H */
+
+// vim: expandtab ts=4 sw=4
@@ -0,0 +1,101 @@
+/**
+ * @file bus.h
+ * @author  Jie Liu
+ * @version V1.0
+ * @date    2026-10-18
+ * @brief Pluggable backend under the I2C, SPI and UART primitives
+ * @note Every open, close, read, write and ioctl the I2C, SPI and UART
+ * primitives of common.c make on a device file goes through the backend set
+ * here. The system backend passes them to the kernel; another one, like the
+ * simulated shield of sim.h or the replay of capture.h, can answer them in
+ * the process. The backend is chosen once, before the first bus is opened.
+ * The termios setup of a UART stays with the system, so whatever answers a
+ * UART path has to open a terminal for it: a simulated UART is a real pseudo
+ * terminal.
+ */
+
+#ifndef BUS_H
+#define BUS_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+/**
+ * @struct bus_backend
+ * @brief system calls on bus device files, same contract as the libc ones
+ * @var name short name
+ * @var open open a bus device file, returns a descriptor or -1 and errno
+ * @var close close a descriptor
+ * @var read plain read, I2C: from the selected slave
+ * @var write plain write, I2C: to the selected slave
+ * @var ioctl I2C_SLAVE, I2C_RDWR, SPI_IOC_* and the like
+ */
+struct bus_backend {
+    const char* name;
+    int (*open)(const char* path, int flags);
+    int (*close)(int fd);
+    ssize_t (*read)(int fd, void* buf, size_t len);
+    ssize_t (*write)(int fd, const void* buf, size_t len);
+    int (*ioctl)(int fd, unsigned long request, void* arg);
+};
+
+/** the kernel's I2C and SPI drivers */
+extern const struct bus_backend bus_system;
+
+/**
+ * @brief Choose the backend of the buses opened from now on
+ * @param[in] backend backend, NULL for bus_system
+ */
+void bus_set_backend(const struct bus_backend* backend);
+
+/**
+ * @brief Backend in use
+ * @return backend
+ */
+const struct bus_backend* bus_get_backend(void);
+
+/**
+ * @brief Open a bus device file
+ * @param[in] path e.g. "/dev/i2c-1" or "/dev/spidev0.0"
+ * @param[in] flags open flags
+ * @return descriptor, -1 with errno set on error
+ */
+int bus_open(const char* path, int flags);
+
+/**
+ * @brief Close a bus device file
+ * @param[in] fd descriptor
+ * @return 0, -1 with errno set on error
+ */
+int bus_close(int fd);
+
+/**
+ * @brief Read from a bus device file
+ * @param[in] fd descriptor
+ * @param[out] buf data
+ * @param[in] len bytes to read
+ * @return bytes read, -1 with errno set on error
+ */
+ssize_t bus_read(int fd, void* buf, size_t len);
+
+/**
+ * @brief Write to a bus device file
+ * @param[in] fd descriptor
+ * @param[in] buf data
+ * @param[in] len bytes to write
+ * @return bytes written, -1 with errno set on error
+ */
+ssize_t bus_write(int fd, const void* buf, size_t len);
+
+/**
+ * @brief Control a bus device file
+ * @param[in] fd descriptor
+ * @param[in] request ioctl request
+ * @param[inout] arg request argument
+ * @return >= 0, -1 with errno set on error
+ */
+int bus_ioctl(int fd, unsigned long request, void* arg);
+
+#endif /* BUS_H */
+
+// vim: expandtab ts=4 sw=4
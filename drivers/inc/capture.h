@@ -0,0 +1,158 @@
+/**
+ * @file capture.h
+ * @author  Jie Liu
+ * @version V1.0
+ * @date    2026-10-18
+ * @brief Capture of the bus transactions to a file, and their replay
+ * @note Capture is a bus backend (see bus.h) in front of the one in use: it
+ * passes every call on and appends what went over the wire to a binary file,
+ * one capture_record per transaction followed by its bytes. That is each
+ * I2C message (also the ones of a combined I2C_RDWR), each SPI transfer,
+ * each UART read and write, the slave selections, the other ioctls with
+ * what they returned, and the opens and closes. A read that found nothing
+ * pending is not recorded.
+ *
+ * Replay is a bus backend answering the drivers from such a file, either at
+ * the recorded pace or as fast as they ask. Calls are matched to the
+ * recording by kind, descriptor and slave address, in order, looking
+ * REPLAY_LOOKAHEAD records ahead: records of another thread interleaved
+ * differently are found, records the drivers no longer ask for are skipped.
+ * Reads get the recorded bytes and result; written bytes that differ from
+ * the recording are counted. A UART is replayed through a pseudo terminal
+ * fed with the recorded bytes, so termios and poll() work as on the device.
+ */
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdint.h>
+
+#include "bus.h"
+
+/** first bytes of a capture file */
+#define CAPTURE_MAGIC "shldcap1"
+/** reg of a transaction without register */
+#define CAPTURE_NO_REG 0xFFFF
+/** records a replayed call is matched against */
+#define REPLAY_LOOKAHEAD 64
+/** records a replayed call may be behind the newest match before it is skipped */
+#define REPLAY_HORIZON 4096
+
+/** what a record is */
+enum capture_kind {
+    CAPTURE_OPEN,      /// payload: path; result: descriptor
+    CAPTURE_CLOSE,
+    CAPTURE_READ,      /// read() on the descriptor, payload: bytes read
+    CAPTURE_WRITE,     /// write() on the descriptor, payload: bytes written
+    CAPTURE_ADDR,      /// I2C slave selection
+    CAPTURE_I2C_READ,  /// read message of an I2C_RDWR, payload: bytes read
+    CAPTURE_I2C_WRITE, /// write message of an I2C_RDWR, payload: bytes written
+    CAPTURE_SPI,       /// SPI transfer, payload: tx bytes then rx bytes
+    CAPTURE_IOCTL      /// other ioctl, payload: request (32 bit) then what it returned
+};
+
+/**
+ * @struct capture_header
+ * @brief start of a capture file, 24 bytes
+ * @var magic CAPTURE_MAGIC
+ * @var monotonic_ns CLOCK_MONOTONIC at the start, stamps count from here [ns]
+ * @var realtime_ns CLOCK_REALTIME at the same instant [ns]
+ */
+struct __attribute__ ((__packed__)) capture_header {
+    char magic[8];
+    uint64_t monotonic_ns;
+    uint64_t realtime_ns;
+};
+
+/**
+ * @struct capture_record
+ * @brief one transaction, 20 bytes, followed by len bytes of payload
+ * @var stamp_ns start of the call, since the start of the capture [ns]
+ * @var kind enum capture_kind
+ * @var fd descriptor in the capturing process
+ * @var addr I2C slave address, 0 for SPI and UART
+ * @var reg first byte written in the transaction or before a read on the
+ *      same descriptor, CAPTURE_NO_REG if none; the high byte of a 16-bit
+ *      register address
+ * @var len payload bytes
+ * @var result what the call returned, -errno if it failed
+ */
+struct __attribute__ ((__packed__)) capture_record {
+    uint64_t stamp_ns;
+    uint8_t kind;
+    uint8_t fd;
+    uint16_t addr;
+    uint16_t reg;
+    uint16_t len;
+    int32_t result;
+};
+
+_Static_assert(sizeof(struct capture_header) == 24, "capture_header layout changed");
+_Static_assert(sizeof(struct capture_record) == 20, "capture_record layout changed");
+
+/** pace of a replay */
+enum replay_speed {
+    REPLAY_FAST,     /// answer at once
+    REPLAY_RECORDED  /// answer no earlier than recorded, from replay_open() on
+};
+
+/**
+ * @struct replay_stats
+ * @brief how a replay went
+ * @var records records in the file
+ * @var replayed records that answered a call
+ * @var skipped records no call asked for
+ * @var mismatches written bytes differing from the recording
+ * @var unmatched calls no record answered
+ */
+struct replay_stats {
+    uint64_t records;
+    uint64_t replayed;
+    uint64_t skipped;
+    uint64_t mismatches;
+    uint64_t unmatched;
+};
+
+/** backend recording the calls passed to the backend in use before */
+extern const struct bus_backend capture_backend;
+
+/** backend answering from a capture file */
+extern const struct bus_backend replay_backend;
+
+/**
+ * @brief Record the bus calls from now on
+ * @note sets capture_backend in front of the backend in use
+ * @param[in] path capture file, overwritten
+ * @return error code
+ */
+int capture_start(const char* path);
+
+/**
+ * @brief Stop recording and put the backend in use before back
+ * @note the descriptors stay open
+ */
+void capture_stop(void);
+
+/**
+ * @brief Load a capture file for replay_backend
+ * @param[in] path capture file
+ * @param[in] speed pace of the answers
+ * @return error code
+ */
+int replay_open(const char* path, enum replay_speed speed);
+
+/**
+ * @brief How the replay went so far
+ * @param[out] stats statistics
+ */
+void replay_get_stats(struct replay_stats* stats);
+
+/**
+ * @brief Release the capture file
+ * @note the skipped count includes the records left over
+ */
+void replay_close(void);
+
+#endif /* CAPTURE_H */
+
+// vim: expandtab ts=4 sw=4
@@ -23,11 +23,14 @@
 #define REGISTER_DATA_SIZE 16
 /** uart message buffer size [chars] */
 #define MESSAGE_SIZE 20*32
+/** sensor_measure() output buffer size, fits BME_MAX_FIELDS lines [chars] */
+#define SENSOR_STRING_SIZE 128
 /** sensor timeout in deciseconds */
 #define SENSOR_TIMEOUT 1
 
 #define APDS_ADD                    UINT8_C(0x52)
 #define BME_ADD                     UINT8_C(0x76) //bosch uses as high (previously called "primary") 0x77, low (previously called "secondary") 0x76
+#define BME2_ADD                    UINT8_C(0x77) //second BME68x on the same bus, SDO tied high
 #define MLX_ADD                     UINT8_C(0x3A)
 #define LIS2_ADD                    UINT8_C(0x19)
 
@@ -46,6 +49,17 @@ typedef struct __attribute__ ((__packed__)) {
     uint8_t size;
 } dev_reg;
 
+/**
+ * @struct i2c_slave
+ * @brief slave on a shared bus, for drivers with several instances per bus
+ * @var fd bus device file
+ * @var addr slave address
+ */
+typedef struct {
+    uint8_t fd;
+    uint8_t addr;
+} i2c_slave;
+
 #ifdef DEBUG
 /**
  * @brief print entire register
@@ -146,6 +160,17 @@ int uart_write(int* dev, char* message);
  */
 int uart_read(int* dev, char* message);
 
+/**
+ * @brief Read whatever is pending on the uart device, without blocking
+ * @note unlike uart_read(), nothing pending is not reported as a warning
+ * @param[in] dev device file
+ * @param[out] buffer received characters (not null terminated)
+ * @param[in] size size of buffer
+ * @param[out] count number of characters received
+ * @return error code, ERROR_NOTHING_TO_READ if nothing was pending
+ */
+int uart_read_pending(int* dev, char* buffer, size_t size, size_t* count);
+
 /*
 * @brief  open the I2C serial communication port
 * @param[in] bus I2C bus in linux
@@ -155,6 +180,7 @@ int i2c_open(char *bus);
 */
 /**
 * @brief  close the I2C serial communication port
+* @note the register shadow of every slave on the bus is dropped
 * @param[in] dev device file, which has each I2C channel in the /dev directory
 */
 void i2c_close(uint8_t dev);
@@ -166,6 +192,13 @@ void i2c_close(uint8_t dev);
 */
 void i2c_set_address(uint8_t dev, int addr);
 
+/**
+* @brief get the sensor address last set
+* @param[in] dev device file, which has each I2C channel in the /dev directory
+* @return address of device, 0 if unknown
+*/
+uint8_t i2c_get_address(uint8_t dev);
+
 /**
 * @brief delay for n micro seconds
 * @param[in] period delay time for waiting sensor respond
@@ -197,6 +230,83 @@ int8_t i2c_write(uint8_t reg_addr, const uint8_t *reg_data, uint32_t len, void *
 */
 int8_t i2c_read_8bit(uint8_t reg_addr, uint8_t *reg_data, uint32_t len, void *intf_ptr);
 
+/**
+* @brief  same as i2c_write, for an i2c_slave
+* @note the slave address is only switched when another slave was used last
+* @param[in] reg_addr register address
+* @param[in] reg_data data to be written into register
+* @param[in] len length of data
+* @param[in] intf_ptr i2c_slave *
+* @return success or not
+*     @retval 0 success
+*     @retval 1 not success
+*/
+int8_t i2c_slave_write(uint8_t reg_addr, const uint8_t *reg_data, uint32_t len, void *intf_ptr);
+
+/**
+* @brief  same as i2c_read_8bit, for an i2c_slave
+* @note the slave address is only switched when another slave was used last
+* @param[in] reg_addr register address
+* @param[out] reg_data data read from register
+* @param[in] len length of data
+* @param[in] intf_ptr i2c_slave *
+* @return success or not
+*     @retval 0 success
+*     @retval 1 not success
+*/
+int8_t i2c_slave_read(uint8_t reg_addr, uint8_t *reg_data, uint32_t len, void *intf_ptr);
+
+/**
+* @brief  read 16-bit registers with 16-bit addresses
+* @note address and data go in one combined transfer, without selecting the
+* slave, so it is safe next to other users of the bus
+* @param[in] slave slave to read from
+* @param[in] reg_addr first register address, auto increment
+* @param[out] reg_data register values, in host byte order
+* @param[in] len number of registers
+* @return success or not
+*     @retval 0 success
+*     @retval 1 not success
+*/
+int8_t i2c_slave_read_16bit(const i2c_slave *slave, uint16_t reg_addr, uint16_t *reg_data,
+							uint16_t len);
+
+/**
+* @brief  write a 16-bit register with a 16-bit address
+* @note does not select the slave, see i2c_slave_read_16bit
+* @param[in] slave slave to write to
+* @param[in] reg_addr register address
+* @param[in] reg_data register value, in host byte order
+* @return success or not
+*     @retval 0 success
+*     @retval 1 not success
+*/
+int8_t i2c_slave_write_16bit(const i2c_slave *slave, uint16_t reg_addr, uint16_t reg_data);
+
+/**
+* @brief  probe a slave with one quick read of an identification register
+* @note one combined transfer, without selecting the slave and without
+* printing anything, a missing slave is the common case while scanning
+* @param[in] slave slave to probe
+* @param[in] reg_addr register address
+* @param[in] wide 16-bit register address and value (MLX), 8-bit otherwise
+* @param[out] value register value, in host byte order
+* @return success or not
+*     @retval 0 the slave answered
+*     @retval 1 no answer
+*/
+int8_t i2c_probe(const i2c_slave *slave, uint16_t reg_addr, uint8_t wide, uint16_t *value);
+
+/**
+* @brief  same as i2c_slave_read_16bit, for the slave last selected with i2c_set_address
+* @param[in] dev device file, which has each I2C channel in the /dev directory
+* @param[in] reg_addr first register address, auto increment
+* @param[out] reg_data register values, in host byte order
+* @param[in] len number of registers
+* @return success or not
+*     @retval 0 success
+*     @retval 1 not success
+*/
 int8_t i2c_read_16bit(uint8_t dev, uint16_t reg_addr, uint16_t *reg_data, uint16_t len);
 
 /**
@@ -211,18 +321,4 @@ int8_t i2c_read_16bit(uint8_t dev, uint16_t reg_addr, uint16_t *reg_data, uint16
  */
 void spi_close(int* bus);
 
-/**
- * @brief activate sensor
- * @param[in] slave address to be activated
- * @param[in] bus file
- */
-void sensor_activate(uint8_t slave_activate, uint8_t dev);
-/**
- * @brief activate measurement
- * @param[in] slave address to be activated
- * @param[in] bus file
- * @param[out] str 
- * @param[in] len max str length
- */
-void sensor_measure(uint8_t slave_activate, uint8_t dev, char* str, const size_t len);
 #endif /* COMMON_H */
@@ -57,6 +57,7 @@
 #define ERROR_READ_REGISTER_FAILS 177
 #define ERROR_NOTHING_TO_READ 178
 #define ERROR_NMEA_NOT_FOUND 179
+#define ERROR_DATA_NOT_READY 180
 ///@}
 
 /// debugging mode: activate with gcc's -D DEBUG
@@ -58,6 +58,36 @@ enum nmea_unit {
 	F  /// Feet
 };
 
+/**
+ * @struct gnss_fix
+ * @brief decoded position fix, merged from RMC and GGA messages
+ * @note fixed point, so it can be passed around without floating point
+ */
+struct gnss_fix {
+    uint8_t valid;      /// RMC status is 'A' (data valid)
+    uint8_t quality;    /// GGA fix quality (0 = no fix)
+    uint8_t satellites; /// GGA number of satellites in use
+    uint32_t time;      /// UTC time of day [ms]
+    uint32_t date;      /// UTC date as ddmmyy
+    int32_t latitude;   /// [1e-7 degree], north is positive
+    int32_t longitude;  /// [1e-7 degree], east is positive
+    int32_t altitude;   /// altitude above mean sea level [mm]
+    uint16_t hdop;      /// horizontal dilution of precision [1/100]
+    uint32_t speed;     /// speed over ground [mm/s]
+    uint16_t course;    /// course over ground [1/100 degree]
+};
+
+/**
+ * @struct nmea_stream
+ * @brief reassembles NMEA messages that arrive split over several reads
+ * @var buffer received characters not yet consumed
+ * @var length number of characters in buffer
+ */
+struct nmea_stream {
+    char buffer[MESSAGE_SIZE];
+    size_t length;
+};
+
 /**
  * @brief Same as uart_read, but returns only the NMEA message
  * @note Maximum message size is defined by MESSAGE_SIZE
@@ -107,6 +137,39 @@ int nmea_parse_fields(char* message,
  */
 int nmea_enable_geographical_latitude_longitude(int* dev);
 
+/**
+ * @brief Append whatever the module has sent to the stream
+ * @note does not block, the UART is opened with O_NDELAY
+ * @param[in] dev device file
+ * @param[inout] stream stream to append to
+ * @return error code, ERROR_NOTHING_TO_READ if no character was pending
+ */
+int nmea_stream_read(int* dev, struct nmea_stream* stream);
+
+/**
+ * @brief Take the next complete NMEA message out of the stream
+ * @note the message is returned including the "$" and the "*CS\r\n" tail,
+ * so it can be given to nmea_parse_fields() as is; garbage in front of
+ * the "$" is dropped.
+ * @param[inout] stream stream to take from
+ * @param[out] message NMEA message, null terminated
+ * @param[in] size size of message
+ * @return error code, ERROR_NMEA_NOT_FOUND if no complete message is pending
+ */
+int nmea_stream_next(struct nmea_stream* stream, char* message, size_t size);
+
+/**
+ * @brief Update a fix with the content of a RMC or GGA message
+ * @note fields are expected as given by nmea_parse_fields(); other messages
+ * leave the fix untouched
+ * @param[in] fields vector containing the fields values
+ * @param[in] number_of_fields number of fields
+ * @param[inout] fix fix to update
+ * @return error code, ERROR_PARSER if the message does not carry a fix
+ */
+int nmea_parse_fix(char fields[NMEA_MAX_FIELDS][NMEA_FIELD_BUFFER],
+        uint8_t number_of_fields, struct gnss_fix* fix);
+
 #endif /* GNSS_H */
 
 // vim: expandtab ts=4 sw=4
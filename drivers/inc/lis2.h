@@ -10,12 +10,17 @@
 #ifndef LIS2_H
 #define LIS2_H
 
+#include <stdio.h>
 #include <stdint.h>
 #include <stddef.h>
 #include <math.h>
 
+#include "sensor.h"
+
 ///address of register CTRL_1
 #define LIS2DW12_CTRL1                       0x20
+///CTRL_1: ODR 12.5 Hz, single data conversion on demand, Low-Power Mode 3
+#define LIS2DW12_CTRL1_ON_DEMAND             0x2A
 /*
 typedef struct
 {
@@ -28,6 +33,16 @@ typedef struct
 } lis2dw12_ctrl1_t; 
 */
 
+///address of register CTRL_2, BDU and IF_ADD_INC
+#define LIS2DW12_CTRL2                       0x21
+///CTRL_2: block data update, address auto increment
+#define LIS2DW12_CTRL2_BDU_IF_ADD_INC        0x0C
+
+///address of register CTRL4_INT1_PAD_CTRL
+#define LIS2DW12_CTRL4_INT1                  0x23
+///CTRL4_INT1_PAD_CTRL: FIFO threshold on INT1
+#define LIS2DW12_INT1_FTH                    0x02
+
 ///register CTRL_6
 #define LIS2DW12_CTRL6                       0x25
 /*
@@ -66,6 +81,8 @@ typedef struct
 
 ///address of register STATUS
 #define LIS2DW12_STATUS                      0x27
+///STATUS: new X, Y, Z data available
+#define LIS2DW12_STATUS_DRDY                 0x01
 ///FIFO threshold status flag, Source of change in position, Data ready status
 /*
 typedef struct
@@ -81,6 +98,56 @@ typedef struct
 } lis2dw12_status_t;
 */
 
+///address of register FIFO_CTRL
+#define LIS2DW12_FIFO_CTRL                   0x2E
+///FIFO_CTRL: FMode[2:0] = 110, continuous mode
+#define LIS2DW12_FIFO_MODE_CONTINUOUS        0xC0
+///FIFO_CTRL: FMode[2:0] = 000, bypass mode (FIFO off)
+#define LIS2DW12_FIFO_MODE_BYPASS            0x00
+///FIFO_CTRL: FTH[4:0], watermark level
+#define LIS2DW12_FIFO_FTH_MSK                0x1F
+
+///address of register FIFO_SAMPLES
+#define LIS2DW12_FIFO_SAMPLES                0x2F
+///FIFO_SAMPLES: watermark reached
+#define LIS2DW12_FIFO_FTH                    0x80
+///FIFO_SAMPLES: FIFO full, oldest samples overwritten
+#define LIS2DW12_FIFO_OVR                    0x40
+///FIFO_SAMPLES: Diff[5:0], number of unread samples
+#define LIS2DW12_FIFO_DIFF_MSK               0x3F
+
+///FIFO depth [samples]
+#define LIS2DW12_FIFO_DEPTH                  32
+///bytes per sample, X, Y, Z, low byte first
+#define LIS2DW12_SAMPLE_SIZE                 6
+
+///address of register WAKE_UP_THS
+#define LIS2DW12_WAKE_UP_THS                 0x34
+///WAKE_UP_THS: SLEEP_ON, inactivity puts the device to sleep
+#define LIS2DW12_SLEEP_ON                    0x40
+///WAKE_UP_THS: WK_THS[5:0], 1 LSB = FS/64
+#define LIS2DW12_WK_THS_MSK                  0x3F
+
+///address of register WAKE_UP_DUR
+#define LIS2DW12_WAKE_UP_DUR                 0x35
+///WAKE_UP_DUR: SLEEP_DUR[3:0], 1 LSB = 512/ODR
+#define LIS2DW12_SLEEP_DUR_MSK               0x0F
+
+///address of register WAKE_UP_SRC
+#define LIS2DW12_WAKE_UP_SRC                 0x38
+///WAKE_UP_SRC: device is in the sleep state
+#define LIS2DW12_SLEEP_STATE_IA              0x10
+///WAKE_UP_SRC: wake-up event detected
+#define LIS2DW12_WU_IA                       0x08
+
+///address of register CTRL_7
+#define LIS2DW12_CTRL7                       0x3F
+///CTRL_7: enable the wake-up and sleep functions
+#define LIS2DW12_INTERRUPTS_ENABLE           0x20
+
+///output data rate in the sleep state [mHz]
+#define LIS2DW12_SLEEP_RATE_MHZ              12500
+
 ///address and value of device
 #define LIS2_WHO_AM_I_ADD    0x0f
 #define LIS2_WHO_AM_I_DEF   0x44
@@ -116,8 +183,15 @@ typedef struct
  */
 #define LIS2DW12_OUT_Z_H                     0x2D
 
+///Sensitivity FS±2g in High-Performance Mode (14-bit)
+#define LIS2DW12_FS_2G_GAIN_HP		0.244f
+///Sensitivity FS±2g in High-Performance Mode (14-bit) [ug/digit]
+#define LIS2DW12_FS_2G_GAIN_HP_UG		244
+
 ///Sensitivity FS±2g in Low-Power Mode 1
 #define LIS2DW12_FS_2G_GAIN_LP		0.976f
+///Sensitivity FS±2g in Low-Power Mode 1 [ug/digit]
+#define LIS2DW12_FS_2G_GAIN_LP_UG		976
 ///Sensitivity FS±4g in Low-Power Mode 1
 #define LIS2DW12_FS_4G_GAIN_LP		1.952f
 ///Sensitivity FS±8g in Low-Power Mode 1
@@ -129,8 +203,9 @@ typedef struct
 /**
 * @brief  set the configuration of register LIS2DW12_CTRL6
 * @param[in] dev device address
+* @return error code
 */
-void lis2_init(uint8_t dev);
+int lis2_init(uint8_t dev);
 
 /**
 * @brief  Get the STATUS_REG register of the device, make sure the new data is available
@@ -142,12 +217,76 @@ void lis2_init(uint8_t dev);
 uint8_t lis2_status_reg_get(uint8_t dev, uint8_t addr);
 
 /**
-* @brief  set up control register CTRL_1, CTRL_3, CTRL_6 and read data
+* @brief  high-performance output data rates, CTRL_1 ODR[3:0]
+*/
+enum lis2_odr {
+    LIS2_ODR_12HZ5 = 0x2,
+    LIS2_ODR_25HZ = 0x3,
+    LIS2_ODR_50HZ = 0x4,
+    LIS2_ODR_100HZ = 0x5,
+    LIS2_ODR_200HZ = 0x6,
+    LIS2_ODR_400HZ = 0x7,
+    LIS2_ODR_800HZ = 0x8,
+    LIS2_ODR_1600HZ = 0x9
+};
+
+/**
+* @struct lis2_sample
+* @brief  one acceleration sample
+* @var x X-axis acceleration [mg]
+* @var y Y-axis acceleration [mg]
+* @var z Z-axis acceleration [mg]
+*/
+struct lis2_sample {
+    float x;
+    float y;
+    float z;
+};
+
+/**
+* @struct lis2_fifo
+* @brief  FIFO streaming state
+* @var dev device address
+* @var overruns number of drains that found the FIFO overrun (samples lost)
+* @var samples number of samples drained
+*/
+struct lis2_fifo {
+    uint8_t dev;
+    uint32_t overruns;
+    uint32_t samples;
+};
+
+/**
+* @brief  activity state of the duty cycling
+*/
+enum lis2_activity {
+    LIS2_ACTIVE,   /// running at the configured output data rate
+    LIS2_SLEEPING  /// inactive, 12.5 Hz low-power mode
+};
+
+/**
+* @struct lis2_duty
+* @brief  activity-based duty cycling on top of FIFO streaming
+* @var fifo FIFO streaming state
+* @var odr output data rate while active
+* @var state current activity state
+* @var transitions number of state changes seen
+*/
+struct lis2_duty {
+    struct lis2_fifo fifo;
+    enum lis2_odr odr;
+    enum lis2_activity state;
+    uint32_t transitions;
+};
+
+/**
+* @brief  trigger a conversion through CTRL_3 and read data
+* @details X, Y and Z are read in one burst
 * @param[out] ACCX configured X-axis acceleration value with sensitivity
 * @param[out] ACCY configured Y-axis acceleration value with sensitivity
 * @param[out] ACCZ configured Z-axis acceleration value with sensitivity
 */
-void lis2_get_acc_data(uint8_t dev, float ACCX, float ACCY, float ACCZ);
+void lis2_get_acc_data(uint8_t dev, float* ACCX, float* ACCY, float* ACCZ);
 
 /**
 * @brief  begin the measurement
@@ -157,6 +296,144 @@ void lis2_get_acc_data(uint8_t dev, float ACCX, float ACCY, float ACCZ);
 * @param[out] Y configured Y-axis acceleration value with sensitivity
 * @param[out] Z configured Z-axis acceleration value with sensitivity
 */
-void lis2_measure(uint8_t dev, float X, float Y, float Z);
+void lis2_measure(uint8_t dev, float* X, float* Y, float* Z);
+
+/**
+* @brief  start a single conversion through CTRL_3
+* @param[in] dev device address
+* @return error code
+*/
+int lis2_trigger(uint8_t dev);
+
+/**
+* @brief  check STATUS for new data
+* @param[in] dev device address
+* @return error code, ERROR_DATA_NOT_READY while converting
+*/
+int lis2_ready(uint8_t dev);
+
+/**
+* @brief  read OUT_X_L up to OUT_Z_H in one burst, without conversion
+* @param[in] dev device address
+* @param[out] data output registers
+* @return error code
+*/
+int lis2_read_raw(uint8_t dev, uint8_t data[LIS2DW12_SAMPLE_SIZE]);
+
+/**
+* @brief  convert the output registers of a single conversion
+* @param[in] data as read by lis2_read_raw()
+* @param[out] sample acceleration
+*/
+void lis2_decode(const uint8_t data[LIS2DW12_SAMPLE_SIZE], struct lis2_sample* sample);
+
+/**
+* @brief  stream through the FIFO in continuous mode
+* @details high-performance mode (14-bit, FS ±2g) at the given rate; the
+*          watermark is routed to INT1
+* @param[out] fifo streaming state
+* @param[in] dev device address
+* @param[in] odr output data rate
+* @param[in] watermark FIFO level that raises the watermark flag, 1 to 31
+* @return error code
+*/
+int lis2_fifo_start(struct lis2_fifo* fifo, uint8_t dev, enum lis2_odr odr,
+                    uint8_t watermark);
+
+/**
+* @brief  read every sample in the FIFO in one burst, without conversion
+* @param[inout] fifo streaming state, overruns and samples are updated
+* @param[out] data output registers of each sample, oldest first
+* @param[out] count number of samples read
+* @return error code, ERROR_DATA_NOT_READY if the FIFO was empty
+*/
+int lis2_fifo_read(struct lis2_fifo* fifo,
+                   uint8_t data[LIS2DW12_FIFO_DEPTH * LIS2DW12_SAMPLE_SIZE], uint8_t* count);
+
+/**
+* @brief  read every sample in the FIFO in one burst
+* @param[inout] fifo streaming state, overruns and samples are updated
+* @param[out] samples drained samples, oldest first
+* @param[out] count number of samples drained
+* @return error code, ERROR_DATA_NOT_READY if the FIFO was empty
+*/
+int lis2_fifo_drain(struct lis2_fifo* fifo,
+                    struct lis2_sample samples[LIS2DW12_FIFO_DEPTH], uint8_t* count);
+
+/**
+* @brief  leave streaming, FIFO back to bypass mode and single conversion on demand
+* @param[in] fifo streaming state
+* @return error code
+*/
+int lis2_fifo_stop(struct lis2_fifo* fifo);
+
+/**
+* @brief  output data rate in mHz
+* @param[in] odr output data rate
+* @return rate [mHz]
+*/
+uint32_t lis2_odr_mhz(enum lis2_odr odr);
+
+/**
+* @brief  stream through the FIFO, sleeping while the device is still
+* @details the device falls back to 12.5 Hz low-power mode after sleep_dur of
+*          inactivity and returns to odr in high-performance mode as soon as
+*          an axis exceeds the threshold; both switches are done by the sensor
+* @param[out] duty duty cycling state
+* @param[in] dev device address
+* @param[in] odr output data rate while active
+* @param[in] watermark FIFO level that raises the watermark flag, 1 to 31
+* @param[in] threshold wake-up threshold, 1 LSB = 31.25 mg at FS ±2g, 1 to 63
+* @param[in] sleep_dur inactivity before sleeping, 1 LSB = 512/odr, 0 means 16/odr
+* @return error code
+*/
+int lis2_duty_start(struct lis2_duty* duty, uint8_t dev, enum lis2_odr odr,
+                    uint8_t watermark, uint8_t threshold, uint8_t sleep_dur);
+
+/**
+* @brief  check for a change of the activity state
+* @details to be called before each lis2_fifo_drain(); samples drained after
+*          a transition was reported may still include a few taken at the
+*          previous rate
+* @param[inout] duty duty cycling state
+* @param[out] state new activity state
+* @param[out] rate_mhz effective output data rate in the new state [mHz]
+* @return error code, ERROR_DATA_NOT_READY if the state did not change
+*/
+int lis2_duty_poll(struct lis2_duty* duty, enum lis2_activity* state,
+                   uint32_t* rate_mhz);
+
+/**
+* @brief  disable the duty cycling and leave streaming
+* @param[in] duty duty cycling state
+* @return error code
+*/
+int lis2_duty_stop(struct lis2_duty* duty);
+
+///registry sensor: output data rate of the FIFO stream
+#define LIS2_SENSOR_ODR                      LIS2_ODR_100HZ
+///registry sensor: FIFO watermark, half of it
+#define LIS2_SENSOR_WATERMARK                (LIS2DW12_FIFO_DEPTH / 2)
+///registry sensor: wake-up threshold, 62.5 mg
+#define LIS2_SENSOR_WAKE_THS                 2
+///registry sensor: inactivity before sleeping, 512/ODR, 5.12 s at 100 Hz
+#define LIS2_SENSOR_SLEEP_DUR                1
+
+/**
+* @brief  registry descriptor: x, y, z, rate
+* @details streams through the FIFO at LIS2_SENSOR_ODR and drops to 12.5 Hz
+*          while still, see lis2_duty_start(); its ctx is a struct lis2_duty.
+*          Each collect drains every stored sample, one record each; rate is
+*          the effective output data rate, so a row whose rate differs from
+*          the previous one marks an activity transition
+*/
+extern const struct sensor_driver lis2_driver;
+
+/**
+* @brief  print the FIFO and activity counters of a registry LIS2DW12
+* @param[in] sensor registry sensor of lis2_driver
+* @param[in] out stream to print to
+*/
+void lis2_sensor_report(const struct sensor* sensor, FILE* out);
 
 #endif //LIS2_H
\ No newline at end of file
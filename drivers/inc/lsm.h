@@ -183,25 +183,6 @@
  */
 int lsm_init(int* bus, char* block_device);
 
-/**
- * @brief Read from sensor
- * @note message is read @ reg->data
- * @param[in] bus bus file descriptor
- * @param[inout] reg register to read
- * @return error code
- */
-static inline int lsm_read(int* bus, dev_reg* reg);
-
-/**
- * @brief Write to sensor
- * @note message writes as reg->data;
- * you only have REGISTER_DATA_SIZE-1 available
- * @param[in] bus bus file descriptor
- * @param[in] reg register to write
- * @return error code
- */
-static inline int lsm_write(int* bus, dev_reg* reg);
-
 /**
  * @brief Activate accelerometer and gyroscope
  * @param[in] bus bus file descriptor
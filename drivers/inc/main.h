@@ -7,6 +7,7 @@
  */
 
 #include "common.h"
+#include "sensor.h"
 #include "error.h"
 #include "pi4.h"
 #include "lsm.h"
@@ -9,7 +9,16 @@
 #ifndef MLX_H
 #define MLX_H
 
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#include "common.h"
+#include "sensor.h"
+
 #define MLX_EE_I2C_ADDRESS 0x24d5 /**< I2C address register initial value */
+#define MLX_EE_ID0         0x2405 /**< Chip ID, 3 words, unique per sensor */
+#define MLX_ID_WORDS       3      /**< Chip ID length [words] */
 
 /* is taken after power-up or reset */
 /* Register addresses - volatile */
@@ -21,18 +30,20 @@
 #define MLX_MAX_NUMBER_MESUREMENT_READ_TRIES 100 /**< Maximum number of read tries before quiting with timeout error */
 
 #define MLX_REG_STATUS     0x3fff /**< address of MLX_REG_STATUS */
-/* 
-typedef struct
-{
-  uint8_t data_rdy                          : 1;
-  uint8_t not_to_use                        : 1;
-  uint8_t cycle_pos                         : 5;
-  uint8_t brown_out                         : 1;
-  uint8_t eeprom_busy                       : 1;
-  uint8_t device_busy                       : 1;
-  uint8_t not_to_use1                       : 5;
-} mlx_reg_stat_t; 
-*/
+#define MLX_STAT_DATA_RDY  0x0001 /**< NEW_DATA, a measurement has been stored in RAM */
+#define MLX_STAT_CYCLE_POS 0x007c /**< cycle_pos, measurement that was stored last */
+#define MLX_STAT_BROWN_OUT 0x0100 /**< brown out, the sensor was reset */
+#define MLX_STAT_EE_BUSY   0x0200 /**< EEPROM busy */
+#define MLX_STAT_BUSY      0x0400 /**< device busy, measurement in progress */
+
+#define MLX_CTRL_MODE      0x0006 /**< mode[2:1] of MLX_REG_CTRL, see enum mlx_mode */
+#define MLX_CTRL_SOB       0x0800 /**< start of burst, one pass of the measurement table */
+
+#define MLX_EE_MEAS_1      0x24e1 /**< Measurement 1 settings */
+#define MLX_EE_REFRESH     0x0700 /**< refresh rate[10:8], 2 s >> rate per measurement */
+#define MLX_MEAS_MAX_TIME  2000000 /**< measurement time at refresh rate 0 [us] */
+
+#define MLX_BANK_WORDS     3      /**< RAM words of one measurement: 2 object, 1 ambient */
 
 #define POW 10000000000LL  /**< Calculation accuracy factor */
 
@@ -58,6 +69,25 @@ typedef struct
 #define MLX_EE_Ha      0x2481 /**< Ha customer calibration value register 16bit */
 #define MLX_EE_Hb      0x2482 /**< Hb customer calibration value register 16bit */
 
+/** P_R up to Ka, read in one burst [words] */
+#define MLX_EE_CALIB_WORDS (MLX_EE_Ka - MLX_EE_P_R + 1)
+/** Ha and Hb, read in one burst [words] */
+#define MLX_EE_H_WORDS     (MLX_EE_Hb - MLX_EE_Ha + 1)
+
+/** directory of the calibration cache files, one per chip ID */
+#define MLX_CACHE_DIR      "/var/tmp"
+/** calibration cache file tag, "MLXC" */
+#define MLX_CACHE_MAGIC    0x43584C4D
+
+/**
+* @brief  operating modes, value of the mode field of MLX_REG_CTRL
+*/
+enum mlx_mode
+{
+  MLX_MODE_SLEEPING_STEP = 0x0002, /**< one pass of the table per trigger, then sleep */
+  MLX_MODE_CONTINUOUS = 0x0006     /**< measures all the time */
+};
+
 /* Memory sections addresses */
 #define MLX_ADDR_RAM   0x4000 /**< Start address of ram */
 
@@ -70,29 +100,106 @@ typedef struct
 #define MLX_REF_12 12.0f /**< ResCtrlRef value of Channel 1 or Channel 2 */
 #define EMISSIVITY 1.0f
 
-/*
-struct pmt parameter =
+#define MLX_ITERATIONS  5       /**< object temperature iterations, at most */
+#define MLX_CONVERGENCE 0.001f  /**< fast path stops below this change [°C] */
+#define MLX_BATCH_LANES 8       /**< samples compensated side by side */
+
+/**
+* @struct mlx_calib
+* @brief  calibration constants from the EEPROM, signed as stored
+*/
+struct mlx_calib
 {
-  PR 
-  PG 
-  PT 
-  PO 
-  Ea 
-  Eb 
-  Fa 
-  Fb 
-  Ga 
-  Ha 
-  Hb 
-  Gb 
-  Ka 
-} ;
+  int32_t P_R;
+  int32_t P_G;
+  int32_t P_T;
+  int32_t P_O;
+  int32_t Ea;
+  int32_t Eb;
+  int32_t Fa;
+  int32_t Fb;
+  int32_t Ga;
+  int16_t Gb;
+  int16_t Ka;
+  int16_t Ha;
+  int16_t Hb;
+};
+
+/**
+* @struct mlx_terms
+* @brief  calibration terms of the compensation, computed once per device
+* @var kEa Ea / 2^16
+* @var kEb Eb / 2^8
+* @var kGb Gb / 2^10
+* @var kKa Ka / 2^10
+* @var fa_ha Fa * Ha / 2^14 / 2^46, sensitivity before the Ga and Fb correction
+* @var ga Ga / 2^36
+* @var fb Fb / 2^36
+* @var hb Hb / 2^10
 */
+struct mlx_terms
+{
+  float kEa;
+  float kEb;
+  float kGb;
+  float kKa;
+  float fa_ha;
+  float ga;
+  float fb;
+  float hb;
+};
 
-/* is taken after power-up or reset */
-/* Control register address - volatile */
-#define MLX_REG_CTRL   0x3001 /**< Control Register address */
-/*
+/**
+* @struct mlx_raw
+* @brief  raw values of one measurement
+* @note the RAM words are two's complement, an object colder than the
+* sensor reads negative
+*/
+struct mlx_raw
+{
+  int16_t ambient_new;
+  int16_t ambient_old;
+  int16_t object_new;
+  int16_t object_old;
+};
+
+/**
+* @struct mlx
+* @brief  one MLX90632 with its calibration
+* @var slave bus and address of the sensor
+* @var id chip ID, keys the calibration cache file
+* @var calib calibration constants
+* @var terms compensation terms derived from calib
+* @var lock guards calib and terms against the background validation
+* @var mode operating mode
+* @var period_us duration of one measurement of the table [us]
+* @var next_us when the next result is expected, CLOCK_MONOTONIC [us]
+* @var bank RAM of measurement 1 and 2, as last read
+* @var fresh bit per bank, set once it has been read
+* @var busy a sleeping step burst is running
+* @var validator thread re-reading the EEPROM when calib came from the cache
+* @var validating validator is running or has to be joined
+* @var open lock is initialized, until mlx_close
+*/
+struct mlx
+{
+  i2c_slave slave;
+  uint16_t id[MLX_ID_WORDS];
+  struct mlx_calib calib;
+  struct mlx_terms terms;
+  pthread_mutex_t lock;
+  pthread_t validator;
+  int validating;
+  int open;
+  enum mlx_mode mode;
+  uint32_t period_us;
+  uint64_t next_us;
+  uint16_t bank[2][MLX_BANK_WORDS];
+  uint8_t fresh;
+  uint8_t busy;
+};
+
+/* MLX_REG_CTRL
 typedef struct
 {
   uint8_t not_to_use                        : 1;
@@ -107,50 +214,68 @@ typedef struct
 
 
 /**
-* @brief  Calibration parameters which are read from EEPROM and used for temperature calculation
-* @param[inout] Ea register data
-* @param[inout] Eb register data
-* @param[inout] Fa register data
-* @param[inout] Fb register data
-* @param[inout] Ga register data
-* @param[inout] Gb register data
-* @param[inout] Ha register data
-* @param[inout] Hb register data
-* @param[inout] Ka register data
+* @brief  read every calibration constant, in two bursts
+* @param[in] slave bus and address of the sensor
+* @param[out] calib calibration constants
+* @return error code
 */
-uint mlx_read_eeprom(uint8_t dev, uint32_t Ea, uint32_t Eb, uint32_t Fa, uint32_t Fb, uint32_t Ga, 
-        uint16_t Gb, uint16_t Ha, uint16_t Hb, uint16_t Ka);
+int mlx_read_calib(const i2c_slave *slave, struct mlx_calib *calib);
 
 /**
-* @brief  read ambient raw data
-* @param[inout] ambient_new_raw data from the new scan
-* @param[inout] ambient_old_raw data from the old scan
+* @brief  identify the sensor and load its calibration
+* @details the calibration comes from the cache file of the chip ID when
+*          there is one, and is then re-read from the EEPROM in the
+*          background; otherwise it is read now and the cache file written;
+*          a state still open is closed first, not while it is in use
+* @param[out] mlx sensor state
+* @param[in] dev device file
+* @param[in] addr sensor address
+* @return error code
 */
-uint32_t mlx_read_ambient_raw(uint8_t dev, uint16_t *ambient_new_raw, uint16_t *ambient_old_raw);
+int mlx_init(struct mlx *mlx, uint8_t dev, uint8_t addr);
 
 /**
-* @brief  read object raw data
-* @param[inout] object_new_raw data from the new scan
-* @param[inout] object_old_raw data from the old scan
+* @brief  wait for the background validation and release the sensor state
+* @param[inout] mlx sensor state
 */
-uint32_t mlx_read_object_raw(uint8_t dev, uint16_t *object_new_raw, uint16_t *object_old_raw);
+void mlx_close(struct mlx *mlx);
 
 /**
-* @brief  check the register MLX_REG_STATUS
-* @return 
-*     @retval  rtn  cycle position of register REG_STATUS
+* @brief  switch between continuous and sleeping step mode
+* @param[inout] mlx sensor state
+* @param[in] mode new mode
+* @return error code
+*/
+int mlx_set_mode(struct mlx *mlx, enum mlx_mode mode);
+
+/**
+* @brief  check for a new measurement, without waiting
+* @details nothing is read before the refresh period has passed; then
+*          MLX_REG_STATUS is read and, on NEW_DATA, only the RAM bank of the
+*          measurement that was just stored (cycle_pos) is read; in sleeping
+*          step mode both banks are read in one burst after the table pass
+*          and the next pass is triggered
+* @param[inout] mlx sensor state
+* @param[out] cycle_pos measurement stored last, 1 or 2
+* @return error code, ERROR_DATA_NOT_READY if there is nothing new
+*/
+int mlx_start_measurement(struct mlx *mlx, uint8_t *cycle_pos);
+
+/**
+* @brief  raw values of the newest complete measurement
+* @param[inout] mlx sensor state
+* @param[out] raw raw values
+* @return error code, ERROR_DATA_NOT_READY if there is nothing new
 */
-void mlx_start_measurement(uint8_t dev, uint8_t meas_rtn);
+int mlx_read_temp_raw(struct mlx *mlx, struct mlx_raw *raw);
 
 /**
-* @brief initiate the function mlx_read_ambient_raw and the function mlx_read_object_raw
-* @param[inout] ambient_new_raw data from the new scan
-* @param[inout] ambient_old_raw data from the old scan
-* @param[inout] object_new_raw data from the new scan
-* @param[inout] object_old_raw data from the old scan
+* @brief  object temperature of a new measurement, without waiting
+* @param[inout] mlx sensor state
+* @param[out] object object temperature [°C]
+* @return error code, ERROR_DATA_NOT_READY if there is nothing new
 */
-uint32_t mlx_read_temp_raw(uint8_t dev, uint16_t *ambient_new_raw, uint16_t *ambient_old_raw,
-    uint16_t *object_new_raw, uint16_t *object_old_raw);
+int mlx_poll(struct mlx *mlx, double *object);
 
 /**
 * @brief  preprocess of the ambient temperature
@@ -161,7 +286,7 @@ uint32_t mlx_read_temp_raw(uint8_t dev, uint16_t *ambient_new_raw, uint16_t *amb
 *     @retval  precalculated ambient temperature
 */
 double mlx_preprocess_temp_ambient(uint16_t ambient_new_raw, 
-    uint16_t ambient_old_raw, uint16_t Gb);
+    uint16_t ambient_old_raw, int16_t Gb);
 
 /**
 * @brief  preprocess of the object temperature
@@ -173,7 +298,7 @@ double mlx_preprocess_temp_ambient(uint16_t ambient_new_raw,
 *     @retval  precalculated object temperature
 */
 double mlx_preprocess_temp_object(uint16_t object_new_raw, uint16_t object_old_raw,
-    uint16_t ambient_new_raw, uint16_t ambient_old_raw,uint32_t Ka);
+    uint16_t ambient_new_raw, uint16_t ambient_old_raw, int16_t Ka);
 
 /**
 * @brief  iteration calculate object temperature
@@ -188,8 +313,8 @@ double mlx_preprocess_temp_object(uint16_t object_new_raw, uint16_t object_old_r
 * @return 
 *     @retval  iterated object temperature
 */
-double  mlx_calc_temp_object_iteration(double prev_object_temp, uint32_t object, 
-    double TAdut, uint32_t Ga, uint32_t Fa, uint32_t Fb, uint16_t Ha, uint16_t Hb);
+double  mlx_calc_temp_object_iteration(double prev_object_temp, int32_t object, 
+    double TAdut, int32_t Ga, int32_t Fa, int32_t Fb, int16_t Ha, int16_t Hb);
 
 
 /**
@@ -211,15 +336,52 @@ double  mlx_calc_temp_object_iteration(double prev_object_temp, uint32_t object,
 * @return 
 *     @retval temp final object temperature
 */
-double mlx_calc_temp_object(uint32_t object, uint32_t ambient,
-    uint32_t Ea, uint32_t Eb, uint32_t Ga, uint32_t Fa, uint32_t Fb,
-    uint16_t Ha, uint16_t Hb);
+double mlx_calc_temp_object(int32_t object, int32_t ambient,
+    int32_t Ea, int32_t Eb, int32_t Ga, int32_t Fa, int32_t Fb,
+    int16_t Ha, int16_t Hb);
+
+/**
+* @brief  derive the compensation terms from the calibration constants
+* @param[in] calib calibration constants
+* @param[out] terms compensation terms
+*/
+void mlx_calc_terms(const struct mlx_calib *calib, struct mlx_terms *terms);
 
 /**
-* @brief  initiate measurement 
+* @brief  object temperature, single precision
+* @details same model as mlx_calc_temp_object, with the calibration terms
+*          and TAdut^4 taken out of the iteration; stops once an iteration
+*          changes the result by less than MLX_CONVERGENCE
+* @param[in] terms compensation terms
+* @param[in] raw raw values
 * @return 
-*     @retval object final object temperature
+*     @retval object temperature [°C]
+*/
+float mlx_compensate(const struct mlx_terms *terms, const struct mlx_raw *raw);
+
+/**
+* @brief  object temperature of many measurements
+* @details MLX_BATCH_LANES samples are processed together in loops the
+*          compiler can vectorize (-O3, -fno-math-errno); a group iterates
+*          until all of its samples have converged
+* @param[in] terms compensation terms
+* @param[in] raw raw values
+* @param[out] object object temperatures [°C]
+* @param[in] n number of measurements
+*/
+void mlx_compensate_batch(const struct mlx_terms *terms, const struct mlx_raw raw[],
+    float object[], size_t n);
+
+/**
+* @brief  wait for the next measurement
+* @details sleeps until the time the result is due, see mlx_poll
+* @param[inout] mlx sensor state, from mlx_init
+* @param[out] object final object temperature
+* @return error code
 */
-void mlx_measure(uint8_t dev, double object);
+int mlx_measure(struct mlx *mlx, double *object);
+
+/** registry descriptor, ctx points to a struct mlx: object */
+extern const struct sensor_driver mlx_driver;
 
 #endif //MLX_H
\ No newline at end of file
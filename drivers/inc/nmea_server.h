@@ -0,0 +1,114 @@
+/**
+ * @file nmea_server.h
+ * @author  Jie Liu
+ * @version V1.0
+ * @date    2026-10-18
+ * @brief Local fan-out of the GNSS module to several processes
+ * @note The server owns the UART, parses every message once and publishes
+ * the raw messages and the decoded fixes on two Unix stream sockets.
+ */
+
+#ifndef NMEA_SERVER_H
+#define NMEA_SERVER_H
+
+#include <stdint.h>
+
+#include "gnss.h"
+
+/** default socket publishing the raw NMEA messages */
+#define NMEA_SERVER_RAW_SOCKET "/tmp/rss_nmea.sock"
+/** default socket publishing the decoded fixes, one text line per fix */
+#define NMEA_SERVER_FIX_SOCKET "/tmp/rss_fix.sock"
+/** maximum number of clients, over both sockets */
+#define NMEA_SERVER_MAX_CLIENTS 16
+/**
+ * bytes queued for a single client [bytes]; a client that lets its queue
+ * fill up is disconnected, so it cannot stall the others
+ */
+#define NMEA_SERVER_CLIENT_BUFFER 8192
+/** longest line published on either socket [chars] */
+#define NMEA_SERVER_LINE_SIZE 128
+
+/** what a client is subscribed to */
+enum nmea_channel {
+    NMEA_CHANNEL_RAW, /// raw NMEA messages
+    NMEA_CHANNEL_FIX  /// decoded fixes
+};
+
+/**
+ * @struct nmea_client
+ * @brief connected client with its pending output
+ * @var fd socket, -1 if the slot is free
+ * @var channel what the client is subscribed to
+ * @var head first pending byte in buffer
+ * @var tail one past the last pending byte in buffer
+ * @var buffer pending output
+ */
+struct nmea_client {
+    int fd;
+    enum nmea_channel channel;
+    size_t head;
+    size_t tail;
+    char buffer[NMEA_SERVER_CLIENT_BUFFER];
+};
+
+/**
+ * @struct nmea_server
+ * @brief server state
+ * @var uart GNSS device file
+ * @var listener listening sockets, indexed by enum nmea_channel
+ * @var path socket paths, indexed by enum nmea_channel
+ * @var stream partial messages received from the UART
+ * @var fix last decoded fix
+ * @var clients client slots
+ * @var running cleared by nmea_server_stop()
+ * @var dropped number of clients disconnected for lagging behind
+ */
+struct nmea_server {
+    int uart;
+    int listener[2];
+    const char* path[2];
+    struct nmea_stream stream;
+    struct gnss_fix fix;
+    struct nmea_client clients[NMEA_SERVER_MAX_CLIENTS];
+    volatile int running;
+    uint32_t dropped;
+};
+
+/**
+ * @brief Open the GNSS module and both sockets
+ * @note stale socket files are removed
+ * @param[out] server server state
+ * @param[in] block_device absolute path to the GNSS block device
+ * @param[in] raw_path socket path for raw messages
+ * @param[in] fix_path socket path for decoded fixes
+ * @return error code
+ */
+int nmea_server_open(struct nmea_server* server, char* block_device,
+        const char* raw_path, const char* fix_path);
+
+/**
+ * @brief Serve clients until nmea_server_stop() is called or the UART is lost
+ * @note everything parsed from one UART read is queued first and then sent
+ * with a single write per client
+ * @param[inout] server server state
+ * @return error code
+ */
+int nmea_server_run(struct nmea_server* server);
+
+/**
+ * @brief Make nmea_server_run() return
+ * @note async-signal-safe
+ * @param[inout] server server state
+ */
+void nmea_server_stop(struct nmea_server* server);
+
+/**
+ * @brief Disconnect every client, close the sockets and the GNSS module
+ * @param[inout] server server state
+ */
+void nmea_server_close(struct nmea_server* server);
+
+#endif /* NMEA_SERVER_H */
+
+// vim: expandtab ts=4 sw=4
@@ -61,6 +61,23 @@ int pi4_set_channel(int* bus, uint8_t* mask);
  */
 int pi4_get_channel(int* bus, uint8_t* mask);
 
+/**
+ * @brief set the channels unless they are set already
+ * @note the last mask written is remembered, so only a change costs a write
+ * (and the read-back of PI4_CHECK_WRITE); a change drops the register cache
+ * of the bus, the same address may now be another device
+ * @param[in] bus device file
+ * @param[in] mask bit mask of the channels to enable
+ * @return error code
+ */
+int pi4_select(int bus, uint8_t mask);
+
+/**
+ * @brief number of channel writes pi4_select() had to do
+ * @return count since start
+ */
+uint32_t pi4_switches(void);
+
 /**
  * @brief turn every slave on
  * @note this only enables all the channels used **in raspi-sensor-shield**
@@ -0,0 +1,111 @@
+/**
+ * @file regcache.h
+ * @author  Jie Liu
+ * @version V1.0
+ * @date    2026-10-18
+ * @brief Shadow of the configuration registers of every I2C slave
+ * @note The shadow remembers the last value written per (bus, slave,
+ * register). Writes that would not change anything are dropped, and
+ * read-modify-write sequences are done with at most one write. Registers
+ * the slave changes on its own, or where a write starts something (trigger,
+ * reset), have to be marked volatile; they are always passed through.
+ * Reads only come from the shadow when every requested register has been
+ * written before and none is volatile. Register contents that were only
+ * read are never cached, so data registers stay live. Every call is
+ * thread-safe; writes through the shadow are serialized.
+ */
+
+#ifndef REGCACHE_H
+#define REGCACHE_H
+
+#include <stdint.h>
+
+#include "common.h"
+
+/** number of slaves with a shadow, over every bus */
+#define REGCACHE_MAX_DEVICES 8
+/** matches every slave address in regcache_invalidate() */
+#define REGCACHE_ANY_ADDR 0xFF
+
+/**
+ * @brief  same as i2c_write, through the shadow
+ * @note the slave is the one last selected on the bus, see i2c_set_address()
+ * @param[in] reg_addr first register address, auto increment
+ * @param[in] reg_data data to be written into the registers
+ * @param[in] len length of data
+ * @param[in] intf_ptr uint8_t * bus device file
+ * @return success or not
+ *     @retval 0 success or nothing to write
+ *     @retval 1 not success
+ */
+int8_t regcache_write(uint8_t reg_addr, const uint8_t *reg_data, uint32_t len, void *intf_ptr);
+
+/**
+ * @brief  same as i2c_read_8bit, through the shadow
+ * @param[in] reg_addr first register address, auto increment
+ * @param[out] reg_data data read from the registers
+ * @param[in] len length of data
+ * @param[in] intf_ptr uint8_t * bus device file
+ * @return success or not
+ *     @retval 0 success
+ *     @retval 1 not success
+ */
+int8_t regcache_read(uint8_t reg_addr, uint8_t *reg_data, uint32_t len, void *intf_ptr);
+
+/**
+ * @brief  same as i2c_slave_write, through the shadow
+ * @note for the Bosch API: above one register the data interleaves addresses
+ * and values, reg_data = {val0, reg1, val1, reg2, val2, ...}; unchanged
+ * pairs are left out of the transfer
+ * @param[in] reg_addr first register address
+ * @param[in] reg_data values, interleaved with the next addresses
+ * @param[in] len length of data
+ * @param[in] intf_ptr i2c_slave *
+ * @return success or not
+ *     @retval 0 success or nothing to write
+ *     @retval 1 not success
+ */
+int8_t regcache_slave_write(uint8_t reg_addr, const uint8_t *reg_data, uint32_t len, void *intf_ptr);
+
+/**
+ * @brief  same as i2c_slave_read, through the shadow
+ * @param[in] reg_addr first register address, auto increment
+ * @param[out] reg_data data read from the registers
+ * @param[in] len length of data
+ * @param[in] intf_ptr i2c_slave *
+ * @return success or not
+ *     @retval 0 success
+ *     @retval 1 not success
+ */
+int8_t regcache_slave_read(uint8_t reg_addr, uint8_t *reg_data, uint32_t len, void *intf_ptr);
+
+/**
+ * @brief  change some bits of a register
+ * @note the register is read from the slave only if it is not in the shadow,
+ * and written only if the value changes
+ * @param[in] slave slave owning the register
+ * @param[in] reg_addr register address
+ * @param[in] mask bits to change
+ * @param[in] value new value of the masked bits
+ * @return error code
+ */
+int regcache_update(const i2c_slave *slave, uint8_t reg_addr, uint8_t mask, uint8_t value);
+
+/**
+ * @brief  always pass a register through to the slave
+ * @param[in] slave slave owning the register
+ * @param[in] reg_addr register address
+ */
+void regcache_set_volatile(const i2c_slave *slave, uint8_t reg_addr);
+
+/**
+ * @brief  forget the shadow, after a reset or a bus recovery
+ * @note volatile markings are kept
+ * @param[in] fd bus device file
+ * @param[in] addr slave address, REGCACHE_ANY_ADDR for the whole bus
+ */
+void regcache_invalidate(uint8_t fd, uint8_t addr);
+
+#endif /* REGCACHE_H */
+
+// vim: expandtab ts=4 sw=4
@@ -0,0 +1,85 @@
+/**
+ * @file ring.h
+ * @author  Jie Liu
+ * @version V1.0
+ * @date    2026-10-18
+ * @brief Lock-free single producer, single consumer ring of fixed-size records
+ * @note One thread pushes, one other thread pops; neither ever blocks. A
+ * push into a full ring drops the record and counts it, so a stalled
+ * consumer cannot hold up acquisition.
+ */
+
+#ifndef RING_H
+#define RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+/** keeps the producer and consumer indices on separate cache lines [bytes] */
+#define RING_CACHE_LINE 64
+
+/**
+ * @struct ring
+ * @brief ring state
+ * @var data depth records of size bytes
+ * @var size bytes per record
+ * @var mask depth - 1, depth is a power of two
+ * @var head next record to write, owned by the producer
+ * @var high_water highest fill level seen by the producer
+ * @var drops records dropped because the ring was full
+ * @var tail next record to read, owned by the consumer
+ */
+struct ring {
+    uint8_t* data;
+    size_t size;
+    uint32_t mask;
+    _Alignas(RING_CACHE_LINE) atomic_uint head;
+    atomic_uint high_water;
+    atomic_uint drops;
+    _Alignas(RING_CACHE_LINE) atomic_uint tail;
+};
+
+/**
+ * @brief Allocate an empty ring
+ * @param[out] ring ring state
+ * @param[in] depth number of records, a power of two
+ * @param[in] size bytes per record
+ * @return error code
+ */
+int ring_init(struct ring* ring, uint32_t depth, size_t size);
+
+/**
+ * @brief Release the records
+ * @param[inout] ring ring state
+ */
+void ring_free(struct ring* ring);
+
+/**
+ * @brief Append a record, producer side
+ * @param[inout] ring ring state
+ * @param[in] record size bytes
+ * @return error code, ERROR_MAX_BUFFER_SIZE_REACHED if the ring was full and
+ * the record dropped
+ */
+int ring_push(struct ring* ring, const void* record);
+
+/**
+ * @brief Take up to max records in one go, consumer side
+ * @param[inout] ring ring state
+ * @param[out] records room for max records
+ * @param[in] max maximum number of records
+ * @return number of records taken
+ */
+uint32_t ring_pop(struct ring* ring, void* records, uint32_t max);
+
+/**
+ * @brief Number of records waiting, a snapshot
+ * @param[in] ring ring state
+ * @return fill level
+ */
+uint32_t ring_level(struct ring* ring);
+
+#endif /* RING_H */
+
+// vim: expandtab ts=4 sw=4
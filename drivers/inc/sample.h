@@ -0,0 +1,69 @@
+/**
+ * @file sample.h
+ * @author  Jie Liu
+ * @version V1.0
+ * @date    2026-10-18
+ * @brief Fixed-layout binary sample record, from decode to export
+ * @note A record is one schema row of a sensor as scaled integers: column i
+ * is value[i] * 10^exponent in the unit of the driver's field i. The rings
+ * carry undecoded results (struct writer_entry); the writer thread decodes
+ * each into records with sample_decode() and exports them right away, text
+ * is only produced by sample_format() there.
+ */
+
+#ifndef SAMPLE_H
+#define SAMPLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "sensor.h"
+
+/** channels of a record, the widest schema (BME) */
+#define SAMPLE_MAX_CHANNELS 8
+/** records one collect can decode to, a full LIS2DW12 FIFO */
+#define SAMPLE_MAX_RECORDS 32
+
+/**
+ * @struct sample_record
+ * @brief one measurement, 44 bytes, host byte order
+ * @var stamp_ns time of the collect, CLOCK_MONOTONIC [ns], see timestamp.h
+ * @var sensor enum sensor_id
+ * @var channels used entries of value
+ * @var reserved zero, keeps value aligned
+ * @var value scaled integers, see the driver's schema
+ */
+struct __attribute__ ((__packed__)) sample_record {
+    uint64_t stamp_ns;
+    uint8_t sensor;
+    uint8_t channels;
+    uint16_t reserved;
+    int32_t value[SAMPLE_MAX_CHANNELS];
+};
+
+_Static_assert(sizeof(struct sample_record) == 44, "sample_record layout changed");
+
+/**
+ * @brief Decode a collected result into records
+ * @param[in] sensor sensor the result came from
+ * @param[in] raw undecoded result
+ * @param[out] records one per result in raw
+ * @param[out] n_records number of records
+ * @return error code
+ */
+int sample_decode(const struct sensor* sensor, const struct sensor_raw* raw,
+        struct sample_record records[SAMPLE_MAX_RECORDS], uint8_t* n_records);
+
+/**
+ * @brief Export a record as comma separated values, without line end
+ * @note the exponent of the schema becomes the decimal point
+ * @param[in] record record
+ * @param[out] str text
+ * @param[in] len max str length
+ * @return error code, ERROR_INVALID_BUFFER_SIZE if str was too short
+ */
+int sample_format(const struct sample_record* record, char* str, size_t len);
+
+#endif /* SAMPLE_H */
+
+// vim: expandtab ts=4 sw=4
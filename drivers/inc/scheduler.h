@@ -0,0 +1,254 @@
+/**
+ * @file scheduler.h
+ * @author  Jie Liu
+ * @version V1.0
+ * @date    2026-10-18
+ * @brief Multi-rate acquisition scheduler on absolute deadline timerfds
+ * @note Every periodic task owns a CLOCK_MONOTONIC timerfd armed once with
+ * an absolute first deadline and its period. The kernel keeps the deadlines
+ * on that grid, so a late run does not shift the next one and long runs do
+ * not drift. Expirations that pass while a task is still waiting to run are
+ * counted as overruns. Tasks can also run on data, when a file descriptor
+ * (e.g. the GNSS UART) becomes readable. Typical periods: LSM FIFO 1 ms,
+ * LIS2 FIFO 10 ms, APDS 100 ms, BME 3 s, GNSS on data.
+ * scheduler_start() runs the loop on its own thread, optionally real-time:
+ * SCHED_FIFO, memory locked, pinned to one core (best one isolated with
+ * isolcpus=), on a stack allocated and touched up front. Every run adds its
+ * wake up latency against the deadline to a log2 histogram, see
+ * scheduler_histogram().
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "sensor.h"
+
+/** maximum number of tasks of a scheduler */
+#define SCHEDULER_MAX_TASKS 16
+/** poll timeout, bounds how long scheduler_stop() takes effect [ms] */
+#define SCHEDULER_POLL_TIMEOUT 500
+/** latency histogram buckets: < 1 us, then [2^(i-1), 2^i) us, the last is open */
+#define SCHEDULER_LATENCY_BUCKETS 20
+/** stack of the scheduler thread when none is given [bytes] */
+#define SCHEDULER_STACK_SIZE (256 * 1024)
+
+/**
+ * @brief task body
+ * @param[inout] arg task argument
+ * @param[in] deadline_us deadline of this run, CLOCK_MONOTONIC [us]; the
+ *            time of the wake up for tasks on data
+ * @return error code, counted but not fatal
+ */
+typedef int (*scheduler_fn)(void* arg, uint64_t deadline_us);
+
+/** what wakes a task up */
+enum scheduler_kind {
+    SCHEDULER_PERIODIC, /// timerfd expiration
+    SCHEDULER_ON_DATA   /// readable file descriptor
+};
+
+/**
+ * @struct scheduler_task
+ * @brief one task with its statistics
+ * @var name name in the report
+ * @var kind what wakes the task up
+ * @var fd timerfd, or the watched file descriptor
+ * @var period_us period [us], 0 for tasks on data
+ * @var deadline_us deadline of the last run [us]
+ * @var run task body
+ * @var arg task argument
+ * @var runs number of runs
+ * @var overruns expirations that passed without a run of their own
+ * @var errors runs that did not return EXIT_SUCCESS
+ * @var late_max_us largest delay from deadline to run [us]
+ * @var late_sum_us sum of the delays, for the mean [us]
+ * @var latency histogram of the delays, see SCHEDULER_LATENCY_BUCKETS
+ * @var group bus setting the task needs (PI4 channel mask), 0 if none
+ */
+struct scheduler_task {
+    const char* name;
+    enum scheduler_kind kind;
+    int fd;
+    uint32_t period_us;
+    uint64_t deadline_us;
+    scheduler_fn run;
+    void* arg;
+    uint64_t runs;
+    uint64_t overruns;
+    uint32_t errors;
+    uint32_t late_max_us;
+    uint64_t late_sum_us;
+    uint32_t latency[SCHEDULER_LATENCY_BUCKETS];
+    uint8_t group;
+};
+
+/**
+ * @struct scheduler_rt
+ * @brief how the scheduler thread runs
+ * @var priority SCHED_FIFO priority 1 to 99, 0 keeps the ordinary policy
+ * @var cpu core the thread is pinned to, -1 for any
+ * @var stack_size stack to preallocate [bytes], 0 for SCHEDULER_STACK_SIZE
+ * @var lock_memory mlockall() the process, no page fault while running
+ */
+struct scheduler_rt {
+    int priority;
+    int cpu;
+    size_t stack_size;
+    uint8_t lock_memory;
+};
+
+/**
+ * @struct scheduler
+ * @brief scheduler state
+ * @var tasks tasks, in the order they were added
+ * @var n_tasks number of tasks
+ * @var start_us time of scheduler_init(), every first deadline is relative to it
+ * @var running cleared by scheduler_stop()
+ * @var group group of the last task run that had one
+ * @var thread thread of scheduler_start()
+ * @var stack its preallocated stack
+ * @var result what scheduler_run() returned on it
+ */
+struct scheduler {
+    struct scheduler_task tasks[SCHEDULER_MAX_TASKS];
+    size_t n_tasks;
+    uint64_t start_us;
+    volatile int running;
+    uint8_t group;
+    pthread_t thread;
+    void* stack;
+    int result;
+};
+
+/**
+ * @struct scheduler_sensor
+ * @brief registry sensor driven by a periodic task
+ * @note each run collects the result of the previous trigger and triggers
+ * the next conversion, so the conversion overlaps the period
+ * @var sensor active sensor
+ * @var sink called with every collected result, decode it there or later
+ * @var sink_arg argument of sink
+ * @var pending a conversion was triggered
+ */
+struct scheduler_sensor {
+    struct sensor* sensor;
+    void (*sink)(const struct sensor* sensor, const struct sensor_raw* raw, void* arg);
+    void* sink_arg;
+    uint8_t pending;
+};
+
+/**
+ * @brief Start with no task
+ * @param[out] sched scheduler state
+ */
+void scheduler_init(struct scheduler* sched);
+
+/**
+ * @brief Add a task running at a fixed rate
+ * @param[inout] sched scheduler state
+ * @param[in] name name in the report
+ * @param[in] period_us period [us]
+ * @param[in] phase_us first deadline after scheduler_init() [us], spreads tasks
+ *            of the same period
+ * @param[in] run task body
+ * @param[in] arg task argument
+ * @return error code
+ */
+int scheduler_add_periodic(struct scheduler* sched, const char* name, uint32_t period_us,
+        uint32_t phase_us, scheduler_fn run, void* arg);
+
+/**
+ * @brief Add a task running whenever a file descriptor is readable
+ * @note the task has to consume the data, or it runs again right away
+ * @param[inout] sched scheduler state
+ * @param[in] name name in the report
+ * @param[in] fd file descriptor, stays owned by the caller
+ * @param[in] run task body
+ * @param[in] arg task argument
+ * @return error code
+ */
+int scheduler_add_fd(struct scheduler* sched, const char* name, int fd, scheduler_fn run,
+        void* arg);
+
+/**
+ * @brief Add a periodic task driving a registry sensor
+ * @note the task is grouped with the other tasks of the sensor's mux setting
+ * @param[inout] sched scheduler state
+ * @param[inout] task sensor and sink, has to stay valid while running
+ * @param[in] period_us period [us]
+ * @param[in] phase_us first deadline after scheduler_init() [us]
+ * @return error code
+ */
+int scheduler_add_sensor(struct scheduler* sched, struct scheduler_sensor* task, uint32_t period_us,
+        uint32_t phase_us);
+
+/**
+ * @brief Run the tasks until scheduler_stop() is called
+ * @note due tasks run grouped by bus setting, the current one first, and
+ * in the order they were added within a group
+ * @param[inout] sched scheduler state
+ * @return error code
+ */
+int scheduler_run(struct scheduler* sched);
+
+/**
+ * @brief Run the tasks on a thread of their own until scheduler_stop() is called
+ * @note a real-time setting that is refused (no CAP_SYS_NICE or
+ * CAP_IPC_LOCK, no such core) is an error, nothing is started then
+ * @param[inout] sched scheduler state, tasks added
+ * @param[in] rt thread settings, NULL for an ordinary thread
+ * @return error code
+ */
+int scheduler_start(struct scheduler* sched, const struct scheduler_rt* rt);
+
+/**
+ * @brief Wait for the thread of scheduler_start() and free its stack
+ * @param[inout] sched scheduler state
+ * @return what scheduler_run() returned
+ */
+int scheduler_join(struct scheduler* sched);
+
+/**
+ * @brief Make scheduler_run() return
+ * @note async-signal-safe, may be called from a task
+ * @param[inout] sched scheduler state
+ */
+void scheduler_stop(struct scheduler* sched);
+
+/**
+ * @brief Print runs, overruns, errors and lateness of every task
+ * @param[in] sched scheduler state
+ * @param[in] stream output
+ */
+void scheduler_report(const struct scheduler* sched, FILE* stream);
+
+/**
+ * @brief Upper bound of the wake up latency of a share of the runs
+ * @param[in] task task
+ * @param[in] permille share of the runs, e.g. 990 for the 99th percentile
+ * @return upper edge of the bucket holding that run [us], UINT32_MAX if open
+ */
+uint32_t scheduler_latency(const struct scheduler_task* task, uint32_t permille);
+
+/**
+ * @brief Print the wake up latency histogram of every task
+ * @note a periodic task meets its budget while its latency stays well below
+ * its period; the 99.9th percentile against the period is printed for that
+ * @param[in] sched scheduler state
+ * @param[in] stream output
+ */
+void scheduler_histogram(const struct scheduler* sched, FILE* stream);
+
+/**
+ * @brief Close the timerfds, watched file descriptors stay open
+ * @param[inout] sched scheduler state
+ */
+void scheduler_close(struct scheduler* sched);
+
+#endif /* SCHEDULER_H */
+
+// vim: expandtab ts=4 sw=4
@@ -0,0 +1,217 @@
+/**
+ * @file sensor.h
+ * @author  Jie Liu
+ * @version V1.0
+ * @date    2026-10-18
+ * @brief Registry of the sensor drivers behind one acquisition interface
+ * @note Every driver provides a struct sensor_driver. A measurement goes
+ * through trigger, ready and collect, which touch the bus and only copy what
+ * the sensor returned into a struct sensor_raw. decode turns that into
+ * scaled integers following the driver's schema without touching the bus,
+ * so it can run later, in bulk or on another thread. Text only comes out of
+ * the export, see sample.h.
+ */
+
+#ifndef SENSOR_H
+#define SENSOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "common.h"
+
+/** collected data of one measurement [bytes], a full LIS2DW12 FIFO and its rate */
+#define SENSOR_RAW_SIZE 196
+/** decoded values of one measurement, records times fields */
+#define SENSOR_MAX_VALUES 128
+/** pause between two ready polls [us] */
+#define SENSOR_POLL_US 1000
+
+/** sensors on the shield, the former sensor_activate() indices */
+enum sensor_id {
+    SENSOR_APDS, /// light quality sensor
+    SENSOR_BME,  /// air quality sensor
+    SENSOR_LIS2, /// 3-axis accelerometer
+    SENSOR_MLX,  /// infrared thermometer
+    SENSOR_COUNT
+};
+
+/**
+ * @struct sensor_field
+ * @brief one column of a driver's output schema
+ * @var name column name
+ * @var unit unit, "" if none
+ * @var exponent decimal exponent, <= 0: the column is value * 10^exponent unit
+ */
+struct sensor_field {
+    const char* name;
+    const char* unit;
+    int8_t exponent;
+};
+
+/**
+ * @struct sensor_raw
+ * @brief what one collect returned, before decoding
+ * @var stamp_ns time of the collect, CLOCK_MONOTONIC [ns]
+ * @var records number of results, each decodes to a full schema row
+ * @var len used bytes of data
+ * @var data driver specific content
+ */
+struct sensor_raw {
+    uint64_t stamp_ns;
+    uint8_t records;
+    uint8_t len;
+    uint8_t data[SENSOR_RAW_SIZE];
+};
+
+struct sensor;
+
+/**
+ * @struct sensor_driver
+ * @brief callbacks and schema of a driver
+ * @var name short name
+ * @var fields output schema, one row per record
+ * @var n_fields number of columns
+ * @var init configure the sensor, error code
+ * @var trigger start a conversion and report when it is done [us], NULL for
+ *      free running sensors
+ * @var ready EXIT_SUCCESS once a result can be collected,
+ *      ERROR_DATA_NOT_READY otherwise; NULL if the trigger time is exact
+ * @var collect read the result into a raw record, no conversion
+ * @var decode convert a raw record into records * n_fields scaled integers,
+ *      no bus access
+ */
+struct sensor_driver {
+    const char* name;
+    const struct sensor_field* fields;
+    uint8_t n_fields;
+    int (*init)(struct sensor* sensor);
+    int (*trigger)(struct sensor* sensor, uint64_t* ready_at);
+    int (*ready)(struct sensor* sensor);
+    int (*collect)(struct sensor* sensor, struct sensor_raw* raw);
+    int (*decode)(const struct sensor* sensor, const struct sensor_raw* raw,
+                  int32_t values[SENSOR_MAX_VALUES]);
+};
+
+/**
+ * @struct sensor
+ * @brief one sensor on the shield
+ * @var id position in the registry
+ * @var driver its driver
+ * @var slave bus and address
+ * @var ctx driver state, NULL for stateless drivers
+ * @var timeout_us how long a result may be late after the trigger time,
+ *      0 for SENSOR_TIMEOUT; init may set it
+ * @var active initialized successfully
+ * @var mux PI4 channel bit the sensor is behind, 0 if on the bus itself
+ * @var mux_mask channels enabled while the sensor is used, 0 leaves the mux
+ *      alone; see sensor_plan_mux()
+ */
+struct sensor {
+    enum sensor_id id;
+    const struct sensor_driver* driver;
+    i2c_slave slave;
+    void* ctx;
+    uint32_t timeout_us;
+    uint8_t active;
+    uint8_t mux;
+    uint8_t mux_mask;
+};
+
+/**
+ * @brief  look a sensor up in the registry
+ * @param[in] id sensor
+ * @return sensor, NULL if id is unknown
+ */
+struct sensor* sensor_get(enum sensor_id id);
+
+/**
+ * @brief  initialize a sensor on a bus
+ * @param[inout] sensor sensor
+ * @param[in] fd bus device file
+ * @return error code
+ */
+int sensor_open(struct sensor* sensor, uint8_t fd);
+
+/**
+ * @brief  group the channels of the registry sensors into as few mux settings
+ *         as possible
+ * @details channels whose sensors have different addresses are enabled
+ *          together, so with no address used on two channels every sensor
+ *          is reached with one setting and the mux is never switched again;
+ *          sensors on the bus itself are reached under every setting
+ * @return number of settings, 1 if no switching is needed
+ */
+size_t sensor_plan_mux(void);
+
+/**
+ * @brief  make a sensor set up on a private copy active in the registry
+ * @details acquisition on other threads sees the sensor from its next call on
+ * @param[inout] sensor registry sensor, inactive
+ * @param[in] staged copy that went through sensor_open()
+ */
+void sensor_publish(struct sensor* sensor, const struct sensor* staged);
+
+/**
+ * @brief  start a conversion
+ * @param[inout] sensor active sensor
+ * @param[out] ready_at monotonic time when the result is due [us]
+ * @return error code
+ */
+int sensor_trigger(struct sensor* sensor, uint64_t* ready_at);
+
+/**
+ * @brief  check for a result without waiting
+ * @param[inout] sensor active sensor
+ * @return EXIT_SUCCESS, ERROR_DATA_NOT_READY or an error code
+ */
+int sensor_ready(struct sensor* sensor);
+
+/**
+ * @brief  read a result, stamped with the time of the read
+ * @details one clock read per collect, every record of it shares the stamp
+ * @param[inout] sensor active sensor
+ * @param[out] raw undecoded result
+ * @return error code, ERROR_DATA_NOT_READY if there is nothing yet
+ */
+int sensor_collect(struct sensor* sensor, struct sensor_raw* raw);
+
+/**
+ * @brief  decode a result
+ * @param[in] sensor sensor the result came from
+ * @param[in] raw undecoded result
+ * @param[out] values raw->records rows of driver->n_fields values
+ * @return error code
+ */
+int sensor_decode(const struct sensor* sensor, const struct sensor_raw* raw,
+                  int32_t values[SENSOR_MAX_VALUES]);
+
+/**
+ * @brief  trigger, wait for and collect one result
+ * @details sleeps until the trigger time, then polls ready every
+ *          SENSOR_POLL_US for up to the sensor's timeout
+ * @param[inout] sensor active sensor
+ * @param[out] raw undecoded result
+ * @return error code
+ */
+int sensor_acquire(struct sensor* sensor, struct sensor_raw* raw);
+
+/**
+ * @brief activate sensor
+ * @param[in] slave_activate sensor, enum sensor_id
+ * @param[in] dev bus file
+ */
+void sensor_activate(uint8_t slave_activate, uint8_t dev);
+
+/**
+ * @brief activate measurement
+ * @param[in] slave_activate sensor, enum sensor_id
+ * @param[in] dev bus file
+ * @param[out] str one line per record, unchanged if nothing was measured
+ * @param[in] len max str length
+ */
+void sensor_measure(uint8_t slave_activate, uint8_t dev, char* str, const size_t len);
+
+#endif /* SENSOR_H */
+
+// vim: expandtab ts=4 sw=4
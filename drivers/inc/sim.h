@@ -0,0 +1,222 @@
+/**
+ * @file sim.h
+ * @author  Jie Liu
+ * @version V1.0
+ * @date    2026-10-18
+ * @brief Simulated raspi-sensor-shield, a bus backend with register-level models
+ * @note With sim_backend set (see bus_set_backend()), "/dev/i2c-*" and
+ * "/dev/spidev*" are answered in the process by models of the shield
+ * devices: the PI4MSD5V9548A mux, APDS-9151, BME68x, LIS2DW12, MLX90632 on
+ * I2C and LSM6DSL on SPI. The drivers run unchanged on top, so everything
+ * above the bus (registry, scheduler, ring, writer) can be load-tested on any
+ * Linux box.
+ *
+ * The models are lazy: nothing runs between transfers, every access first
+ * catches the device up with CLOCK_MONOTONIC, so conversions, data-ready
+ * bits, FIFO fill levels and overruns appear at the times the settings in
+ * the registers (or struct sim_timing) give. One lock serializes the
+ * transfers like the adapter lock of the kernel, and an optional time per
+ * byte holds it for as long as the wire would.
+ *
+ * A device on a mux channel only answers while its channel is enabled; an
+ * address nobody answers fails the transfer with ENXIO, like a NACK. Two
+ * devices answering the same address both take writes and their reads are
+ * ANDed, like open-drain lines. The GNSS receiver is a pseudo terminal
+ * emitting RMC and GGA sentences, its slave side goes to gnss_init().
+ */
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bus.h"
+
+/** devices on the simulated buses */
+#define SIM_MAX_DEVICES 16
+/** time per byte on a 100 kHz bus, 8 bits and the ACK [ns] */
+#define SIM_BYTE_NS_100KHZ 90000
+/** time per byte on a 400 kHz bus [ns] */
+#define SIM_BYTE_NS_400KHZ 22500
+
+/** device models */
+enum sim_model_id {
+    SIM_PI4,
+    SIM_APDS,
+    SIM_BME,
+    SIM_LIS2,
+    SIM_LSM,  /// on the SPI bus, address and channel are ignored
+    SIM_MLX,
+    SIM_MODEL_COUNT
+};
+
+/**
+ * @struct sim_timing
+ * @brief timing of the models, 0 takes the time the registers select
+ * @var apds_us APDS conversion period
+ * @var bme_us BME forced measurement, TPH and heater
+ * @var lis2_us LIS2 single conversion, and sample period in continuous mode
+ * @var lsm_us LSM sample period of both sensors and the FIFO
+ * @var mlx_us MLX time per measurement, half a table pass
+ * @var gnss_us time between two GNSS fixes, 0 for 1 s
+ * @var byte_ns I2C time per byte, 0 for none; SPI then takes the clock rate set
+ */
+struct sim_timing {
+    uint32_t apds_us;
+    uint32_t bme_us;
+    uint32_t lis2_us;
+    uint32_t lsm_us;
+    uint32_t mlx_us;
+    uint32_t gnss_us;
+    uint32_t byte_ns;
+};
+
+/** datasheet timing, no bus time */
+#define SIM_TIMING_DATASHEET ((struct sim_timing){ 0 })
+
+/**
+ * @struct sim_stats
+ * @brief bus activity since sim_init()
+ * @var transfers I2C messages and SPI transfers
+ * @var bytes data bytes moved
+ * @var nacks transfers nobody answered
+ * @var collisions transfers more than one device answered
+ * @var mux_writes writes to the mux
+ */
+struct sim_stats {
+    uint64_t transfers;
+    uint64_t bytes;
+    uint64_t nacks;
+    uint64_t collisions;
+    uint64_t mux_writes;
+};
+
+/** backend answering the I2C and SPI device files from the models */
+extern const struct bus_backend sim_backend;
+
+/**
+ * @brief Start with empty buses
+ * @param[in] timing model timing, NULL for SIM_TIMING_DATASHEET
+ */
+void sim_init(const struct sim_timing* timing);
+
+/**
+ * @brief Put a device on a bus, in power-on state
+ * @param[in] model device model
+ * @param[in] addr slave address
+ * @param[in] mux PI4 channel bit, 0 for the bus itself
+ * @return error code
+ */
+int sim_add(enum sim_model_id model, uint8_t addr, uint8_t mux);
+
+/**
+ * @brief Put the devices of the shield on the buses
+ * @note the mux on the bus itself, every sensor behind its own channel
+ * @return error code
+ */
+int sim_shield(void);
+
+/**
+ * @brief Bus activity
+ * @param[out] stats activity since sim_init()
+ */
+void sim_get_stats(struct sim_stats* stats);
+
+/**
+ * @brief Start the GNSS receiver
+ * @param[out] path slave side of the pseudo terminal
+ * @param[in] size size of path
+ * @return error code
+ */
+int sim_gnss_open(char* path, size_t size);
+
+/**
+ * @brief Stop the GNSS receiver
+ */
+void sim_gnss_close(void);
+
+/**
+ * @brief Stop the GNSS receiver and take every device off the buses
+ * @note files still open fail from now on
+ */
+void sim_close(void);
+
+/**
+ * @defgroup sim_model model interface, for sim_models.c
+ * @{
+ */
+
+struct sim_device;
+
+/**
+ * @struct sim_model
+ * @brief how a kind of device answers
+ * @note the bus side is generic: a write sets the register pointer with its
+ * first byte (two for wide devices) and stores the rest from there, a read
+ * loads from the pointer on; xfer replaces that for devices without
+ * registers
+ * @var name short name
+ * @var wide 16-bit register addresses and words, MSB first
+ * @var paired after the first register, writes alternate address and data
+ * @var state_size bytes of model state
+ * @var reset power-on state
+ * @var sync catch up with the time
+ * @var load read a register, may have side effects
+ * @var store write a register
+ * @var next register after reg in a burst, NULL for reg + 1
+ * @var xfer whole transfer, NULL for register access
+ */
+struct sim_model {
+    const char* name;
+    uint8_t wide;
+    uint8_t paired;
+    size_t state_size;
+    void (*reset)(struct sim_device* dev, uint64_t now);
+    void (*sync)(struct sim_device* dev, uint64_t now);
+    uint16_t (*load)(struct sim_device* dev, uint16_t reg, uint64_t now);
+    void (*store)(struct sim_device* dev, uint16_t reg, uint16_t value, uint64_t now);
+    uint16_t (*next)(struct sim_device* dev, uint16_t reg);
+    void (*xfer)(struct sim_device* dev, uint8_t* buf, size_t len, int read);
+};
+
+/**
+ * @struct sim_device
+ * @brief a device on a simulated bus
+ * @var model kind of device
+ * @var addr slave address
+ * @var mux PI4 channel bit, 0 for the bus itself
+ * @var pointer register pointer
+ * @var regs 8-bit register map
+ * @var state model state, state_size bytes
+ * @var seed noise generator
+ */
+struct sim_device {
+    const struct sim_model* model;
+    uint8_t addr;
+    uint8_t mux;
+    uint16_t pointer;
+    uint8_t regs[256];
+    void* state;
+    uint32_t seed;
+};
+
+/** models, by enum sim_model_id */
+extern const struct sim_model* const sim_models[SIM_MODEL_COUNT];
+
+/** timing in use */
+extern struct sim_timing sim_timing;
+
+/**
+ * @brief Noise for the measured values
+ * @param[inout] dev device, its generator
+ * @param[in] amplitude largest deviation
+ * @return uniform in [-amplitude, amplitude]
+ */
+int32_t sim_noise(struct sim_device* dev, int32_t amplitude);
+
+///@}
+
+#endif /* SIM_H */
+
+// vim: expandtab ts=4 sw=4
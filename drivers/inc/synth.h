@@ -0,0 +1,129 @@
+/**
+ * @file synth.h
+ * @author  Jie Liu
+ * @version V1.0
+ * @date    2026-10-18
+ * @brief Synthetic load on the acquisition pipeline, to find where it saturates
+ * @note Synthetic generators stand in for the sensors: each is a struct
+ * sensor with a driver that collects generated values instead of touching a
+ * bus, driven by its own scheduler task through writer_sink(), one ring and
+ * the writer thread, like the real ones. A generator of n channels borrows
+ * the schema of the narrowest registry sensor having n columns, so the
+ * writer formats its records as it would that sensor's.
+ *
+ * synth_ramp() raises the rate of every generator step by step and reports
+ * the first step where the ring drops records, a scheduler task misses
+ * deadlines (timerfd overruns), or the writer falls behind (the ring more
+ * than 1/SYNTH_BACKLOG_SHARE full during the step).
+ */
+
+#ifndef SYNTH_H
+#define SYNTH_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "scheduler.h"
+
+/** generators at most, one scheduler task each */
+#define SYNTH_MAX_GENERATORS SCHEDULER_MAX_TASKS
+/** load steps at most */
+#define SYNTH_MAX_STEPS 64
+/** the writer is behind once the ring is fuller than depth / SYNTH_BACKLOG_SHARE */
+#define SYNTH_BACKLOG_SHARE 4
+/** steps run after the first drops, more load than that says little */
+#define SYNTH_STEPS_AFTER_DROPS 2
+/** time between two looks at the ring level [ms] */
+#define SYNTH_SAMPLE_MS 10
+/** longest wait for the writer to empty the ring between steps [ms] */
+#define SYNTH_DRAIN_MS 5000
+
+/**
+ * @struct synth_config
+ * @brief load and its ramp
+ * @var generators synthetic sensors, 1 to SYNTH_MAX_GENERATORS
+ * @var rate_hz rate of every generator in the first step [Hz]
+ * @var max_rate_hz ramp stops above this rate [Hz]
+ * @var step_percent rate increase from one step to the next [%]
+ * @var step_ms duration of a step [ms]
+ * @var channels values per record, 1 to SAMPLE_MAX_CHANNELS
+ * @var records records per collect (FIFO batch), 1 to SAMPLE_MAX_RECORDS, the
+ *      values of a collect fit SENSOR_RAW_SIZE
+ * @var ring_depth records the ring holds, a power of two
+ * @var pattern output file name of the writer, printf format taking the file number
+ * @var rt scheduler thread settings
+ */
+struct synth_config {
+    uint8_t generators;
+    uint32_t rate_hz;
+    uint32_t max_rate_hz;
+    uint32_t step_percent;
+    uint32_t step_ms;
+    uint8_t channels;
+    uint8_t records;
+    uint32_t ring_depth;
+    const char* pattern;
+    struct scheduler_rt rt;
+};
+
+/** four LIS2-sized generators from 100 Hz up, +50 % every 2 s */
+#define SYNTH_CONFIG_DEFAULT ((struct synth_config){ \
+    .generators = 4, .rate_hz = 100, .max_rate_hz = 200000, .step_percent = 50, \
+    .step_ms = 2000, .channels = 3, .records = 1, .ring_depth = 4096, \
+    .pattern = "synth_output%u.csv", .rt = { .cpu = -1 } })
+
+/**
+ * @struct synth_step
+ * @brief what one load step did
+ * @var rate_hz rate of every generator [Hz]
+ * @var offered records per second the generators were asked for, at the
+ *      whole microsecond period they ran at
+ * @var produced records per second the generators collected
+ * @var written records per second the writer wrote
+ * @var drops results the ring dropped
+ * @var misses deadlines the tasks missed
+ * @var backlog highest ring level seen
+ * @var latency_us 99.9th percentile wake up latency, worst task [us]
+ */
+struct synth_step {
+    uint32_t rate_hz;
+    double offered;
+    double produced;
+    double written;
+    uint32_t drops;
+    uint64_t misses;
+    uint32_t backlog;
+    uint32_t latency_us;
+};
+
+/**
+ * @struct synth_result
+ * @brief the ramp, and where each sign of saturation first showed
+ * @var steps steps run
+ * @var n_steps number of steps
+ * @var drops_at first step with drops, -1 if none
+ * @var misses_at first step with missed deadlines, -1 if none
+ * @var backlog_at first step with the writer behind, -1 if none
+ */
+struct synth_result {
+    struct synth_step steps[SYNTH_MAX_STEPS];
+    size_t n_steps;
+    int drops_at;
+    int misses_at;
+    int backlog_at;
+};
+
+/**
+ * @brief Ramp the synthetic load until the pipeline saturates
+ * @note runs until drops, misses and backlog have all shown, for at most
+ * SYNTH_STEPS_AFTER_DROPS steps after the first drops, or up to max_rate_hz
+ * @param[in] config load and ramp
+ * @param[out] result steps and saturation points, NULL if not needed
+ * @param[in] stream progress and summary, NULL for none
+ * @return error code
+ */
+int synth_ramp(const struct synth_config* config, struct synth_result* result, FILE* stream);
+
+#endif /* SYNTH_H */
+
+// vim: expandtab ts=4 sw=4
@@ -0,0 +1,65 @@
+/**
+ * @file timestamp.h
+ * @author  Jie Liu
+ * @version V1.0
+ * @date    2026-10-18
+ * @brief Monotonic time stamps and the anchors that map them to wall-clock time
+ * @note Samples are stamped with CLOCK_MONOTONIC, which never jumps, once per
+ * collect. Output files carry (monotonic, realtime) anchor pairs from time to
+ * time; wall-clock time of a sample is rebuilt offline by interpolating
+ * between the anchors around it, so NTP steps never reach the samples.
+ */
+
+#ifndef TIMESTAMP_H
+#define TIMESTAMP_H
+
+#include <stdint.h>
+#include <time.h>
+
+/** time between two anchors in an output file [ns] */
+#define TIMESTAMP_ANCHOR_PERIOD_NS UINT64_C(60000000000)
+/** reads per anchor, the tightest bracket is kept */
+#define TIMESTAMP_ANCHOR_TRIES 3
+
+/**
+ * @struct timestamp_anchor
+ * @brief the two clocks read at the same instant
+ * @var monotonic_ns CLOCK_MONOTONIC [ns]
+ * @var realtime_ns CLOCK_REALTIME, since the epoch [ns]
+ * @var uncertainty_ns width of the monotonic bracket around the realtime read [ns]
+ */
+struct timestamp_anchor {
+    uint64_t monotonic_ns;
+    uint64_t realtime_ns;
+    uint32_t uncertainty_ns;
+};
+
+/**
+ * @brief CLOCK_MONOTONIC, a vDSO call
+ * @return [ns]
+ */
+static inline uint64_t timestamp_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * @brief CLOCK_MONOTONIC in the resolution of deadlines
+ * @return [us]
+ */
+static inline uint64_t timestamp_us(void) {
+    return timestamp_ns() / 1000;
+}
+
+/**
+ * @brief Read both clocks as close together as possible
+ * @note the realtime read is bracketed by two monotonic reads, the middle of
+ * the tightest of TIMESTAMP_ANCHOR_TRIES brackets is taken
+ * @param[out] anchor anchor pair
+ */
+void timestamp_anchor(struct timestamp_anchor* anchor);
+
+#endif /* TIMESTAMP_H */
+
+// vim: expandtab ts=4 sw=4
@@ -0,0 +1,120 @@
+/**
+ * @file topology.h
+ * @author  Jie Liu
+ * @version V1.0
+ * @date    2026-10-18
+ * @brief Discovery of the sensors on the bus and behind the PI4 mux
+ * @note The scan probes the known addresses of every shield device with one
+ * quick read of its WHO_AM_I or chip ID register: first with every mux
+ * channel off, for the devices on the bus itself, then on each of the eight
+ * channels alone. The result goes into a small text cache file, one
+ * "name,address,channel" line per device; later starts only re-probe the
+ * cached devices, and scan again when one of them does not answer.
+ */
+
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "sensor.h"
+
+/** devices a topology holds */
+#define TOPOLOGY_MAX_DEVICES 16
+/** topology cache file */
+#define TOPOLOGY_CACHE_FILE "/var/tmp/rss_topology.txt"
+
+/**
+ * @struct topology_device
+ * @brief one device found
+ * @var name short name, the driver's for registry sensors
+ * @var sensor registry sensor, SENSOR_COUNT for devices outside the registry
+ * @var addr slave address
+ * @var mux PI4 channel bit, 0 if on the bus itself
+ */
+struct topology_device {
+    const char* name;
+    enum sensor_id sensor;
+    uint8_t addr;
+    uint8_t mux;
+};
+
+/**
+ * @struct topology
+ * @brief devices on one bus
+ * @var devices devices, in scan order
+ * @var n_devices number of devices
+ */
+struct topology {
+    struct topology_device devices[TOPOLOGY_MAX_DEVICES];
+    size_t n_devices;
+};
+
+/**
+ * @brief Probe every known address on the bus and on every mux channel
+ * @note the mux channels are restored afterwards
+ * @param[out] topology devices found
+ * @param[in] bus bus device file
+ * @return error code
+ */
+int topology_scan(struct topology* topology, int bus);
+
+/**
+ * @brief Probe the devices of a topology again
+ * @param[in] topology devices expected
+ * @param[in] bus bus device file
+ * @return error code, ERROR_NOTHING_TO_READ if one does not answer
+ */
+int topology_verify(const struct topology* topology, int bus);
+
+/**
+ * @brief Read a topology cache file
+ * @param[out] topology devices
+ * @param[in] path cache file
+ * @return error code, ERROR_NOTHING_TO_READ if there is none
+ */
+int topology_load(struct topology* topology, const char* path);
+
+/**
+ * @brief Write a topology cache file, replaced in one step
+ * @param[in] topology devices
+ * @param[in] path cache file
+ * @return error code
+ */
+int topology_save(const struct topology* topology, const char* path);
+
+/**
+ * @brief Load and verify the cache, or scan and rewrite it
+ * @param[out] topology devices
+ * @param[in] bus bus device file
+ * @param[in] path cache file
+ * @return error code
+ */
+int topology_discover(struct topology* topology, int bus, const char* path);
+
+/**
+ * @brief Set address and channel of the registry sensors found
+ * @note the first device found is taken when there are several of a kind;
+ * sensors not found keep their built-in address
+ * @param[in] topology devices
+ */
+void topology_apply(const struct topology* topology);
+
+/**
+ * @brief Channels with a device behind them
+ * @param[in] topology devices
+ * @return PI4 channel mask
+ */
+uint8_t topology_channels(const struct topology* topology);
+
+/**
+ * @brief Print the devices
+ * @param[in] topology devices
+ * @param[in] stream output
+ */
+void topology_print(const struct topology* topology, FILE* stream);
+
+#endif /* TOPOLOGY_H */
+
+// vim: expandtab ts=4 sw=4
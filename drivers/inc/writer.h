@@ -0,0 +1,123 @@
+/**
+ * @file writer.h
+ * @author  Jie Liu
+ * @version V1.0
+ * @date    2026-10-18
+ * @brief Writer thread draining the acquisition rings into the output file
+ * @note Acquisition pushes each collect undecoded, as a struct writer_entry,
+ * into one struct ring per producer thread and returns at once. The writer
+ * thread takes them out in batches, decodes and formats them, and writes
+ * every batch with a single flush, so neither decoding nor a slow SD card
+ * ever holds up acquisition. Every file starts with a
+ * (monotonic, realtime) anchor line and gets another one every
+ * TIMESTAMP_ANCHOR_PERIOD_NS: "anchor,monotonic_ns,realtime_ns,uncertainty_ns".
+ */
+
+#ifndef WRITER_H
+#define WRITER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "ring.h"
+#include "sensor.h"
+#include "sample.h"
+#include "timestamp.h"
+
+/** maximum number of rings per writer */
+#define WRITER_MAX_RINGS 8
+/** records taken from a ring per round */
+#define WRITER_BATCH 64
+/** sleep when every ring was empty [us] */
+#define WRITER_IDLE_US 20000
+/** stdio buffer of the output file [bytes] */
+#define WRITER_FILE_BUFFER 65536
+
+/**
+ * @struct writer_entry
+ * @brief one collect as queued by the acquisition side
+ * @var sensor sensor it came from, decodes it; has to outlive the writer
+ * @var raw undecoded result
+ */
+struct writer_entry {
+    const struct sensor* sensor;
+    struct sensor_raw raw;
+};
+
+/**
+ * @struct writer
+ * @brief writer state
+ * @var rings rings drained, one producer each
+ * @var n_rings number of rings
+ * @var pattern output file name, printf format taking the file number
+ * @var file current output file
+ * @var file_number number of the current file
+ * @var anchor_ns monotonic time of the last anchor line [ns]
+ * @var next_file number of the file to write to, see writer_next_file()
+ * @var thread writer thread
+ * @var running cleared by writer_stop()
+ * @var written records written, read by other threads while running
+ * @var errors results that could not be decoded, records that could not be written
+ */
+struct writer {
+    struct ring* rings[WRITER_MAX_RINGS];
+    size_t n_rings;
+    const char* pattern;
+    FILE* file;
+    unsigned file_number;
+    uint64_t anchor_ns;
+    atomic_uint next_file;
+    pthread_t thread;
+    atomic_int running;
+    atomic_ullong written;
+    uint32_t errors;
+};
+
+/**
+ * @brief Start the writer thread
+ * @param[out] writer writer state
+ * @param[in] pattern output file name, e.g. "rss_output%u.csv"
+ * @param[in] rings rings of struct writer_entry, one producer each
+ * @param[in] n_rings number of rings
+ * @return error code
+ */
+int writer_start(struct writer* writer, const char* pattern, struct ring* rings[],
+        size_t n_rings);
+
+/**
+ * @brief Switch to the next output file, from the next batch on
+ * @note never blocks
+ * @param[inout] writer writer state
+ */
+void writer_next_file(struct writer* writer);
+
+/**
+ * @brief Write what is still queued, stop the thread and close the file
+ * @param[inout] writer writer state
+ */
+void writer_stop(struct writer* writer);
+
+/**
+ * @brief Queue a result for the writer thread to decode, acquisition side
+ * @note never blocks and does not decode; a full ring drops the result and
+ * counts it
+ * @param[inout] ring ring of struct writer_entry
+ * @param[in] sensor sensor the result came from
+ * @param[in] raw undecoded result
+ * @return error code, ERROR_MAX_BUFFER_SIZE_REACHED if dropped
+ */
+int writer_push(struct ring* ring, const struct sensor* sensor, const struct sensor_raw* raw);
+
+/**
+ * @brief writer_push() as a struct scheduler_sensor sink
+ * @param[in] sensor sensor the result came from
+ * @param[in] raw undecoded result
+ * @param[inout] ring ring of struct writer_entry
+ */
+void writer_sink(const struct sensor* sensor, const struct sensor_raw* raw, void* ring);
+
+#endif /* WRITER_H */
+
+// vim: expandtab ts=4 sw=4
@@ -24,6 +24,8 @@
 #include <sys/stat.h>
 #include "apds.h"
 #include "common.h"
+#include "bus.h"
+#include "error.h"
 
 static int8_t apds_i2c_write(uint8_t reg_addr, const uint8_t *reg_data, uint32_t len,
 							 void *intf_ptr)
@@ -35,7 +37,7 @@ static int8_t apds_i2c_write(uint8_t reg_addr, const uint8_t *reg_data, uint32_t
     reg[0] = reg_addr;
     for (int i=1; i<len+1; i++)
        reg[i] = reg_data[i-1];
-    rc = write(dev, reg, len+1);
+    rc = bus_write(dev, reg, len+1);
 	if (rc != len+1) {
         fprintf(stderr, "write dev=0x%x,0x%x,0x%x,len=%d => %d", dev, reg[0], reg[1], len, rc);
 		perror("i2c write");
@@ -46,46 +48,186 @@ static int8_t apds_i2c_write(uint8_t reg_addr, const uint8_t *reg_data, uint32_t
     return rslt;
 }
 
-void apds_init(uint8_t dev)
+/** MAIN_STATUS bits that have to be set before the data registers are read */
+static uint8_t apds_gate = APDS_LS_DATA_STATUS;
+
+/** conversion time per resolution [us] */
+static const uint32_t apds_conversion_us[] = {
+    400000, 200000, 100000, 50000, 25000, 3125
+};
+
+/** repetition period per rate [us] */
+static const uint32_t apds_rate_us[] = {
+    25000, 50000, 100000, 200000, 500000, 1000000, 2000000
+};
+
+int apds_init(uint8_t dev)
 {
     uint8_t reg_addr = APDS_MAIN_CTRL;
     uint8_t reg_data = 0x66;    //0b01100110
-    apds_i2c_write(reg_addr, &reg_data, 1, &dev);
+    struct apds_profile profile = APDS_PROFILE_DEFAULT;
+    if (apds_i2c_write(reg_addr, &reg_data, 1, &dev))
+        return ERROR_WRITE_REGISTER_FAILS;
+
+    return apds_set_profile(dev, &profile);
+}
+
+int apds_set_profile(uint8_t dev, const struct apds_profile* profile)
+{
+    uint8_t reg_data;
+
+    if (profile->resolution > APDS_RES_13BIT || profile->rate > APDS_RATE_2000MS
+        || profile->gain > APDS_GAIN_18X)
+        return EXIT_FAILURE;
+
+    reg_data = (profile->resolution << 4) | profile->rate;
+    if (apds_i2c_write(APDS_LS_MEAS_RATE, &reg_data, 1, &dev))
+        return ERROR_WRITE_REGISTER_FAILS;
+
+    reg_data = profile->gain;
+    if (apds_i2c_write(APDS_LS_GAIN, &reg_data, 1, &dev))
+        return ERROR_WRITE_REGISTER_FAILS;
+
+    return EXIT_SUCCESS;
+}
+
+uint32_t apds_profile_period_us(const struct apds_profile* profile)
+{
+    return BIGGEST(apds_conversion_us[profile->resolution], apds_rate_us[profile->rate]);
+}
+
+int apds_set_variance_gate(uint8_t dev, uint8_t variance)
+{
+    uint8_t reg_data;
+
+    if (variance == 0xFF) {
+        reg_data = 0;
+        apds_gate = APDS_LS_DATA_STATUS;
+        return apds_i2c_write(APDS_INT_CFG, &reg_data, 1, &dev)
+            ? ERROR_WRITE_REGISTER_FAILS : EXIT_SUCCESS;
+    }
+
+    reg_data = variance & 0x07;
+    if (apds_i2c_write(APDS_LS_THRES_VAR, &reg_data, 1, &dev))
+        return ERROR_WRITE_REGISTER_FAILS;
+
+    reg_data = APDS_INT_CFG_GREEN_VARIANCE;
+    if (apds_i2c_write(APDS_INT_CFG, &reg_data, 1, &dev))
+        return ERROR_WRITE_REGISTER_FAILS;
+
+    apds_gate = APDS_LS_DATA_STATUS | APDS_LS_INT_STATUS;
+    return EXIT_SUCCESS;
+}
+
+int apds_ready(uint8_t dev)
+{
+    uint8_t status = 0;
+
+    // reading MAIN_STATUS clears it, so every result is reported once
+    if (i2c_read_8bit(APDS_MAIN_STATUS, &status, 1, &dev))
+        return ERROR_READ_REGISTER_FAILS;
+    if ((status & apds_gate) != apds_gate)
+        return ERROR_DATA_NOT_READY;
+
+    return EXIT_SUCCESS;
+}
 
-    reg_addr = APDS_LS_MEAS_RATE;
-    reg_data = 0x22;    //0b00100010
-    apds_i2c_write(reg_addr, &reg_data, 1, &dev);
+int apds_read_raw(uint8_t dev, uint8_t data[APDS_LS_DATA_SIZE])
+{
+    if (i2c_read_8bit(APDS_LS_DATA_IR_0, data, APDS_LS_DATA_SIZE, &dev))
+        return ERROR_READ_REGISTER_FAILS;
+
+    return EXIT_SUCCESS;
 }
 
-void apds_measure(uint8_t dev, uint32_t* infrared, uint32_t* green,
+void apds_decode(const uint8_t data[APDS_LS_DATA_SIZE], uint32_t* infrared, uint32_t* green,
+                 uint32_t* blue, uint32_t* red)
+{
+    // 20 bit little endian per channel, IR-G-B-R
+    *infrared = data[0] | data[1] << 8 | (data[2] & 0x0F) << 16;
+    *green = data[3] | data[4] << 8 | (data[5] & 0x0F) << 16;
+    *blue = data[6] | data[7] << 8 | (data[8] & 0x0F) << 16;
+    *red = data[9] | data[10] << 8 | (data[11] & 0x0F) << 16;
+}
+
+int apds_measure(uint8_t dev, uint32_t* infrared, uint32_t* green,
 				  uint32_t* blue, uint32_t* red)
 {
-    union { 
-        uint32_t u32;
-        uint8_t b[4];
-    } val;
-
-    val.u32 = 0U;
-    i2c_read_8bit(APDS_LS_DATA_IR_0, &val.b[0], 1, &dev);
-    i2c_read_8bit(APDS_LS_DATA_IR_1, &val.b[1], 1, &dev);
-    i2c_read_8bit(APDS_LS_DATA_IR_2, &val.b[2], 1, &dev);
-    *infrared = val.u32;
-    
-    val.u32 = 0U;
-    i2c_read_8bit(APDS_LS_DATA_GREEN_0, &val.b[0], 1, &dev);
-    i2c_read_8bit(APDS_LS_DATA_GREEN_1, &val.b[1], 1, &dev);
-    i2c_read_8bit(APDS_LS_DATA_GREEN_2, &val.b[2], 1, &dev);
-    *green = val.u32;
-
-    val.u32 = 0U;
-    i2c_read_8bit(APDS_LS_DATA_BLUE_0, &val.b[0], 1, &dev);
-    i2c_read_8bit(APDS_LS_DATA_BLUE_1, &val.b[1], 1, &dev);
-    i2c_read_8bit(APDS_LS_DATA_BLUE_2, &val.b[2], 1, &dev);
-    *blue = val.u32;
-
-    val.u32 = 0U;
-    i2c_read_8bit(APDS_LS_DATA_RED_0, &val.b[0], 1, &dev);
-    i2c_read_8bit(APDS_LS_DATA_RED_1, &val.b[1], 1, &dev);
-    i2c_read_8bit(APDS_LS_DATA_RED_2, &val.b[2], 1, &dev);
-    *red = val.u32;
+    uint8_t data[APDS_LS_DATA_SIZE];
+    int ret;
+
+    ret = apds_ready(dev);
+    if (ret != EXIT_SUCCESS)
+        return ret;
+
+    ret = apds_read_raw(dev, data);
+    if (ret != EXIT_SUCCESS)
+        return ret;
+
+    apds_decode(data, infrared, green, blue, red);
+
+    return EXIT_SUCCESS;
+}
+
+/*
+ * registry adapters, the APDS converts on its own at the profile rate
+ */
+
+static const struct sensor_field apds_fields[] = {
+    { "infrared", "", 0 },
+    { "green", "", 0 },
+    { "blue", "", 0 },
+    { "red", "", 0 },
+};
+
+static int apds_sensor_init(struct sensor* sensor)
+{
+    i2c_set_address(sensor->slave.fd, sensor->slave.addr);
+    return apds_init(sensor->slave.fd);
 }
+
+static int apds_sensor_ready(struct sensor* sensor)
+{
+    i2c_set_address(sensor->slave.fd, sensor->slave.addr);
+    return apds_ready(sensor->slave.fd);
+}
+
+static int apds_sensor_collect(struct sensor* sensor, struct sensor_raw* raw)
+{
+    int ret;
+
+    i2c_set_address(sensor->slave.fd, sensor->slave.addr);
+    ret = apds_read_raw(sensor->slave.fd, raw->data);
+    if (ret != EXIT_SUCCESS)
+        return ret;
+
+    raw->len = APDS_LS_DATA_SIZE;
+    raw->records = 1;
+    return EXIT_SUCCESS;
+}
+
+static int apds_sensor_decode(const struct sensor* sensor, const struct sensor_raw* raw,
+                              int32_t values[SENSOR_MAX_VALUES])
+{
+    uint32_t infrared, green, blue, red;
+
+    (void)sensor; // stateless
+    apds_decode(raw->data, &infrared, &green, &blue, &red);
+    // 20 bit, fits
+    values[0] = infrared;
+    values[1] = green;
+    values[2] = blue;
+    values[3] = red;
+    return EXIT_SUCCESS;
+}
+
+const struct sensor_driver apds_driver = {
+    .name = "apds",
+    .fields = apds_fields,
+    .n_fields = ARRAY_SIZE(apds_fields),
+    .init = apds_sensor_init,
+    .trigger = NULL,
+    .ready = apds_sensor_ready,
+    .collect = apds_sensor_collect,
+    .decode = apds_sensor_decode,
+};
@@ -25,21 +25,48 @@
 #include "bme68x.h"
 #include "bme68x_defs.h"
 #include "common.h"
+#include "error.h"
+#include "regcache.h"
+#include "timestamp.h"
 
-#undef PARALLEL_MODE
 #undef BME68X_USE_FPU
-#define SAMPLE_COUNT UINT16_C(300)
 
-static struct bme68x_dev dev;
-static struct bme68x_conf conf;
-static struct bme68x_heatr_conf heatr_conf;
+/* Parallel mode heater profile */
+/** Heater temperature in degree Celsius */
+static uint16_t temp_prof[] = { 320, 100, 100, 100, 200, 200, 200, 320, 320, 320 };
+/** Multiplier to the shared heater duration */
+static uint16_t mul_prof[] = { 5, 2, 10, 30, 5, 5, 5, 5, 5, 5 };
 
-static inline uint64_t gettime_us()
-{
-  struct timeval tv;
-  gettimeofday(&tv, NULL);
-  return (int64_t)((tv.tv_sec) * 1000000 + tv.tv_usec);
-}
+/** a parallel mode heater step, TPH conversion plus shared heater duration [ms] */
+#define BME_PARALLEL_CYCLE_MS 140
+
+/**
+ * @struct bme_profile_conf
+ * @brief settings that together decide the measurement duration
+ */
+struct bme_profile_conf {
+    uint8_t os_hum;
+    uint8_t os_temp;
+    uint8_t os_pres;
+    uint8_t filter;
+    uint16_t heatr_dur; /// forced mode heater duration [ms]
+};
+
+/** settings of each enum bme_profile */
+static const struct bme_profile_conf profiles[] = {
+    [BME_PROFILE_LOW_LATENCY] = {
+        BME68X_OS_1X, BME68X_OS_1X, BME68X_OS_1X, BME68X_FILTER_OFF, 30 },
+    [BME_PROFILE_BALANCED] = {
+        BME68X_OS_16X, BME68X_OS_2X, BME68X_OS_1X, BME68X_FILTER_OFF, 100 },
+    [BME_PROFILE_LOW_NOISE] = {
+        BME68X_OS_16X, BME68X_OS_8X, BME68X_OS_16X, BME68X_FILTER_SIZE_15, 150 }
+};
+
+/** Bosch operation mode of each enum bme_mode */
+static const uint8_t op_mode[] = {
+    [BME_MODE_FORCED] = BME68X_FORCED_MODE,
+    [BME_MODE_PARALLEL] = BME68X_PARALLEL_MODE
+};
 
 #define bme68x_check_rslt(name,rslt) do				  \
 	{											      \
@@ -47,144 +74,557 @@ static inline uint64_t gettime_us()
 			printf("bme68x %s error %u", name, rslt); \
 	} while (0)
 
-void bme_init(uint8_t fd) // fd of i2c
+/**
+ * @brief  apply the selected mode and profile
+ * @param[inout] ctx sensor context
+ * @return error code
+ */
+static int bme_configure(struct bme_ctx *ctx)
 {
 	int8_t rslt;
-	dev.intf_ptr = &fd;
-	dev.read = i2c_read_8bit;
-	dev.write = i2c_write;
-    dev.delay_us = delay_us;
-	dev.intf = BME68X_I2C_INTF;
-    rslt = bme68x_init(&dev);
-    bme68x_check_rslt("bme68x_init", rslt);
+	uint32_t meas_dur_ms;
+	const struct bme_profile_conf *prof = &profiles[ctx->profile];
+
+	/* Stop a running parallel mode before reconfiguring */
+	rslt = bme68x_set_op_mode(BME68X_SLEEP_MODE, &ctx->dev);
+	bme68x_check_rslt("bme68x_set_op_mode", rslt);
+	ctx->state = BME_IDLE;
 
     /* Set the temperature, pressure and humidity settings */
-#ifdef PARALLEL_MODE
-    conf.os_hum = BME68X_OS_1X;
-    conf.os_temp = BME68X_OS_2X;
-    conf.os_pres = BME68X_OS_16X;
-    conf.filter = BME68X_FILTER_OFF;
+	ctx->conf.os_hum = prof->os_hum;
+	ctx->conf.os_temp = prof->os_temp;
+	ctx->conf.os_pres = prof->os_pres;
+	ctx->conf.filter = prof->filter;
 	// Standby time between sequential mode measurement profiles. ODR/Standby time
-    conf.odr = BME68X_ODR_NONE;
-#else
-    conf.os_hum = BME68X_OS_16X;
-    conf.os_pres = BME68X_OS_1X;
-    conf.os_temp = BME68X_OS_2X;
-    conf.filter = BME68X_FILTER_OFF;
-    conf.odr = BME68X_ODR_NONE;
-#endif
-    rslt = bme68x_set_conf(&conf, &dev);
+    ctx->conf.odr = BME68X_ODR_NONE;
+    rslt = bme68x_set_conf(&ctx->conf, &ctx->dev);
     bme68x_check_rslt("bme68x_set_conf", rslt);
+	if (rslt != BME68X_OK)
+		return ERROR_WRITE_REGISTER_FAILS;
 
-    /* Create a ramp heat waveform in 3 steps */
-    heatr_conf.enable =  BME68X_ENABLE;
-    heatr_conf.heatr_temp = 300; // Celsius
-    heatr_conf.heatr_dur = 100;  // ms
-#ifdef PARALLEL_MODE
-    /* Heater temperature in degree Celsius */
-    uint16_t temp_prof[] = { 320, 100, 100, 100, 200, 200, 200, 320, 320, 320 };
-    /* Multiplier to the shared heater duration */
-    uint16_t mul_prof[] = { 5, 2, 10, 30, 5, 5, 5, 5, 5, 5 };
-    heatr_conf.heatr_temp_prof = temp_prof;
-    heatr_conf.heatr_dur_prof = mul_prof;
-    heatr_conf.profile_len = 10;
-    /* Shared heating duration in milliseconds */
-    heatr_conf.shared_heatr_dur = 140 -
-		(bme68x_get_meas_dur(BME68X_PARALLEL_MODE, &conf, &dev) / 1000);
-	
-    rslt = bme68x_set_heatr_conf(BME68X_PARALLEL_MODE, &heatr_conf, &dev);
+    ctx->heatr_conf.enable =  BME68X_ENABLE;
+    ctx->heatr_conf.heatr_temp = 300; // Celsius
+    ctx->heatr_conf.heatr_dur = prof->heatr_dur;  // ms
+	if (ctx->mode == BME_MODE_PARALLEL) {
+		ctx->heatr_conf.heatr_temp_prof = temp_prof;
+		ctx->heatr_conf.heatr_dur_prof = mul_prof;
+		ctx->heatr_conf.profile_len = ARRAY_SIZE(temp_prof);
+		/* Shared heating duration in milliseconds, what is left of a
+		 * 140 ms cycle after the TPH conversion */
+		meas_dur_ms = bme68x_get_meas_dur(BME68X_PARALLEL_MODE, &ctx->conf, &ctx->dev) / 1000;
+		ctx->heatr_conf.shared_heatr_dur = meas_dur_ms < BME_PARALLEL_CYCLE_MS
+			? BME_PARALLEL_CYCLE_MS - meas_dur_ms : 1;
+	} else {
+		ctx->heatr_conf.profile_len = 0;
+	}
+    rslt = bme68x_set_heatr_conf(op_mode[ctx->mode], &ctx->heatr_conf, &ctx->dev);
     bme68x_check_rslt("bme68x_set_heatr_conf", rslt);
-#else // FORCED_MODE (default)
-    heatr_conf.profile_len = 0;
-    rslt = bme68x_set_heatr_conf(BME68X_FORCED_MODE, &heatr_conf, &dev);
-#endif
+	if (rslt != BME68X_OK)
+		return ERROR_WRITE_REGISTER_FAILS;
+
+	return EXIT_SUCCESS;
 }
 
-void bme_measure(int32_t *temp, uint32_t *pres, uint32_t *hum, uint32_t *gas_res)
+int bme_init(struct bme_ctx *ctx, uint8_t fd, uint8_t addr)
 {
 	int8_t rslt;
-#ifdef PARALLEL_MODE
-    struct bme68x_data data[3]; // max n_fields
-#else
-    struct bme68x_data data;
-#endif
-	// Get the total measurement duration so as to sleep or wait till the
-	// measurement is complete
-    // int8_t delay = 3;
-    uint16_t sample_count = 1;
-    uint8_t n_fields;
-    uint32_t del_period;
-	uint64_t time_us;
-#ifdef PARALLEL_MODE
-	const uint8_t mode = BME68X_PARALLEL_MODE;
-#else
-	const uint8_t mode = BME68X_FORCED_MODE;
-#endif
-    while (sample_count <= SAMPLE_COUNT)
-    {
-		rslt = bme68x_set_op_mode(mode, &dev);
-        bme68x_check_rslt("bme68x_set_op_mode", rslt);
-
-        /* Calculate delay period in microseconds */
-        del_period = bme68x_get_meas_dur(mode, &conf, &dev)
-			+ (heatr_conf.heatr_dur * 1000);
-        dev.delay_us(del_period, dev.intf_ptr);
-        time_us = gettime_us();
-
-        /* Check if rslt == BME68X_OK, report or handle if otherwise */
-        rslt = bme68x_get_data(mode, &data, &n_fields, &dev);
-        bme68x_check_rslt("bme68x_get_data", rslt);
-
-#ifdef PARALLEL_MODE
-        for (uint8_t i = 0; i < n_fields; i++)
-		{
-			// Avoid using measurements from an unstable heating setup
-			// heater stability
-            if (data[i].status & BME68X_HEAT_STAB_MSK)
-            {
-				*temp = data[i].temperature / 100;
-				*pres = data[i].pressure;
-				*hum  = data[i].humidity / 1000 ;
-				if (data[i].status & BME68X_GASM_VALID_MSK) {
-					*gas_res = data[i].gas_resistance;
-				}
-			}
+
+	memset(ctx, 0, sizeof(*ctx));
+	ctx->slave.fd = fd;
+	ctx->slave.addr = addr;
+	ctx->dev.intf_ptr = &ctx->slave;
+	ctx->dev.read = regcache_slave_read;
+	ctx->dev.write = regcache_slave_write;
+    ctx->dev.delay_us = delay_us;
+	ctx->dev.intf = BME68X_I2C_INTF;
+	/* bme68x_init() soft resets the sensor; writing CTRL_MEAS starts a
+	 * conversion and its mode bits fall back to sleep on their own */
+	regcache_invalidate(fd, addr);
+	regcache_set_volatile(&ctx->slave, BME68X_REG_SOFT_RESET);
+	regcache_set_volatile(&ctx->slave, BME68X_REG_CTRL_MEAS);
+    rslt = bme68x_init(&ctx->dev);
+    bme68x_check_rslt("bme68x_init", rslt);
+	if (rslt != BME68X_OK)
+		return ERROR_READ_TEST_FAILED;
+
+	ctx->mode = BME_MODE_FORCED;
+	ctx->profile = BME_PROFILE_BALANCED;
+	return bme_configure(ctx);
+}
+
+int bme_set_mode(struct bme_ctx *ctx, enum bme_mode new_mode)
+{
+	if (new_mode != BME_MODE_FORCED && new_mode != BME_MODE_PARALLEL)
+		return EXIT_FAILURE;
+
+	ctx->mode = new_mode;
+	return bme_configure(ctx);
+}
+
+enum bme_mode bme_get_mode(const struct bme_ctx *ctx)
+{
+	return ctx->mode;
+}
+
+int bme_set_profile(struct bme_ctx *ctx, enum bme_profile new_profile)
+{
+	if (new_profile >= ARRAY_SIZE(profiles))
+		return EXIT_FAILURE;
+
+	ctx->profile = new_profile;
+	return bme_configure(ctx);
+}
+
+enum bme_profile bme_get_profile(const struct bme_ctx *ctx)
+{
+	return ctx->profile;
+}
+
+int bme_profile_info(struct bme_ctx *ctx, enum bme_profile prof,
+					 uint32_t *meas_dur_us, uint32_t *period_us,
+					 uint32_t *rate_mhz)
+{
+	struct bme68x_conf prof_conf;
+
+	if (prof >= ARRAY_SIZE(profiles))
+		return EXIT_FAILURE;
+
+	prof_conf.os_hum = profiles[prof].os_hum;
+	prof_conf.os_temp = profiles[prof].os_temp;
+	prof_conf.os_pres = profiles[prof].os_pres;
+	prof_conf.filter = profiles[prof].filter;
+	prof_conf.odr = BME68X_ODR_NONE;
+
+	*meas_dur_us = bme68x_get_meas_dur(BME68X_FORCED_MODE, &prof_conf, &ctx->dev);
+	*period_us = *meas_dur_us + profiles[prof].heatr_dur * 1000;
+	*rate_mhz = 1000000000UL / *period_us;
+
+	return EXIT_SUCCESS;
+}
+
+int bme_trigger(struct bme_ctx *ctx, uint64_t *ready_at)
+{
+	int8_t rslt;
+	uint32_t del_period;
+
+	/* Parallel mode keeps converting once started */
+	if (ctx->state != BME_RUNNING) {
+		rslt = bme68x_set_op_mode(op_mode[ctx->mode], &ctx->dev);
+		bme68x_check_rslt("bme68x_set_op_mode", rslt);
+		if (rslt != BME68X_OK)
+			return ERROR_WRITE_REGISTER_FAILS;
+	}
+
+	/* Calculate delay period in microseconds */
+	del_period = bme68x_get_meas_dur(op_mode[ctx->mode], &ctx->conf, &ctx->dev);
+	if (ctx->mode == BME_MODE_PARALLEL)
+		del_period += ctx->heatr_conf.shared_heatr_dur * 1000;
+	else
+		del_period += ctx->heatr_conf.heatr_dur * 1000;
+
+	ctx->ready_us = timestamp_us() + del_period;
+	ctx->state = ctx->mode == BME_MODE_PARALLEL ? BME_RUNNING : BME_MEASURING;
+
+	if (ready_at)
+		*ready_at = ctx->ready_us;
+
+	return EXIT_SUCCESS;
+}
+
+int bme_collect_fields(struct bme_ctx *ctx, struct bme_field fields[BME_MAX_FIELDS],
+					   uint8_t *n_fields)
+{
+	int8_t rslt;
+    struct bme68x_data data[BME_MAX_FIELDS];
+	uint8_t n_data = 0;
+
+	*n_fields = 0;
+
+	if (ctx->state == BME_IDLE)
+		return ERROR_STATE_MACHINE;
+	if (timestamp_us() < ctx->ready_us)
+		return ERROR_DATA_NOT_READY;
+
+	if (ctx->state == BME_MEASURING)
+		ctx->state = BME_IDLE;
+
+	/* Check if rslt == BME68X_OK, report or handle if otherwise */
+	rslt = bme68x_get_data(op_mode[ctx->mode], data, &n_data, &ctx->dev);
+	if (rslt == BME68X_W_NO_NEW_DATA)
+		return ERROR_NOTHING_TO_READ;
+	bme68x_check_rslt("bme68x_get_data", rslt);
+	if (rslt != BME68X_OK)
+		return ERROR_READ_REGISTER_FAILS;
+
+	for (uint8_t i = 0; i < n_data; i++)
+	{
+		fields[i].temp = data[i].temperature;
+		fields[i].pres = data[i].pressure;
+		fields[i].hum = data[i].humidity;
+		fields[i].gas_res = data[i].gas_resistance;
+		fields[i].status = data[i].status;
+		fields[i].gas_index = data[i].gas_index;
+		fields[i].meas_index = data[i].meas_index;
+		fields[i].addr = ctx->slave.addr;
+		fields[i].heatr_temp = ctx->mode == BME_MODE_PARALLEL
+			? temp_prof[data[i].gas_index % ARRAY_SIZE(temp_prof)]
+			: ctx->heatr_conf.heatr_temp;
 #ifdef DEBUG
-            printf("%u, %lu, %d, %lu, %lu, %lu, 0x%x\n",
-                   sample_count,
-                   (long unsigned int)time_us,
-                   (data[i].temperature / 100),
-                   (long unsigned int)data[i].pressure,
-                   (long unsigned int)(data[i].humidity / 1000),
-                   (long unsigned int)data[i].gas_resistance,
-                   data[i].status);
+		printf("0x%02x: %lu, %u, %d, %lu, %lu, %lu, 0x%x\n",
+			   ctx->slave.addr,
+			   (long unsigned int)ctx->ready_us,
+			   data[i].gas_index,
+			   (data[i].temperature / 100),
+			   (long unsigned int)data[i].pressure,
+			   (long unsigned int)(data[i].humidity / 1000),
+			   (long unsigned int)data[i].gas_resistance,
+			   data[i].status);
 #endif
-            sample_count++;
-        }
-#else // FORCED_MODE
-		if (n_fields)
-        {
-            if (data.status & BME68X_HEAT_STAB_MSK)
-            {
-				*temp = data.temperature / 100;
-				*pres = data.pressure;
-				*hum  = data.humidity / 1000 ;
-				if (data.status & BME68X_GASM_VALID_MSK) {
-					*gas_res = data.gas_resistance;
-				}
+	}
+	*n_fields = n_data;
+
+	return EXIT_SUCCESS;
+}
+
+int bme_collect(struct bme_ctx *ctx, int32_t *temp, uint32_t *pres,
+				uint32_t *hum, uint32_t *gas_res)
+{
+	struct bme_field fields[BME_MAX_FIELDS];
+	uint8_t n_fields;
+	int ret;
+
+	ret = bme_collect_fields(ctx, fields, &n_fields);
+	if (ret != EXIT_SUCCESS)
+		return ret;
+
+	ret = ERROR_DATA_NOT_READY;
+	for (uint8_t i = 0; i < n_fields; i++)
+	{
+		// Avoid using measurements from an unstable heating setup
+		// heater stability
+		if (fields[i].status & BME68X_HEAT_STAB_MSK)
+		{
+			*temp = fields[i].temp / 100;
+			*pres = fields[i].pres;
+			*hum  = fields[i].hum / 1000;
+			if (fields[i].status & BME68X_GASM_VALID_MSK) {
+				*gas_res = fields[i].gas_res;
 			}
-#ifdef DEBUG
-            printf("%u, %lu, %d, %lu, %lu, %lu, 0x%x\n",
-                   sample_count,
-                   (long unsigned int)time_us,
-                   (data.temperature / 100),
-                   (long unsigned int)data.pressure,
-                   (long unsigned int)(data.humidity / 1000),
-                   (long unsigned int)data.gas_resistance,
-                   data.status);
-#endif
-            sample_count++;
-        }
-#endif
-    }
+			ret = EXIT_SUCCESS;
+		}
+	}
+
+	return ret;
+}
+
+int bme_measure(struct bme_ctx *ctx, uint16_t sample_count, int32_t *temp,
+				uint32_t *pres, uint32_t *hum, uint32_t *gas_res)
+{
+	uint64_t ready_at;
+	uint64_t now;
+	int ret = ERROR_DATA_NOT_READY;
+
+	while (sample_count--)
+	{
+		if (bme_trigger(ctx, &ready_at) != EXIT_SUCCESS)
+			return ERROR_WRITE_REGISTER_FAILS;
+
+		now = timestamp_us();
+		if (ready_at > now)
+			ctx->dev.delay_us(ready_at - now, ctx->dev.intf_ptr);
+
+		// keep the last stable result, like before
+		if (bme_collect(ctx, temp, pres, hum, gas_res) == EXIT_SUCCESS)
+			ret = EXIT_SUCCESS;
+	}
+
+	return ret;
+}
+
+int bme_trigger_interleaved(struct bme_ctx *ctx[], size_t n, uint64_t *ready_at)
+{
+	uint64_t sensor_ready;
+	int ret = EXIT_SUCCESS;
+	int rslt;
+
+	if (ready_at)
+		*ready_at = 0;
+
+	/* Trigger everything first, the conversions then run side by side */
+	for (size_t i = 0; i < n; i++) {
+		rslt = bme_trigger(ctx[i], &sensor_ready);
+		if (rslt != EXIT_SUCCESS) {
+			// not to be collected by bme_collect_interleaved()
+			if (ctx[i]->state == BME_MEASURING)
+				ctx[i]->state = BME_IDLE;
+			if (ret == EXIT_SUCCESS)
+				ret = rslt;
+			continue;
+		}
+		if (ready_at && sensor_ready > *ready_at)
+			*ready_at = sensor_ready;
+	}
+
+	return ret;
+}
+
+int bme_collect_interleaved(struct bme_ctx *ctx[], size_t n, struct bme_field fields[],
+							uint8_t got[])
+{
+	struct bme_field read[BME_MAX_FIELDS];
+	uint8_t n_read;
+	uint64_t now;
+	size_t next;
+	size_t i;
+	int ret = EXIT_SUCCESS;
+	int rslt;
+
+	for (i = 0; i < n; i++)
+		got[i] = 0;
+
+	/* Collect in the order the sensors finish */
+	for (;;) {
+		next = n;
+		for (i = 0; i < n; i++) {
+			if (ctx[i]->state != BME_MEASURING)
+				continue;
+			if (next == n || ctx[i]->ready_us < ctx[next]->ready_us)
+				next = i;
+		}
+		if (next == n)
+			break;
+
+		now = timestamp_us();
+		if (ctx[next]->ready_us > now)
+			delay_us(ctx[next]->ready_us - now, NULL);
+
+		rslt = bme_collect_fields(ctx[next], read, &n_read);
+		ctx[next]->state = BME_IDLE;
+		if (rslt == EXIT_SUCCESS && n_read) {
+			fields[next] = read[n_read - 1];
+			got[next] = 1;
+		} else if (ret == EXIT_SUCCESS) {
+			ret = rslt != EXIT_SUCCESS ? rslt : ERROR_NOTHING_TO_READ;
+		}
+	}
+
+	return ret;
+}
+
+int bme_measure_interleaved(struct bme_ctx *ctx[], size_t n, struct bme_field fields[])
+{
+	uint8_t got[n];
+	int ret;
+	int rslt;
+
+	ret = bme_trigger_interleaved(ctx, n, NULL);
+	rslt = bme_collect_interleaved(ctx, n, fields, got);
+
+	return ret != EXIT_SUCCESS ? ret : rslt;
+}
+
+/*
+ * registry adapters
+ */
+
+static const struct sensor_field bme_fields[] = {
+	{ "temp", "degC", -2 },
+	{ "pres", "Pa", 0 },
+	{ "hum", "%", -3 },
+	{ "gas_res", "Ohm", 0 },
+	{ "gas_index", "", 0 },
+	{ "heatr_temp", "degC", 0 },
+	{ "status", "", 0 },
+	{ "addr", "", 0 },
+};
+
+/**
+ * @brief  pointers to the contexts of a set, as the interleaved calls take them
+ * @param[in] set sensors
+ * @param[out] ctx set->n pointers
+ */
+static void bme_set_contexts(struct bme_set *set, struct bme_ctx *ctx[BME_MAX_SENSORS])
+{
+	for (uint8_t i = 0; i < set->n; i++)
+		ctx[i] = &set->ctx[i];
+}
+
+static int bme_sensor_init(struct sensor *sensor)
+{
+	struct bme_set *set = sensor->ctx;
+	// the registry address, then the other one of BME_ADD and BME2_ADD
+	const uint8_t addr[BME_MAX_SENSORS] = {
+		sensor->slave.addr, sensor->slave.addr == BME_ADD ? BME2_ADD : BME_ADD };
+	i2c_slave probe = { sensor->slave.fd, 0 };
+	struct bme_ctx *ctx;
+	uint16_t chip_id;
+	int ret = EXIT_SUCCESS;
+	int rslt;
+
+	set->n = 0;
+	set->next = 0;
+	for (uint8_t i = 0; i < BME_MAX_SENSORS; i++) {
+		// a second sensor is optional, look for it without complaints
+		probe.addr = addr[i];
+		if (i && (i2c_probe(&probe, BME68X_REG_CHIP_ID, 0, &chip_id)
+				  || chip_id != BME68X_CHIP_ID))
+			continue;
+
+		ctx = &set->ctx[set->n];
+		rslt = bme_init(ctx, sensor->slave.fd, addr[i]);
+		// bme_init() falls back to forced
+		if (rslt == EXIT_SUCCESS && set->mode != BME_MODE_FORCED)
+			rslt = bme_set_mode(ctx, set->mode);
+		if (rslt == EXIT_SUCCESS)
+			set->n++;
+		else if (ret == EXIT_SUCCESS)
+			ret = rslt;
+	}
+
+	return set->n ? EXIT_SUCCESS : ret;
+}
+
+int bme_sensor_set_mode(struct sensor *sensor, enum bme_mode mode)
+{
+	struct bme_set *set = sensor->ctx;
+
+	if (sensor->driver != &bme_driver
+		|| (mode != BME_MODE_FORCED && mode != BME_MODE_PARALLEL))
+		return EXIT_FAILURE;
+
+	set->mode = mode;
+	return EXIT_SUCCESS;
+}
+
+static int bme_sensor_trigger(struct sensor *sensor, uint64_t *ready_at)
+{
+	struct bme_set *set = sensor->ctx;
+	struct bme_ctx *ctx[BME_MAX_SENSORS];
+	int ret;
+
+	bme_set_contexts(set, ctx);
+	ret = bme_trigger_interleaved(ctx, set->n, ready_at);
+
+	// a sensor that failed only costs its own result
+	for (uint8_t i = 0; ret != EXIT_SUCCESS && i < set->n; i++) {
+		if (set->ctx[i].state != BME_IDLE)
+			ret = EXIT_SUCCESS;
+	}
+	return ret;
+}
+
+/**
+ * @brief  copy results into a raw record
+ * @param[inout] raw raw record, records and len grow
+ * @param[in] field result
+ * @return error code, ERROR_INVALID_BUFFER_SIZE if raw is full
+ */
+static int bme_raw_add(struct sensor_raw *raw, const struct bme_field *field)
+{
+	if (raw->len + sizeof(*field) > sizeof(raw->data))
+		return ERROR_INVALID_BUFFER_SIZE;
+
+	memcpy(raw->data + raw->len, field, sizeof(*field));
+	raw->len += sizeof(*field);
+	raw->records++;
+	return EXIT_SUCCESS;
+}
+
+/**
+ * @brief  collect several forced sensors together
+ * @details only once every one is done, collect must not wait
+ * @param[inout] set sensors
+ * @param[out] raw one record per sensor with a result
+ * @return error code
+ */
+static int bme_sensor_collect_interleaved(struct bme_set *set, struct sensor_raw *raw)
+{
+	struct bme_ctx *ctx[BME_MAX_SENSORS];
+	struct bme_field fields[BME_MAX_SENSORS];
+	uint8_t got[BME_MAX_SENSORS];
+	uint64_t now = timestamp_us();
+	int ret;
+
+	for (uint8_t i = 0; i < set->n; i++) {
+		if (set->ctx[i].state == BME_MEASURING && set->ctx[i].ready_us > now)
+			return ERROR_DATA_NOT_READY;
+	}
+
+	bme_set_contexts(set, ctx);
+	ret = bme_collect_interleaved(ctx, set->n, fields, got);
+	for (uint8_t i = 0; i < set->n; i++) {
+		if (got[i] && bme_raw_add(raw, &fields[i]) != EXIT_SUCCESS)
+			return ERROR_INVALID_BUFFER_SIZE;
+	}
+	if (raw->records)
+		return EXIT_SUCCESS;
+
+	return ret == ERROR_NOTHING_TO_READ ? ERROR_DATA_NOT_READY : ret;
 }
+
+static int bme_sensor_collect(struct sensor *sensor, struct sensor_raw *raw)
+{
+	struct bme_set *set = sensor->ctx;
+	struct bme_field fields[BME_MAX_FIELDS];
+	uint8_t n_fields;
+	uint8_t i;
+	int ret = ERROR_DATA_NOT_READY;
+	int rslt;
+
+	if (set->n > 1 && set->mode == BME_MODE_FORCED)
+		return bme_sensor_collect_interleaved(set, raw);
+
+	// a parallel mode read can fill a raw record, one sensor per collect
+	for (uint8_t k = 0; k < set->n; k++) {
+		i = (set->next + k) % set->n;
+		rslt = bme_collect_fields(&set->ctx[i], fields, &n_fields);
+		if (rslt == ERROR_NOTHING_TO_READ || rslt == ERROR_DATA_NOT_READY)
+			continue; // parallel mode, next step still converting
+		if (rslt != EXIT_SUCCESS) {
+			if (ret == ERROR_DATA_NOT_READY)
+				ret = rslt;
+			continue;
+		}
+
+		set->next = (i + 1) % set->n;
+		for (uint8_t f = 0; f < n_fields; f++) {
+			if (bme_raw_add(raw, &fields[f]) != EXIT_SUCCESS)
+				return ERROR_INVALID_BUFFER_SIZE;
+		}
+		return EXIT_SUCCESS;
+	}
+
+	return ret;
+}
+
+static int bme_sensor_decode(const struct sensor *sensor, const struct sensor_raw *raw,
+							 int32_t values[SENSOR_MAX_VALUES])
+{
+	struct bme_field field;
+
+	(void)sensor;
+	for (uint8_t i = 0; i < raw->records; i++, values += ARRAY_SIZE(bme_fields))
+	{
+		memcpy(&field, raw->data + i * sizeof(field), sizeof(field));
+		values[0] = field.temp;
+		values[1] = field.pres;
+		values[2] = field.hum;
+		values[3] = field.gas_res > INT32_MAX ? INT32_MAX : field.gas_res;
+		values[4] = field.gas_index;
+		values[5] = field.heatr_temp;
+		values[6] = field.status;
+		values[7] = field.addr;
+	}
+	return EXIT_SUCCESS;
+}
+
+const struct sensor_driver bme_driver = {
+	.name = "bme",
+	.fields = bme_fields,
+	.n_fields = ARRAY_SIZE(bme_fields),
+	.init = bme_sensor_init,
+	.trigger = bme_sensor_trigger,
+	.ready = NULL,
+	.collect = bme_sensor_collect,
+	.decode = bme_sensor_decode,
+};
@@ -0,0 +1,182 @@
+/**
+ * @file    bringup.c
+ * @author  Jie Liu
+ * @version V1.0
+ * @date    2026-10-18
+ * @brief Concurrent sensor bring-up with a start-up trace
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include "bringup.h"
+#include "sensor.h"
+#include "common.h"
+#include "bus.h"
+#include "error.h"
+#include "timestamp.h"
+
+/**
+ * @brief open the bus, initialize, take the first result, publish
+ * @param[inout] arg struct bringup_job
+ * @return NULL
+ */
+static void* bringup_thread(void* arg) {
+
+    struct bringup_job* job = arg;
+    struct bringup* bringup = job->bringup;
+    struct sensor staged = *job->sensor;
+    struct sensor_raw raw;
+    int serial = bringup->serial && staged.mux_mask;
+
+    job->fd = bus_open(bringup->bus, O_RDWR | O_CLOEXEC);
+    job->open_ns = timestamp_ns() - bringup->start_ns;
+    if (job->fd < 0) {
+        job->result = errno;
+        print_error(job->result, staged.driver->name);
+        return NULL;
+    }
+    if (job->fd > UINT8_MAX) { // does not fit i2c_slave
+        bus_close(job->fd);
+        job->fd = -1;
+        job->result = ERROR_MAX_BUFFER_SIZE_REACHED;
+        print_error(job->result, staged.driver->name);
+        return NULL;
+    }
+
+    // another mux setting must not come in between
+    if (serial)
+        pthread_mutex_lock(&bringup->mux_lock);
+
+    job->result = sensor_open(&staged, job->fd);
+    job->init_ns = timestamp_ns() - bringup->start_ns;
+    if (job->result != EXIT_SUCCESS) {
+        if (serial)
+            pthread_mutex_unlock(&bringup->mux_lock);
+        print_warning(job->result, staged.driver->name);
+        return NULL;
+    }
+
+    // still private: nobody else triggers the sensor while this waits
+    job->result = sensor_acquire(&staged, &raw);
+    if (serial)
+        pthread_mutex_unlock(&bringup->mux_lock);
+    if (job->result == EXIT_SUCCESS && bringup->sink) {
+        pthread_mutex_lock(&bringup->lock);
+        bringup->sink(job->sensor, &raw, bringup->sink_arg);
+        pthread_mutex_unlock(&bringup->lock);
+    }
+    job->first_ns = timestamp_ns() - bringup->start_ns;
+
+    // up even without a first result, acquisition retries anyway
+    sensor_publish(job->sensor, &staged);
+
+    return NULL;
+}
+
+void bringup_init(struct bringup* bringup, const char* bus,
+        void (*sink)(const struct sensor* sensor, const struct sensor_raw* raw, void* arg),
+        void* sink_arg) {
+
+    memset(bringup, 0, sizeof(*bringup));
+    bringup->bus = bus;
+    bringup->sink = sink;
+    bringup->sink_arg = sink_arg;
+    pthread_mutex_init(&bringup->lock, NULL);
+    pthread_mutex_init(&bringup->mux_lock, NULL);
+}
+
+int bringup_add(struct bringup* bringup, enum sensor_id id) {
+
+    struct bringup_job* job;
+    struct sensor* sensor = sensor_get(id);
+
+    if (!sensor)
+        return ERROR_PARSER;
+    if (bringup->n_jobs >= SENSOR_COUNT)
+        return ERROR_MAX_BUFFER_SIZE_REACHED;
+
+    job = &bringup->jobs[bringup->n_jobs++];
+    memset(job, 0, sizeof(*job));
+    job->bringup = bringup;
+    job->sensor = sensor;
+    job->fd = -1;
+    job->result = ERROR_STATE_MACHINE; // until its thread ran
+
+    return EXIT_SUCCESS;
+}
+
+int bringup_start(struct bringup* bringup) {
+
+    uint8_t mask = 0;
+    size_t i;
+    int ret;
+
+    for (i = 0; i < bringup->n_jobs; ++i) {
+        if (bringup->jobs[i].sensor->mux_mask && mask
+            && bringup->jobs[i].sensor->mux_mask != mask)
+            bringup->serial = 1;
+        if (bringup->jobs[i].sensor->mux_mask)
+            mask = bringup->jobs[i].sensor->mux_mask;
+    }
+
+    bringup->start_ns = timestamp_ns();
+    for (i = 0; i < bringup->n_jobs; ++i) {
+        ret = pthread_create(&bringup->jobs[i].thread, NULL, bringup_thread, &bringup->jobs[i]);
+        if (ret != 0) {
+            print_error(ret, "cannot start bring-up thread");
+            bringup->n_jobs = i; // bringup_wait() joins the started ones
+            return ret;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+size_t bringup_wait(struct bringup* bringup) {
+
+    size_t failed = 0;
+    size_t i;
+
+    for (i = 0; i < bringup->n_jobs; ++i) {
+        pthread_join(bringup->jobs[i].thread, NULL);
+        if (bringup->jobs[i].result != EXIT_SUCCESS)
+            failed++;
+    }
+
+    return failed;
+}
+
+void bringup_report(const struct bringup* bringup, FILE* stream) {
+
+    const struct bringup_job* job;
+    size_t i;
+
+    fprintf(stream, "%-10s %10s %10s %10s %8s\n", "sensor", "open_ms", "init_ms", "first_ms",
+            "result");
+    for (i = 0; i < bringup->n_jobs; ++i) {
+        job = &bringup->jobs[i];
+        fprintf(stream, "%-10s %10.3f %10.3f %10.3f %8d\n", job->sensor->driver->name,
+                job->open_ns / 1e6, job->init_ns / 1e6, job->first_ns / 1e6, job->result);
+    }
+}
+
+void bringup_close(struct bringup* bringup) {
+
+    size_t i;
+
+    for (i = 0; i < bringup->n_jobs; ++i) {
+        if (bringup->jobs[i].fd >= 0)
+            i2c_close(bringup->jobs[i].fd);
+        bringup->jobs[i].fd = -1;
+    }
+    bringup->n_jobs = 0;
+    pthread_mutex_destroy(&bringup->lock);
+    pthread_mutex_destroy(&bringup->mux_lock);
+}
+
+// vim: expandtab ts=4 sw=4
@@ -0,0 +1,62 @@
+/**
+ * @file    bus.c
+ * @author  Jie Liu
+ * @version V1.0
+ * @date    2026-10-18
+ * @brief Pluggable backend under the I2C, SPI and UART primitives
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+#include "bus.h"
+
+static int bus_system_open(const char* path, int flags) {
+    return open(path, flags);
+}
+
+static int bus_system_ioctl(int fd, unsigned long request, void* arg) {
+    return ioctl(fd, request, arg);
+}
+
+const struct bus_backend bus_system = {
+    .name = "system",
+    .open = bus_system_open,
+    .close = close,
+    .read = read,
+    .write = write,
+    .ioctl = bus_system_ioctl,
+};
+
+static const struct bus_backend* bus_backend = &bus_system;
+
+void bus_set_backend(const struct bus_backend* backend) {
+    bus_backend = backend ? backend : &bus_system;
+}
+
+const struct bus_backend* bus_get_backend(void) {
+    return bus_backend;
+}
+
+int bus_open(const char* path, int flags) {
+    return bus_backend->open(path, flags);
+}
+
+int bus_close(int fd) {
+    return bus_backend->close(fd);
+}
+
+ssize_t bus_read(int fd, void* buf, size_t len) {
+    return bus_backend->read(fd, buf, len);
+}
+
+ssize_t bus_write(int fd, const void* buf, size_t len) {
+    return bus_backend->write(fd, buf, len);
+}
+
+int bus_ioctl(int fd, unsigned long request, void* arg) {
+    return bus_backend->ioctl(fd, request, arg);
+}
+
+// vim: expandtab ts=4 sw=4
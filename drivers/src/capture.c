@@ -0,0 +1,932 @@
+/**
+ * @file    capture.c
+ * @author  Jie Liu
+ * @version V1.0
+ * @date    2026-10-18
+ * @brief Capture of the bus transactions to a file, and their replay
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <poll.h>
+#include <termios.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#include <linux/spi/spidev.h>
+
+#include "capture.h"
+#include "common.h"
+#include "error.h"
+#include "timestamp.h"
+
+/** descriptors the tables cover, the drivers keep them in a uint8_t */
+#define CAPTURE_MAX_FILES (UINT8_MAX + 1)
+/** stdio buffer of the capture file [bytes] */
+#define CAPTURE_BUFFER_SIZE (64 * 1024)
+/** longest a feeder waits before looking at its stop flag [ms] */
+#define REPLAY_FEED_TIMEOUT 100
+
+/**
+ * @brief Is the request a SPI_IOC_MESSAGE(n)
+ * @param[in] request ioctl request
+ * @return 1 if so
+ */
+static int capture_is_spi_message(unsigned long request) {
+    return _IOC_TYPE(request) == SPI_IOC_MAGIC && _IOC_NR(request) == 0
+        && _IOC_DIR(request) == _IOC_WRITE;
+}
+
+/**
+ * @brief Is the path an I2C or SPI bus, anything else is a UART
+ * @param[in] path path, not necessarily null terminated
+ * @param[in] len length of path
+ * @return 1 if so
+ */
+static int capture_is_bus_path(const char* path, size_t len) {
+    return (len >= 9 && memcmp(path, "/dev/i2c-", 9) == 0)
+        || (len >= 11 && memcmp(path, "/dev/spidev", 11) == 0);
+}
+
+/**
+ * @brief Bytes an ioctl returns through its argument, besides the transfers
+ * @param[in] request ioctl request
+ * @return size [bytes]
+ */
+static size_t capture_ioctl_out_size(unsigned long request) {
+
+    if (request == I2C_FUNCS)
+        return sizeof(unsigned long);
+    if (_IOC_DIR(request) & _IOC_READ)
+        return _IOC_SIZE(request);
+    return 0;
+}
+
+/*
+ * capture
+ */
+
+/**
+ * @struct capture_file
+ * @brief what the capture keeps of an open descriptor
+ * @var bus I2C or SPI, 0 for a UART
+ * @var addr I2C: slave selected
+ * @var reg register pointer, CAPTURE_NO_REG if unknown
+ */
+struct capture_file {
+    uint8_t bus;
+    uint8_t addr;
+    uint16_t reg;
+};
+
+static pthread_mutex_t capture_lock = PTHREAD_MUTEX_INITIALIZER;
+static FILE* capture_out;
+static const struct bus_backend* capture_inner = &bus_system;
+static uint64_t capture_start_ns;
+static struct capture_file capture_files[CAPTURE_MAX_FILES];
+
+/**
+ * @brief Append payload bytes, zeros for a NULL buffer
+ */
+static void capture_bytes(const void* data, size_t len) {
+
+    if (data) {
+        fwrite(data, 1, len, capture_out);
+        return;
+    }
+    while (len--)
+        fputc(0, capture_out);
+}
+
+/**
+ * @brief Append a record, with capture_lock held
+ * @note the payload is a and b one after the other, cut at UINT16_MAX bytes
+ */
+static void capture_put(uint64_t stamp_ns, enum capture_kind kind, int fd, uint16_t addr,
+                        uint16_t reg, int32_t result, const void* a, size_t a_len,
+                        const void* b, size_t b_len) {
+
+    struct capture_record record;
+
+    if (!capture_out)
+        return;
+
+    if (a_len > UINT16_MAX)
+        a_len = UINT16_MAX;
+    if (a_len + b_len > UINT16_MAX)
+        b_len = UINT16_MAX - a_len;
+
+    record.stamp_ns = stamp_ns - capture_start_ns;
+    record.kind = kind;
+    record.fd = fd;
+    record.addr = addr;
+    record.reg = reg;
+    record.len = a_len + b_len;
+    record.result = result;
+    fwrite(&record, sizeof(record), 1, capture_out);
+    capture_bytes(a, a_len);
+    capture_bytes(b, b_len);
+}
+
+/**
+ * @brief State of a descriptor, with capture_lock held
+ * @return state, a scratch one for descriptors out of the table
+ */
+static struct capture_file* capture_file_get(int fd) {
+
+    static struct capture_file scratch;
+
+    if (fd < 0 || fd >= CAPTURE_MAX_FILES) {
+        scratch = (struct capture_file){ 0, 0, CAPTURE_NO_REG };
+        return &scratch;
+    }
+    return &capture_files[fd];
+}
+
+static int capture_open(const char* path, int flags) {
+
+    uint64_t stamp = timestamp_ns();
+    size_t len = strlen(path);
+    int fd = capture_inner->open(path, flags);
+    int err = errno;
+
+    pthread_mutex_lock(&capture_lock);
+    *capture_file_get(fd) = (struct capture_file){
+        .bus = capture_is_bus_path(path, len),
+        .addr = 0,
+        .reg = CAPTURE_NO_REG,
+    };
+    capture_put(stamp, CAPTURE_OPEN, fd, 0, CAPTURE_NO_REG, fd < 0 ? -err : fd,
+                path, len, NULL, 0);
+    pthread_mutex_unlock(&capture_lock);
+
+    errno = err;
+    return fd;
+}
+
+static int capture_close(int fd) {
+
+    uint64_t stamp = timestamp_ns();
+    int ret = capture_inner->close(fd);
+    int err = errno;
+
+    pthread_mutex_lock(&capture_lock);
+    capture_put(stamp, CAPTURE_CLOSE, fd, 0, CAPTURE_NO_REG, ret < 0 ? -err : ret,
+                NULL, 0, NULL, 0);
+    pthread_mutex_unlock(&capture_lock);
+
+    errno = err;
+    return ret;
+}
+
+static ssize_t capture_read(int fd, void* buf, size_t len) {
+
+    uint64_t stamp = timestamp_ns();
+    ssize_t ret = capture_inner->read(fd, buf, len);
+    int err = errno;
+    struct capture_file* file;
+
+    // polling a UART that has nothing is not a transaction
+    if (ret == 0 || (ret < 0 && (err == EAGAIN || err == EWOULDBLOCK))) {
+        errno = err;
+        return ret;
+    }
+
+    pthread_mutex_lock(&capture_lock);
+    file = capture_file_get(fd);
+    capture_put(stamp, CAPTURE_READ, fd, file->addr, file->reg, ret < 0 ? -err : ret,
+                buf, ret > 0 ? ret : 0, NULL, 0);
+    pthread_mutex_unlock(&capture_lock);
+
+    errno = err;
+    return ret;
+}
+
+static ssize_t capture_write(int fd, const void* buf, size_t len) {
+
+    uint64_t stamp = timestamp_ns();
+    ssize_t ret = capture_inner->write(fd, buf, len);
+    int err = errno;
+    struct capture_file* file;
+
+    pthread_mutex_lock(&capture_lock);
+    file = capture_file_get(fd);
+    if (file->bus && len)
+        file->reg = *(const uint8_t*)buf;
+    capture_put(stamp, CAPTURE_WRITE, fd, file->addr, file->bus ? file->reg : CAPTURE_NO_REG,
+                ret < 0 ? -err : ret, buf, len, NULL, 0);
+    pthread_mutex_unlock(&capture_lock);
+
+    errno = err;
+    return ret;
+}
+
+static int capture_ioctl(int fd, unsigned long request, void* arg) {
+
+    uint64_t stamp = timestamp_ns();
+    int ret = capture_inner->ioctl(fd, request, arg);
+    int err = errno;
+    int32_t result = ret < 0 ? -err : ret;
+    struct capture_file* file;
+    uint32_t request32 = request;
+    size_t out;
+
+    pthread_mutex_lock(&capture_lock);
+    file = capture_file_get(fd);
+
+    if (request == I2C_SLAVE || request == I2C_SLAVE_FORCE) {
+        if (ret >= 0)
+            file->addr = (uintptr_t)arg;
+        capture_put(stamp, CAPTURE_ADDR, fd, (uintptr_t)arg, CAPTURE_NO_REG, result,
+                    NULL, 0, NULL, 0);
+    } else if (request == I2C_RDWR) {
+        struct i2c_rdwr_ioctl_data* rdwr = arg;
+
+        for (__u32 i = 0; i < rdwr->nmsgs; ++i) {
+            struct i2c_msg* msg = &rdwr->msgs[i];
+            int read = msg->flags & I2C_M_RD;
+
+            if (!read && msg->len)
+                file->reg = msg->buf[0];
+            capture_put(stamp, read ? CAPTURE_I2C_READ : CAPTURE_I2C_WRITE, fd, msg->addr,
+                        file->reg, result, msg->buf, read && ret < 0 ? 0 : msg->len, NULL, 0);
+        }
+    } else if (capture_is_spi_message(request)) {
+        struct spi_ioc_transfer* xfer = arg;
+        size_t n = _IOC_SIZE(request) / sizeof(*xfer);
+
+        for (size_t i = 0; i < n; ++i) {
+            const uint8_t* tx = (const uint8_t*)(uintptr_t)xfer[i].tx_buf;
+            const uint8_t* rx = (const uint8_t*)(uintptr_t)xfer[i].rx_buf;
+
+            capture_put(stamp, CAPTURE_SPI, fd, 0,
+                        tx && xfer[i].len ? tx[0] & 0x7F : CAPTURE_NO_REG, result,
+                        tx, xfer[i].len, ret < 0 ? NULL : rx, xfer[i].len);
+        }
+    } else {
+        out = ret < 0 || !arg ? 0 : capture_ioctl_out_size(request);
+        capture_put(stamp, CAPTURE_IOCTL, fd, 0, CAPTURE_NO_REG, result,
+                    &request32, sizeof(request32), arg, out);
+    }
+    pthread_mutex_unlock(&capture_lock);
+
+    errno = err;
+    return ret;
+}
+
+const struct bus_backend capture_backend = {
+    .name = "capture",
+    .open = capture_open,
+    .close = capture_close,
+    .read = capture_read,
+    .write = capture_write,
+    .ioctl = capture_ioctl,
+};
+
+int capture_start(const char* path) {
+
+    struct capture_header header = { .magic = CAPTURE_MAGIC };
+    struct timestamp_anchor anchor;
+    int ret;
+
+    pthread_mutex_lock(&capture_lock);
+    if (capture_out) {
+        pthread_mutex_unlock(&capture_lock);
+        return ERROR_UNDEFINED_STATE;
+    }
+
+    capture_out = fopen(path, "wb");
+    if (!capture_out) {
+        ret = errno;
+        pthread_mutex_unlock(&capture_lock);
+        print_errno("cannot open the capture file");
+        return ret;
+    }
+    setvbuf(capture_out, NULL, _IOFBF, CAPTURE_BUFFER_SIZE);
+
+    timestamp_anchor(&anchor);
+    capture_start_ns = header.monotonic_ns = anchor.monotonic_ns;
+    header.realtime_ns = anchor.realtime_ns;
+    fwrite(&header, sizeof(header), 1, capture_out);
+
+    for (int fd = 0; fd < CAPTURE_MAX_FILES; ++fd)
+        capture_files[fd] = (struct capture_file){ 0, 0, CAPTURE_NO_REG };
+    capture_inner = bus_get_backend();
+    bus_set_backend(&capture_backend);
+    pthread_mutex_unlock(&capture_lock);
+
+    return EXIT_SUCCESS;
+}
+
+void capture_stop(void) {
+
+    pthread_mutex_lock(&capture_lock);
+    if (capture_out) {
+        bus_set_backend(capture_inner);
+        fclose(capture_out);
+        capture_out = NULL;
+    }
+    pthread_mutex_unlock(&capture_lock);
+}
+
+/*
+ * replay
+ */
+
+/**
+ * @struct replay_record
+ * @brief a record of the loaded file
+ * @var rec record
+ * @var payload its bytes
+ * @var used answered a call, or skipped
+ * @var stream UART read, fed to the terminal instead of matched
+ */
+struct replay_record {
+    const struct capture_record* rec;
+    const uint8_t* payload;
+    uint8_t used;
+    uint8_t stream;
+};
+
+/**
+ * @struct replay_file
+ * @brief an open replayed file
+ * @var open in use
+ * @var stream UART, answered through a pseudo terminal
+ * @var addr I2C: slave selected
+ * @var rfd descriptor in the recording
+ * @var first index of the open record
+ * @var master UART: our side of the terminal
+ * @var feeder UART: writes the recorded bytes to master
+ * @var stop UART: tells the feeder to stop
+ */
+struct replay_file {
+    uint8_t open;
+    uint8_t stream;
+    uint8_t addr;
+    int rfd;
+    size_t first;
+    int master;
+    pthread_t feeder;
+    atomic_int stop;
+};
+
+static pthread_mutex_t replay_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint8_t* replay_data;
+static struct replay_record* replay_records;
+static size_t replay_count;
+static size_t replay_cursor;
+static enum replay_speed replay_speed;
+static uint64_t replay_base_ns;
+static struct replay_stats replay_stats;
+static struct replay_file replay_files[CAPTURE_MAX_FILES];
+
+/**
+ * @brief Wait for the recorded time of a record, REPLAY_RECORDED only
+ * @param[in] rec record
+ * @param[in] stop stop waiting once set, NULL to wait it out
+ */
+static void replay_pace(const struct capture_record* rec, atomic_int* stop) {
+
+    uint64_t target = replay_base_ns + rec->stamp_ns;
+    uint64_t now;
+    uint64_t until;
+    struct timespec ts;
+
+    if (replay_speed != REPLAY_RECORDED)
+        return;
+
+    while ((now = timestamp_ns()) < target && !(stop && atomic_load(stop))) {
+        until = stop && target - now > REPLAY_FEED_TIMEOUT * 1000000ULL
+            ? now + REPLAY_FEED_TIMEOUT * 1000000ULL : target;
+        ts.tv_sec = until / 1000000000;
+        ts.tv_nsec = until % 1000000000;
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+    }
+}
+
+/**
+ * @brief Mark a record as not asked for, with replay_lock held
+ */
+static void replay_skip(struct replay_record* r) {
+    r->used = 1;
+    ++replay_stats.skipped;
+}
+
+/**
+ * @brief Find the record answering a call, with replay_lock held
+ * @note candidates are the records of the same descriptor and, with addr
+ * given, slave; the first REPLAY_LOOKAHEAD of them are looked at. Earlier
+ * candidates than the match are skipped: a descriptor and slave are driven
+ * by one thread at a time, so the drivers no longer ask for them.
+ * @param[in] kind kind of the call
+ * @param[in] rfd descriptor in the recording, ignored for CAPTURE_OPEN
+ * @param[in] addr slave, -1 for any
+ * @param[in] key path for CAPTURE_OPEN, payload prefix otherwise
+ * @param[in] key_len bytes of key
+ * @return record, NULL if none
+ */
+static struct replay_record* replay_match(enum capture_kind kind, int rfd, int addr,
+                                          const void* key, size_t key_len) {
+
+    struct replay_record* r;
+    size_t candidates = 0;
+    size_t end = replay_cursor + 2 * REPLAY_HORIZON;
+    size_t i, j;
+
+    for (i = replay_cursor; i < replay_count && i < end; ++i) {
+        r = &replay_records[i];
+        if (r->used || r->stream)
+            continue;
+        if (kind == CAPTURE_OPEN ? r->rec->kind != CAPTURE_OPEN
+                                 : r->rec->fd != rfd || (addr >= 0 && r->rec->addr != addr))
+            continue;
+        if (++candidates > REPLAY_LOOKAHEAD)
+            break;
+        if (r->rec->kind != kind || r->rec->len < key_len
+            || (kind == CAPTURE_OPEN && r->rec->len != key_len)
+            || memcmp(r->payload, key, key_len))
+            continue;
+
+        r->used = 1;
+        ++replay_stats.replayed;
+        for (j = replay_cursor; kind != CAPTURE_OPEN && j < i; ++j)
+            if (!replay_records[j].used && !replay_records[j].stream
+                && replay_records[j].rec->fd == rfd
+                && (addr < 0 || replay_records[j].rec->addr == addr))
+                replay_skip(&replay_records[j]);
+        for (; replay_cursor + REPLAY_HORIZON < i; ++replay_cursor)
+            if (!replay_records[replay_cursor].used && !replay_records[replay_cursor].stream)
+                replay_skip(&replay_records[replay_cursor]);
+        while (replay_cursor < replay_count
+               && (replay_records[replay_cursor].used || replay_records[replay_cursor].stream))
+            ++replay_cursor;
+        return r;
+    }
+
+    ++replay_stats.unmatched;
+    return NULL;
+}
+
+/**
+ * @brief Replayed file of a descriptor
+ * @return file, NULL if not replayed
+ */
+static struct replay_file* replay_file_get(int fd) {
+
+    if (fd < 0 || fd >= CAPTURE_MAX_FILES || !replay_files[fd].open)
+        return NULL;
+    return &replay_files[fd];
+}
+
+/**
+ * @brief Feed the recorded UART reads of a file to its terminal
+ */
+static void* replay_feeder(void* arg) {
+
+    struct replay_file* file = arg;
+    struct pollfd pfd = { .fd = file->master, .events = POLLOUT };
+    struct replay_record* r;
+    size_t written;
+    ssize_t n;
+
+    for (size_t i = file->first + 1; i < replay_count && !atomic_load(&file->stop); ++i) {
+        r = &replay_records[i];
+        if (r->rec->fd != file->rfd)
+            continue;
+        if (r->rec->kind == CAPTURE_OPEN || r->rec->kind == CAPTURE_CLOSE)
+            break;
+        if (!r->stream)
+            continue;
+
+        replay_pace(r->rec, &file->stop);
+        for (written = 0; written < r->rec->len && !atomic_load(&file->stop); ) {
+            n = write(file->master, r->payload + written, r->rec->len - written);
+            if (n > 0)
+                written += n;
+            else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                poll(&pfd, 1, REPLAY_FEED_TIMEOUT);
+            else
+                return NULL;
+        }
+
+        pthread_mutex_lock(&replay_lock);
+        r->used = 1;
+        ++replay_stats.replayed;
+        pthread_mutex_unlock(&replay_lock);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Open a raw pseudo terminal, the UART of a replay
+ * @param[out] master our side
+ * @param[in] flags open flags of the slave side
+ * @return slave side, -1 with errno set on error
+ */
+static int replay_pty(int* master, int flags) {
+
+    char path[64];
+    struct termios raw;
+    int fd;
+
+    *master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (*master < 0)
+        return -1;
+    if (grantpt(*master) || unlockpt(*master) || ptsname_r(*master, path, sizeof(path))
+        || (fd = open(path, flags | O_NOCTTY)) < 0) {
+        int err = errno;
+
+        close(*master);
+        errno = err;
+        return -1;
+    }
+    // no echo of what the drivers write, no line editing
+    if (tcgetattr(fd, &raw) == 0) {
+        cfmakeraw(&raw);
+        tcsetattr(fd, TCSANOW, &raw);
+    }
+
+    return fd;
+}
+
+static int replay_open_file(const char* path, int flags) {
+
+    struct replay_record* r;
+    struct replay_file* file;
+    int stream = !capture_is_bus_path(path, strlen(path));
+    int master = -1;
+    int fd;
+    int ret;
+
+    pthread_mutex_lock(&replay_lock);
+    r = replay_match(CAPTURE_OPEN, -1, -1, path, strlen(path));
+    pthread_mutex_unlock(&replay_lock);
+    if (!r) {
+        errno = ENOENT;
+        return -1;
+    }
+    replay_pace(r->rec, NULL);
+    if (r->rec->result < 0) {
+        errno = -r->rec->result;
+        return -1;
+    }
+
+    // a real descriptor keeps the number unique in the process
+    fd = stream ? replay_pty(&master, flags) : open("/dev/null", O_RDWR | (flags & O_CLOEXEC));
+    if (fd < 0)
+        return -1;
+    if (fd >= CAPTURE_MAX_FILES) {
+        close(fd);
+        if (master >= 0)
+            close(master);
+        errno = EMFILE;
+        return -1;
+    }
+
+    pthread_mutex_lock(&replay_lock);
+    file = &replay_files[fd];
+    file->open = 1;
+    file->stream = stream;
+    file->addr = 0;
+    file->rfd = r->rec->fd;
+    file->first = r - replay_records;
+    file->master = master;
+    atomic_init(&file->stop, 0);
+    if (stream && (ret = pthread_create(&file->feeder, NULL, replay_feeder, file))) {
+        file->open = 0;
+        pthread_mutex_unlock(&replay_lock);
+        close(fd);
+        close(master);
+        errno = ret;
+        return -1;
+    }
+    pthread_mutex_unlock(&replay_lock);
+
+    return fd;
+}
+
+/**
+ * @brief Stop the feeder of a UART and close its terminal
+ */
+static void replay_stop_feeder(struct replay_file* file) {
+
+    if (!file->stream)
+        return;
+    atomic_store(&file->stop, 1);
+    pthread_join(file->feeder, NULL);
+    close(file->master);
+}
+
+static int replay_close_file(int fd) {
+
+    struct replay_file* file;
+
+    pthread_mutex_lock(&replay_lock);
+    file = replay_file_get(fd);
+    if (file)
+        replay_match(CAPTURE_CLOSE, file->rfd, -1, NULL, 0);
+    pthread_mutex_unlock(&replay_lock);
+
+    if (file) {
+        replay_stop_feeder(file);
+        pthread_mutex_lock(&replay_lock);
+        file->open = 0;
+        pthread_mutex_unlock(&replay_lock);
+    }
+
+    return close(fd);
+}
+
+static ssize_t replay_read(int fd, void* buf, size_t len) {
+
+    struct replay_file* file;
+    struct replay_record* r;
+    int32_t result;
+
+    pthread_mutex_lock(&replay_lock);
+    file = replay_file_get(fd);
+    if (!file || file->stream) {
+        pthread_mutex_unlock(&replay_lock);
+        // the terminal has what the feeder wrote
+        return read(fd, buf, len);
+    }
+    r = replay_match(CAPTURE_READ, file->rfd, file->addr, NULL, 0);
+    if (r)
+        memcpy(buf, r->payload, len < r->rec->len ? len : r->rec->len);
+    pthread_mutex_unlock(&replay_lock);
+
+    if (!r) {
+        errno = EIO;
+        return -1;
+    }
+    replay_pace(r->rec, NULL);
+    result = r->rec->result;
+    if (result < 0) {
+        errno = -result;
+        return -1;
+    }
+    return (size_t)result < len ? (size_t)result : len;
+}
+
+static ssize_t replay_write(int fd, const void* buf, size_t len) {
+
+    struct replay_file* file;
+    struct replay_record* r;
+    int stream;
+
+    pthread_mutex_lock(&replay_lock);
+    file = replay_file_get(fd);
+    if (!file) {
+        pthread_mutex_unlock(&replay_lock);
+        return write(fd, buf, len);
+    }
+    stream = file->stream;
+    r = replay_match(CAPTURE_WRITE, file->rfd, stream ? -1 : file->addr, NULL, 0);
+    if (r && (r->rec->len != len || memcmp(r->payload, buf, len)))
+        ++replay_stats.mismatches;
+    pthread_mutex_unlock(&replay_lock);
+
+    if (!r) {
+        // nobody listens to what a UART is told
+        if (stream)
+            return len;
+        errno = EIO;
+        return -1;
+    }
+    replay_pace(r->rec, NULL);
+    if (r->rec->result < 0) {
+        errno = -r->rec->result;
+        return -1;
+    }
+    return r->rec->result;
+}
+
+/**
+ * @brief Messages of an I2C_RDWR, with replay_lock held
+ * @param[out] last record of the last message
+ * @return >= 0, -errno on error
+ */
+static int replay_i2c_rdwr(struct replay_file* file, struct i2c_rdwr_ioctl_data* rdwr,
+                           struct replay_record** last) {
+
+    struct replay_record* r;
+
+    for (__u32 i = 0; i < rdwr->nmsgs; ++i) {
+        struct i2c_msg* msg = &rdwr->msgs[i];
+        int read = msg->flags & I2C_M_RD;
+
+        r = replay_match(read ? CAPTURE_I2C_READ : CAPTURE_I2C_WRITE, file->rfd, msg->addr,
+                         NULL, 0);
+        if (!r)
+            return -EIO;
+        *last = r;
+        if (read)
+            memcpy(msg->buf, r->payload, msg->len < r->rec->len ? msg->len : r->rec->len);
+        else if (r->rec->len != msg->len || memcmp(r->payload, msg->buf, msg->len))
+            ++replay_stats.mismatches;
+        if (r->rec->result < 0)
+            return r->rec->result;
+    }
+
+    return rdwr->nmsgs;
+}
+
+/**
+ * @brief Transfers of a SPI_IOC_MESSAGE(n), with replay_lock held
+ * @param[out] last record of the last transfer
+ * @return >= 0, -errno on error
+ */
+static int replay_spi_message(struct replay_file* file, struct spi_ioc_transfer* xfer,
+                              size_t n, struct replay_record** last) {
+
+    struct replay_record* r;
+    size_t bytes = 0;
+    size_t half;
+
+    for (size_t i = 0; i < n; ++i) {
+        const uint8_t* tx = (const uint8_t*)(uintptr_t)xfer[i].tx_buf;
+        uint8_t* rx = (uint8_t*)(uintptr_t)xfer[i].rx_buf;
+
+        r = replay_match(CAPTURE_SPI, file->rfd, -1, NULL, 0);
+        if (!r)
+            return -EIO;
+        *last = r;
+        half = r->rec->len / 2;
+        if (tx && (half != xfer[i].len || memcmp(r->payload, tx, half)))
+            ++replay_stats.mismatches;
+        if (rx)
+            memcpy(rx, r->payload + half, xfer[i].len < half ? xfer[i].len : half);
+        if (r->rec->result < 0)
+            return r->rec->result;
+        bytes += xfer[i].len;
+    }
+
+    return bytes;
+}
+
+static int replay_ioctl(int fd, unsigned long request, void* arg) {
+
+    struct replay_file* file;
+    struct replay_record* r = NULL;
+    uint32_t request32 = request;
+    size_t out;
+    int ret = 0;
+
+    pthread_mutex_lock(&replay_lock);
+    file = replay_file_get(fd);
+    if (!file) {
+        pthread_mutex_unlock(&replay_lock);
+        return ioctl(fd, request, arg);
+    }
+
+    if (request == I2C_SLAVE || request == I2C_SLAVE_FORCE) {
+        file->addr = (uintptr_t)arg;
+        r = replay_match(CAPTURE_ADDR, file->rfd, file->addr, NULL, 0);
+        ret = r ? r->rec->result : 0;
+    } else if (request == I2C_RDWR) {
+        ret = replay_i2c_rdwr(file, arg, &r);
+    } else if (capture_is_spi_message(request)) {
+        ret = replay_spi_message(file, arg, _IOC_SIZE(request) / sizeof(struct spi_ioc_transfer),
+                                 &r);
+    } else {
+        // bus setup the recording does not have succeeds
+        r = replay_match(CAPTURE_IOCTL, file->rfd, -1, &request32, sizeof(request32));
+        if (r) {
+            out = r->rec->len - sizeof(request32);
+            if (arg && out && out <= capture_ioctl_out_size(request))
+                memcpy(arg, r->payload + sizeof(request32), out);
+            ret = r->rec->result;
+        }
+    }
+    pthread_mutex_unlock(&replay_lock);
+
+    if (r)
+        replay_pace(r->rec, NULL);
+    if (ret < 0) {
+        errno = -ret;
+        return -1;
+    }
+    return ret;
+}
+
+const struct bus_backend replay_backend = {
+    .name = "replay",
+    .open = replay_open_file,
+    .close = replay_close_file,
+    .read = replay_read,
+    .write = replay_write,
+    .ioctl = replay_ioctl,
+};
+
+int replay_open(const char* path, enum replay_speed speed) {
+
+    const struct capture_record* rec;
+    uint8_t stream[CAPTURE_MAX_FILES] = { 0 };
+    FILE* in;
+    long size;
+    size_t offset;
+    size_t n;
+
+    if (replay_data)
+        return ERROR_UNDEFINED_STATE;
+
+    in = fopen(path, "rb");
+    if (!in) {
+        print_errno("cannot open the capture file");
+        return errno;
+    }
+    if (fseek(in, 0, SEEK_END) || (size = ftell(in)) < 0 || fseek(in, 0, SEEK_SET)) {
+        print_errno("cannot read the capture file");
+        fclose(in);
+        return errno;
+    }
+    replay_data = malloc(size ? size : 1);
+    if (!replay_data || fread(replay_data, 1, size, in) != (size_t)size
+        || (size_t)size < sizeof(struct capture_header)
+        || memcmp(replay_data, CAPTURE_MAGIC, 8)) {
+        fclose(in);
+        replay_close();
+        print_error(ERROR_PARSER, "not a capture file");
+        return ERROR_PARSER;
+    }
+    fclose(in);
+
+    // two passes, counting then indexing; a truncated last record is dropped
+    for (int pass = 0; pass < 2; ++pass) {
+        offset = sizeof(struct capture_header);
+        for (n = 0; offset + sizeof(*rec) <= (size_t)size; ++n) {
+            rec = (const struct capture_record*)(replay_data + offset);
+            if (offset + sizeof(*rec) + rec->len > (size_t)size)
+                break;
+            if (pass) {
+                replay_records[n].rec = rec;
+                replay_records[n].payload = replay_data + offset + sizeof(*rec);
+                replay_records[n].used = 0;
+                if (rec->kind == CAPTURE_OPEN && rec->result >= 0)
+                    stream[rec->fd] = !capture_is_bus_path((const char*)replay_records[n].payload,
+                                                           rec->len);
+                replay_records[n].stream = rec->kind == CAPTURE_READ && stream[rec->fd];
+            }
+            offset += sizeof(*rec) + rec->len;
+        }
+        if (!pass) {
+            replay_records = calloc(n ? n : 1, sizeof(*replay_records));
+            if (!replay_records) {
+                replay_close();
+                print_errno("cannot index the capture file");
+                return ENOMEM;
+            }
+        }
+    }
+
+    pthread_mutex_lock(&replay_lock);
+    replay_count = n;
+    replay_cursor = 0;
+    replay_speed = speed;
+    memset(&replay_stats, 0, sizeof(replay_stats));
+    replay_stats.records = n;
+    memset(replay_files, 0, sizeof(replay_files));
+    replay_base_ns = timestamp_ns();
+    pthread_mutex_unlock(&replay_lock);
+
+    return EXIT_SUCCESS;
+}
+
+void replay_get_stats(struct replay_stats* stats) {
+    pthread_mutex_lock(&replay_lock);
+    *stats = replay_stats;
+    pthread_mutex_unlock(&replay_lock);
+}
+
+void replay_close(void) {
+
+    for (int fd = 0; fd < CAPTURE_MAX_FILES; ++fd)
+        if (replay_files[fd].open) {
+            replay_stop_feeder(&replay_files[fd]);
+            replay_files[fd].open = 0;
+        }
+
+    pthread_mutex_lock(&replay_lock);
+    for (size_t i = 0; i < replay_count; ++i)
+        if (!replay_records[i].used)
+            ++replay_stats.skipped;
+    free(replay_records);
+    free(replay_data);
+    replay_records = NULL;
+    replay_data = NULL;
+    replay_count = 0;
+    pthread_mutex_unlock(&replay_lock);
+}
+
+// vim: expandtab ts=4 sw=4
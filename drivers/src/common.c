@@ -19,14 +19,12 @@
 #include <linux/spi/spidev.h>
 #include <termios.h>
 #include <assert.h>
+#include <time.h>
 
 #include "common.h"
+#include "bus.h"
 #include "error.h"
-#include "apds.h"
-#include "bme.h"
-#include "lis2.h"
-#include "mlx.h"
-#include "csv_manipulation.h"
+#include "regcache.h"
 
 #ifdef I2C_DEBUG
 void print_reg(dev_reg* reg) {
@@ -69,7 +67,7 @@ int i2c_read_no_reg(int* bus, uint8_t slave_addr, dev_reg* reg) {
     packet.msgs = messages;
     packet.nmsgs = 1;
 
-    if (ioctl(*bus, I2C_RDWR, &packet) == -1) {
+    if (bus_ioctl(*bus, I2C_RDWR, &packet) == -1) {
         print_errno("can't send message to slave");
         return errno;
     }
@@ -100,7 +98,7 @@ int i2c_write_no_reg(int* bus, uint8_t slave_addr, dev_reg* reg) {
     packet.msgs = messages;
     packet.nmsgs = 1;
 
-    if (ioctl(*bus, I2C_RDWR, &packet) == -1) {
+    if (bus_ioctl(*bus, I2C_RDWR, &packet) == -1) {
         print_errno("can't send message to slave");
         return errno;
     }
@@ -115,33 +113,33 @@ int spi_open(int* bus, char* block_device, uint8_t mode, uint8_t bits,
     DEBUG_INFO("opening %s", block_device);
 #endif /* SPI_DEBUG */
 
-    *bus = open(block_device, O_RDWR);
+    *bus = bus_open(block_device, O_RDWR);
 
-    if (bus < 0) {
+    if (*bus < 0) {
         print_errno("bus cannot open");
         return errno;
     }
-    if (ioctl(*bus, SPI_IOC_WR_MODE, &mode) == -1) {
+    if (bus_ioctl(*bus, SPI_IOC_WR_MODE, &mode) == -1) {
         print_errno("mode cannot be set");
         return errno;
     }
-    if (ioctl(*bus, SPI_IOC_RD_MODE, &mode) == -1) {
+    if (bus_ioctl(*bus, SPI_IOC_RD_MODE, &mode) == -1) {
         print_errno("mode cannot be read");
         return errno;
     }
-    if (ioctl(*bus, SPI_IOC_WR_BITS_PER_WORD, &bits) == -1) {
+    if (bus_ioctl(*bus, SPI_IOC_WR_BITS_PER_WORD, &bits) == -1) {
         print_errno("can't set number of bits");
         return errno;
     }
-    if (ioctl(*bus, SPI_IOC_RD_BITS_PER_WORD, &bits) == -1) {
+    if (bus_ioctl(*bus, SPI_IOC_RD_BITS_PER_WORD, &bits) == -1) {
         print_errno("can't read number of bits");
         return errno;
     }
-    if (ioctl(*bus, SPI_IOC_WR_MAX_SPEED_HZ, &speed) == -1) {
+    if (bus_ioctl(*bus, SPI_IOC_WR_MAX_SPEED_HZ, &speed) == -1) {
         print_errno("can't set speed");
         return errno;
     }
-    if (ioctl(*bus, SPI_IOC_RD_MAX_SPEED_HZ, &speed) == -1) {
+    if (bus_ioctl(*bus, SPI_IOC_RD_MAX_SPEED_HZ, &speed) == -1) {
         print_errno("can't read speed");
         return errno;
     }
@@ -171,7 +169,7 @@ void spi_close(int* bus) {
     DEBUG_INFO();
 #endif /* SPI_DEBUG */
 
-    close(*bus);
+    bus_close(*bus);
 }
 
 int spi_read(int* bus, dev_reg* reg) {
@@ -194,7 +192,7 @@ int spi_read(int* bus, dev_reg* reg) {
     transfer[0].rx_buf = (unsigned long) rx;
     transfer[0].len = reg->size;
 
-    if (ioctl(*bus, SPI_IOC_MESSAGE(1), transfer) == -1) {
+    if (bus_ioctl(*bus, SPI_IOC_MESSAGE(1), transfer) == -1) {
         print_errno("can't send");
         return errno;
     }
@@ -223,7 +221,7 @@ int spi_write(int* bus, dev_reg* reg) {
     transfer[0].tx_buf = (unsigned long) tx;
     transfer[0].len = reg->size + 1;
 
-    if (ioctl(*bus, SPI_IOC_MESSAGE(1), transfer) == -1) {
+    if (bus_ioctl(*bus, SPI_IOC_MESSAGE(1), transfer) == -1) {
         print_errno("can't send");
         return errno;
     }
@@ -255,7 +253,7 @@ int uart_init(int* dev, char* block_device, unsigned int speed) {
 
     struct termios uart;
 
-    *dev = open(block_device, O_RDWR | O_NOCTTY | O_NDELAY);
+    *dev = bus_open(block_device, O_RDWR | O_NOCTTY | O_NDELAY);
 
     if (*dev < 0) {
         print_errno("Device can't open");
@@ -282,12 +280,14 @@ int uart_init(int* dev, char* block_device, unsigned int speed) {
      * don't stip 8th bit on input
      * don't convert case (A and a)
      * turn off software flow control
+     * don't translate CR and NL, NMEA messages end in CR-NL
      */
     uart.c_iflag |= IGNPAR;
     uart.c_iflag &= ~PARMRK;
     uart.c_iflag &= ~ISTRIP;
     uart.c_iflag &= ~IUCLC;
     uart.c_iflag &= ~(IXON | IXOFF | IXANY);
+    uart.c_iflag &= ~(INLCR | IGNCR | ICRNL);
 
     /* Output mode flags
      * map NL to CR-NL
@@ -338,7 +338,7 @@ int uart_init(int* dev, char* block_device, unsigned int speed) {
 }
 
 void uart_close(int* dev) {
-    close(*dev);
+    bus_close(*dev);
 }
 
 int uart_write(int* dev, char* message) {
@@ -350,7 +350,7 @@ int uart_write(int* dev, char* message) {
     int count = 0;
     int length = strlen(message);
 
-    count = write(*dev, message, length);
+    count = bus_write(*dev, message, length);
     if (count < 0) {
         print_errno("Could not write to device");
         return errno;
@@ -371,7 +371,7 @@ int uart_read(int* dev, char* message) {
 
     int count = 0;
 
-    count = read(*dev, message, MESSAGE_SIZE);
+    count = bus_read(*dev, message, MESSAGE_SIZE);
     if (count < 0) {
         print_warning(ERROR_READ_REGISTER_FAILS,"could not read from device");
         return ERROR_READ_REGISTER_FAILS;
@@ -384,17 +384,68 @@ int uart_read(int* dev, char* message) {
     return EXIT_SUCCESS;
 }
 
+int uart_read_pending(int* dev, char* buffer, size_t size, size_t* count) {
+
+    ssize_t ret;
+
+    *count = 0;
+
+    ret = bus_read(*dev, buffer, size);
+    if (ret < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return ERROR_NOTHING_TO_READ;
+        print_errno("could not read from device");
+        return errno;
+    }
+    if (ret == 0)
+        return ERROR_NOTHING_TO_READ;
+
+    *count = ret;
+
+    return EXIT_SUCCESS;
+}
+
+/** slave address last selected on each bus fd, 0 if unknown */
+static uint8_t i2c_current_addr[UINT8_MAX + 1];
+
 void i2c_close(uint8_t dev)
 {
-	close(dev);
+	bus_close(dev);
+	// the descriptor may come back for another bus
+	i2c_current_addr[dev] = 0;
+	regcache_invalidate(dev, REGCACHE_ANY_ADDR);
+}
+
+uint8_t i2c_get_address(uint8_t dev)
+{
+	return i2c_current_addr[dev];
 }
 
 void i2c_set_address(uint8_t dev, int addr)
 {
-	if (ioctl(dev, I2C_SLAVE, addr) < 0) {
+	if (bus_ioctl(dev, I2C_SLAVE, (void *)(intptr_t)addr) < 0) {
 		perror("i2c set address");
 		exit(1);
 	}
+	i2c_current_addr[dev] = addr;
+}
+
+/**
+ * @brief select a slave unless it is already selected
+ * @param[in] slave slave to select
+ * @return 0 on success, 1 otherwise
+ */
+static int8_t i2c_select(const i2c_slave *slave)
+{
+	if (i2c_current_addr[slave->fd] == slave->addr)
+		return 0;
+	if (bus_ioctl(slave->fd, I2C_SLAVE, (void *)(intptr_t)slave->addr) < 0) {
+		perror("i2c set address");
+		i2c_current_addr[slave->fd] = 0;
+		return 1;
+	}
+	i2c_current_addr[slave->fd] = slave->addr;
+	return 0;
 }
 
 void delay_us(uint32_t period, void *intf_ptr)
@@ -410,13 +461,13 @@ int8_t i2c_write(uint8_t reg_addr, const uint8_t *reg_data, uint32_t len, void *
 {
     int8_t rslt = 0;
 	uint8_t dev = *(uint8_t *)intf_ptr; // the i2c fd
-	uint8_t reg[16];
+	uint8_t reg[2 * REGISTER_DATA_SIZE];
     reg[0] = reg_addr;
-	assert(len < 16);
+	assert(len < sizeof(reg)); // Bosch interleaved writes take up to 19 bytes
 
     for (int i=1; i<len+1; i++)
        reg[i] = reg_data[i-1];
-    int rc = write(dev, reg, len+1);
+    int rc = bus_write(dev, reg, len+1);
 	if (rc != len+1) {
         fprintf(stderr, "write dev=0x%x,0x%x,0x%x,len=%d => %d\n", dev, reg[0], reg[1],
 				len, rc);
@@ -435,95 +486,93 @@ int8_t i2c_read_8bit(uint8_t reg_addr, uint8_t *reg_data, uint32_t len, void *in
 {
 	uint8_t dev = *(uint8_t *)intf_ptr;
 
-	if (write(dev, &reg_addr, 1) != 1) {
+	if (bus_write(dev, &reg_addr, 1) != 1) {
 		perror("i2c write addr");
 		return 1;
 	}
-	if (read(dev, reg_data, len) != len) {
+	if (bus_read(dev, reg_data, len) != len) {
 		perror("i2c read data");
 		return 1;
 	}
     return 0;
 }
 
-int8_t i2c_read_16bit(uint8_t dev, uint16_t reg_addr, uint16_t *reg_data, uint16_t len)
+int8_t i2c_slave_write(uint8_t reg_addr, const uint8_t *reg_data, uint32_t len, void *intf_ptr)
 {
-    int8_t rslt = 0;
- 	if (write(dev, &reg_addr, 2) != 1) {
-		perror("i2c write addr");
-		rslt = 1;
+	i2c_slave *slave = intf_ptr;
+
+	if (i2c_select(slave))
+		return 1;
+	return i2c_write(reg_addr, reg_data, len, &slave->fd);
+}
+
+int8_t i2c_slave_read(uint8_t reg_addr, uint8_t *reg_data, uint32_t len, void *intf_ptr)
+{
+	i2c_slave *slave = intf_ptr;
+
+	if (i2c_select(slave))
+		return 1;
+	return i2c_read_8bit(reg_addr, reg_data, len, &slave->fd);
+}
+
+int8_t i2c_slave_read_16bit(const i2c_slave *slave, uint16_t reg_addr, uint16_t *reg_data,
+							uint16_t len)
+{
+	uint8_t addr[2] = { reg_addr >> 8, reg_addr & 0xFF };
+	uint8_t *data = (uint8_t *)reg_data;
+	struct i2c_msg msgs[2] = {
+		{ .addr = slave->addr, .flags = 0, .len = sizeof(addr), .buf = addr },
+		{ .addr = slave->addr, .flags = I2C_M_RD, .len = len * 2, .buf = data },
+	};
+	struct i2c_rdwr_ioctl_data xfer = { .msgs = msgs, .nmsgs = ARRAY_SIZE(msgs) };
+
+	// address and data in one transfer with a repeated start
+	if (bus_ioctl(slave->fd, I2C_RDWR, &xfer) < 0) {
+		perror("i2c read 16bit");
+		return 1;
 	}
-	if (read(dev, reg_data, len) != len) {
-		perror("i2c read data");
-		rslt = 1;
+
+	// words are sent MSB first
+	for (uint16_t i = 0; i < len; i++)
+		reg_data[i] = (uint16_t)(data[2 * i] << 8 | data[2 * i + 1]);
+
+    return 0;
+}
+
+int8_t i2c_slave_write_16bit(const i2c_slave *slave, uint16_t reg_addr, uint16_t reg_data)
+{
+	uint8_t buf[4] = { reg_addr >> 8, reg_addr & 0xFF, reg_data >> 8, reg_data & 0xFF };
+	struct i2c_msg msg = { .addr = slave->addr, .flags = 0, .len = sizeof(buf), .buf = buf };
+	struct i2c_rdwr_ioctl_data xfer = { .msgs = &msg, .nmsgs = 1 };
+
+	if (bus_ioctl(slave->fd, I2C_RDWR, &xfer) < 0) {
+		perror("i2c write 16bit");
+		return 1;
 	}
-    return rslt;
+	return 0;
 }
 
-void sensor_activate(uint8_t slave_activate, uint8_t dev)
+int8_t i2c_probe(const i2c_slave *slave, uint16_t reg_addr, uint8_t wide, uint16_t *value)
 {
-    switch(slave_activate){
-      case(0):
-            i2c_set_address(dev, APDS_ADD);
-            apds_init(dev);
-            break;
-      case(1):
-            i2c_set_address(dev, BME_ADD);
-            bme_init(dev);
-            break;
-	  /*			
-      case(2):
-            i2c_set_address(dev, LIS2_ADD);
-            lis2_init(dev);
-            break;
-      case(3):
-            i2c_set_address(dev, MLX_ADD);
-            break;
-	  */
-    }
+	uint8_t addr[2] = { reg_addr >> 8, reg_addr & 0xFF };
+	uint8_t data[2] = { 0 };
+	struct i2c_msg msgs[2] = {
+		{ .addr = slave->addr, .flags = 0, .len = wide ? 2 : 1, .buf = wide ? addr : addr + 1 },
+		{ .addr = slave->addr, .flags = I2C_M_RD, .len = wide ? 2 : 1, .buf = data },
+	};
+	struct i2c_rdwr_ioctl_data xfer = { .msgs = msgs, .nmsgs = ARRAY_SIZE(msgs) };
+
+	// a NACK on the address fails the ioctl at once, no timeout to wait for
+	if (bus_ioctl(slave->fd, I2C_RDWR, &xfer) < 0)
+		return 1;
+
+	*value = wide ? (uint16_t)(data[0] << 8 | data[1]) : data[0];
+	return 0;
 }
 
-void sensor_measure(uint8_t slave_activate, uint8_t dev, char *str, const size_t len)
+int8_t i2c_read_16bit(uint8_t dev, uint16_t reg_addr, uint16_t *reg_data, uint16_t len)
 {
-    uint32_t infrared = 0;
-    uint32_t green = 0; 
-    uint32_t blue   = 0;
-    uint32_t red = 0;
-    
-    int32_t temp = 0;
-    uint32_t pres   = 0; 
-    uint32_t hum    = 0; 
-    uint32_t gas_res= 0;
-    double object_temperature = 0;
-    float acceleration_x = 0;
-    float acceleration_y = 0;
-    float acceleration_z = 0;
-    switch(slave_activate) {
-        case (0):
-            apds_measure(dev, &infrared, &green, &blue, &red);
-            snprintf(str, len, "%u,%u,%u,%u \n", infrared, green, blue, red);
-			// DEBUG WIP
-#ifdef I2C_DEBUG
-            printf("apds: infrared %u, green %u, blue %u, red %u\n", infrared, green, blue, red);
-#endif
-            break;
-        case(1):
-            bme_measure(&temp, &pres, &hum, &gas_res);
-            snprintf(str, len, "%d,%u,%u,%u \n", temp, pres, hum, gas_res);
-			// DEBUG WIP
-#ifdef I2C_DEBUG
-            printf("bme: temp %d, pres %u, hum %u, gas_res %u\n", temp, pres, hum, gas_res);
-#endif
-            break;
-		/*
-        case(2):
-            lis2_measure(dev, acceleration_x, acceleration_y, acceleration_z);// foo to do
-            //printf("lis2: x %f, y %f, z %f", acceleration_x, acceleration_y, acceleration_z); debug WIP
-            break;
-        case(3):
-            mlx_measure(dev, object_temperature); // foo to do
-            //printf("Temper: %f", object_temperature); debug WIP
-            break;
-		*/
-    }
+	i2c_slave slave = { dev, i2c_current_addr[dev] };
+
+	return i2c_slave_read_16bit(&slave, reg_addr, reg_data, len);
 }
@@ -12,6 +12,17 @@
 #include <time.h>
 #include <stdint.h>
 #include "common.h"
+#include "sensor.h"
+#include "bme.h"
+#include "lis2.h"
+#include "scheduler.h"
+#include "ring.h"
+#include "writer.h"
+#include "bringup.h"
+#include "topology.h"
+#include "gnss.h"
+#include "pi4.h"
+#include "error.h"
 
 void write_csv_data (uint8_t act_slv, char* str, uint8_t num) {
     FILE* f;
@@ -45,42 +56,200 @@ int delay(unsigned long micros)
     return (err);
 }
 
-void write_control(uint8_t dev_id)
+/** a new file every hour [us] */
+#define CSV_FILE_PERIOD_US 3600000000u
+/** write_control() returns after this many files */
+#define CSV_MAX_FILES 8
+/** records queued between sampling and the writer thread */
+#define CSV_RING_DEPTH 64
+/** bus the sensors are brought up on */
+#define CSV_BUS "/dev/i2c-1"
+/** UART of the GNSS module, read whenever it has data */
+#define CSV_GNSS "/dev/serial0"
+/** SCHED_FIFO priority of the acquisition thread, 0 runs it as an ordinary thread */
+#define CSV_RT_PRIORITY 0
+/** core the real-time acquisition thread is pinned to, -1 for any */
+#define CSV_RT_CPU 3
+/** BME68x mode, BME_MODE_PARALLEL runs its heater profile continuously */
+#define CSV_BME_MODE BME_MODE_FORCED
+
+/** period of each registry sensor, on absolute deadlines [us] */
+static const uint32_t csv_period_us[SENSOR_COUNT] = {
+    [SENSOR_APDS] = 100000,  // 10 Hz
+    [SENSOR_BME] = 3000000,  // a forced measurement with its heater every 3 s
+    [SENSOR_LIS2] = 10000,   // FIFO drained every 10 ms, a sample or two of its 100 Hz stream
+    [SENSOR_MLX] = 500000,   // 2 Hz, the refresh rate the EEPROM sets by default
+};
+
+/**
+* @struct csv_control
+* @brief  state shared by the write_control() tasks
+*/
+struct csv_control {
+    struct scheduler sched;
+    struct scheduler_sensor sensors[SENSOR_COUNT];
+    struct bringup bringup;
+    struct ring ring;
+    struct ring bringup_ring;
+    struct writer writer;
+    struct nmea_stream gnss_stream;
+    struct gnss_fix fix;
+    uint32_t fixes;
+    int gnss;
+    uint8_t dev_id;
+    uint8_t file_number;
+};
+
+static int csv_gnss(void* arg, uint64_t deadline_us)
 {
-    int t_old;
-    int t_new;
-    int t_init;
-    time_t timestamp;
-    t_old =0;
-    t_new = time(&timestamp);
-    t_init = t_new;
-    uint8_t quit_write;
-    quit_write = 1;
-    long microseconds = 999000;
-    uint8_t file_number=0;
-    while(quit_write){
-        if ((t_new - t_old) >= 30){
-            t_old=t_new;
-            for (uint8_t act_slv = 0; act_slv<=0; act_slv ++){
-                char buffer[32];
-                sensor_activate(act_slv, dev_id);
-                memset(buffer, 0, sizeof(buffer));
-                sensor_measure(act_slv, dev_id, buffer, sizeof(buffer));
-                write_csv_data(act_slv, buffer,file_number);
-                }
-            t_new = time(&timestamp);
-        }else{
-            delay(microseconds);
-            t_new = time(&timestamp);
+    struct csv_control* control = arg;
+    char message[MESSAGE_SIZE];
+    char fields[NMEA_MAX_FIELDS][NMEA_FIELD_BUFFER];
+    uint8_t number_of_fields;
+    uint8_t checksum;
+    int ret;
+    (void)deadline_us;
+    // everything pending, or the task runs again right away
+    while (nmea_stream_read(&control->gnss, &control->gnss_stream) == EXIT_SUCCESS) {
+        while ((ret = nmea_stream_next(&control->gnss_stream, message, sizeof(message)))
+               != ERROR_NMEA_NOT_FOUND) {
+            if (ret != EXIT_SUCCESS
+                || nmea_parse_fields(message, fields, &number_of_fields, &checksum) != EXIT_SUCCESS
+                || checksum != nmea_checksum(message))
+                continue;
+            if (nmea_parse_fix(fields, number_of_fields, &control->fix) == EXIT_SUCCESS)
+                control->fixes++;
         }
-        if((t_new - t_init)>=3600){
-            file_number+=1;
-            t_new = time(&timestamp);
-            t_init = t_new;
-            t_old = 0;
-        }
-        if(file_number>7){
-            quit_write = 0;
+    }
+    return EXIT_SUCCESS;
+}
+
+static int csv_next_file(void* arg, uint64_t deadline_us)
+{
+    struct csv_control* control = arg;
+    (void)deadline_us;
+    control->file_number += 1;
+    if (control->file_number >= CSV_MAX_FILES)
+        scheduler_stop(&control->sched);
+    else
+        writer_next_file(&control->writer);
+    return EXIT_SUCCESS;
+}
+
+void write_control(uint8_t dev_id)
+{
+    static struct csv_control control;
+    // one producer each: the scheduler thread, and the serialized bring-up sink
+    struct ring* rings[] = { &control.ring, &control.bringup_ring };
+    const struct scheduler_rt rt = {
+        .priority = CSV_RT_PRIORITY,
+        .cpu = CSV_RT_PRIORITY ? CSV_RT_CPU : -1,
+        .lock_memory = CSV_RT_PRIORITY > 0,
+    };
+    struct topology topology;
+    int bus = dev_id;
+    uint8_t found[SENSOR_COUNT];
+    size_t settings;
+    int running = 0;
+    int ret;
+
+    control.dev_id = dev_id;
+    control.file_number = 0;
+    control.gnss = -1;
+
+    if (ring_init(&control.ring, CSV_RING_DEPTH, sizeof(struct writer_entry)) != EXIT_SUCCESS)
+        return;
+    if (ring_init(&control.bringup_ring, CSV_RING_DEPTH, sizeof(struct writer_entry))
+        != EXIT_SUCCESS) {
+        ring_free(&control.ring);
+        return;
+    }
+    if (writer_start(&control.writer, "rss_output%u.csv", rings, ARRAY_SIZE(rings))
+        != EXIT_SUCCESS) {
+        ring_free(&control.bringup_ring);
+        ring_free(&control.ring);
+        return;
+    }
+
+    // addresses and channels of this shield, from the cache after the first start
+    if (topology_discover(&topology, bus, TOPOLOGY_CACHE_FILE) == EXIT_SUCCESS) {
+        topology_apply(&topology);
+        topology_print(&topology, stdout);
+        memset(found, 0, sizeof(found));
+        for (size_t i = 0; i < topology.n_devices; ++i) {
+            if (topology.devices[i].sensor < SENSOR_COUNT)
+                found[topology.devices[i].sensor] = 1;
         }
+    } else {
+        // nothing known, try every sensor at its built-in address
+        memset(found, 1, sizeof(found));
     }
-};
+    // channels without a shared address are enabled together, ideally all of them
+    settings = sensor_plan_mux();
+    printf("csv: %zu mux setting(s)\n", settings);
+
+    if (bme_sensor_set_mode(sensor_get(SENSOR_BME), CSV_BME_MODE) != EXIT_SUCCESS)
+        print_warning(ERROR_UNDEFINED_STATE, "BME68x mode not selected");
+
+    // sensors come up concurrently, their tasks skip them until they are
+    bringup_init(&control.bringup, CSV_BUS, writer_sink, &control.bringup_ring);
+    for (uint8_t act_slv = 0; act_slv < SENSOR_COUNT; act_slv++) {
+        if (found[act_slv])
+            bringup_add(&control.bringup, act_slv);
+    }
+    bringup_start(&control.bringup);
+    // switching settings under a bring-up thread would break it
+    if (settings > 1)
+        bringup_wait(&control.bringup);
+
+    scheduler_init(&control.sched);
+    // added first, so at the full hour the file changes before the samples
+    ret = scheduler_add_periodic(&control.sched, "csv_file", CSV_FILE_PERIOD_US,
+                                 CSV_FILE_PERIOD_US, csv_next_file, &control);
+    // one task per sensor at its own rate, skipped until the sensor is up
+    for (uint8_t act_slv = 0; ret == EXIT_SUCCESS && act_slv < SENSOR_COUNT; act_slv++) {
+        if (!found[act_slv])
+            continue;
+        control.sensors[act_slv] = (struct scheduler_sensor){
+            .sensor = sensor_get(act_slv),
+            .sink = writer_sink,
+            .sink_arg = &control.ring,
+        };
+        ret = scheduler_add_sensor(&control.sched, &control.sensors[act_slv],
+                                   csv_period_us[act_slv], 0);
+    }
+    // the GNSS module sends on its own, its task runs on data
+    if (ret == EXIT_SUCCESS && gnss_init(&control.gnss, CSV_GNSS) == EXIT_SUCCESS)
+        ret = scheduler_add_fd(&control.sched, "gnss", control.gnss, csv_gnss, &control);
+    if (ret == EXIT_SUCCESS) {
+        running = scheduler_start(&control.sched, &rt) == EXIT_SUCCESS;
+        if (!running)
+            print_warning(ERROR_STATE_MACHINE, "acquisition thread not started");
+    }
+
+    // acquisition is already under way for the sensors that are up
+    if (settings <= 1)
+        bringup_wait(&control.bringup);
+    bringup_report(&control.bringup, stdout);
+    if (running)
+        scheduler_join(&control.sched);
+    bringup_close(&control.bringup);
+
+    scheduler_report(&control.sched, stdout);
+    scheduler_histogram(&control.sched, stdout);
+    scheduler_close(&control.sched);
+    if (found[SENSOR_LIS2])
+        lis2_sensor_report(sensor_get(SENSOR_LIS2), stdout);
+    if (control.gnss >= 0)
+        uart_close(&control.gnss);
+    writer_stop(&control.writer);
+    printf("csv: %u GNSS fixes, the last one %s\n", control.fixes,
+           control.fix.valid ? "valid" : "invalid");
+    printf("csv: %u mux switches\n", pi4_switches());
+    printf("csv: %llu records written, %u errors, ring high water %u of %u, %u dropped\n",
+           atomic_load(&control.writer.written), control.writer.errors,
+           atomic_load(&control.ring.high_water), CSV_RING_DEPTH,
+           atomic_load(&control.ring.drops));
+    ring_free(&control.bringup_ring);
+    ring_free(&control.ring);
+}
@@ -140,6 +140,12 @@ int nmea_parse_fields(char* message,
 
         if (char_cnt >= NMEA_FIELD_BUFFER-1) {
             print_error(ERROR_MAX_BUFFER_SIZE_REACHED, "buffer overflow, increase NMEA_FIELD_BUFFER size");
+            free(buffer);
+            return ERROR_MAX_BUFFER_SIZE_REACHED;
+        }
+        if (number_fields >= NMEA_MAX_FIELDS) {
+            print_error(ERROR_MAX_BUFFER_SIZE_REACHED, "too many fields, increase NMEA_MAX_FIELDS");
+            free(buffer);
             return ERROR_MAX_BUFFER_SIZE_REACHED;
         }
 
@@ -159,6 +165,12 @@ int nmea_parse_fields(char* message,
         buffer[char_cnt++] = *walker;
     }
 
+    if (number_fields < 2) {
+        print_error(ERROR_PARSER, "message is not terminated");
+        free(buffer);
+        return ERROR_PARSER;
+    }
+
     number_fields -= 2; // not counting the addition add, nor the checksum
 
     // copy results back to outputs, while separating the checksum
@@ -180,6 +192,7 @@ int nmea_parse_fields(char* message,
     if (*checksum != nmea_checksum(message)) {
         print_warning(ERROR_CHECKSUM_FAILED, "checksum calculation is incorrect, message is corrupted");
         printf("checksum calculation is incorrect, message is corrupted\n");
+        free(buffer);
         return ERROR_CHECKSUM_FAILED;
     }
 #endif /* GNSS_CHECK */
@@ -228,4 +241,152 @@ int nmea_enable_geographical_latitude_longitude(int* dev) {
     return EXIT_SUCCESS;
 }
 
+int nmea_stream_read(int* dev, struct nmea_stream* stream) {
+
+    size_t count;
+    int ret;
+
+    if (stream->length >= sizeof(stream->buffer)) {
+        // no message fits in the whole buffer, it can only be garbage
+        print_warning(ERROR_MAX_BUFFER_SIZE_REACHED, "dropping unterminated data");
+        stream->length = 0;
+    }
+
+    ret = uart_read_pending(dev, stream->buffer + stream->length,
+            sizeof(stream->buffer) - stream->length, &count);
+    if (ret != EXIT_SUCCESS)
+        return ret;
+
+    stream->length += count;
+
+    return EXIT_SUCCESS;
+}
+
+int nmea_stream_next(struct nmea_stream* stream, char* message, size_t size) {
+
+    char* begin;
+    char* end;
+    size_t length;
+
+    begin = memchr(stream->buffer, '$', stream->length);
+    if (!begin) {
+        stream->length = 0;
+        return ERROR_NMEA_NOT_FOUND;
+    }
+
+    // drop whatever is in front of the message
+    stream->length -= begin - stream->buffer;
+    memmove(stream->buffer, begin, stream->length);
+
+    end = memchr(stream->buffer, '\n', stream->length);
+    if (!end)
+        return ERROR_NMEA_NOT_FOUND;
+
+    length = end - stream->buffer + 1;
+    if (length < size) {
+        memcpy(message, stream->buffer, length);
+        message[length] = '\0';
+    }
+
+    stream->length -= length;
+    memmove(stream->buffer, stream->buffer + length, stream->length);
+
+    if (length >= size) {
+        print_warning(ERROR_MAX_BUFFER_SIZE_REACHED, "NMEA message too long, dropped");
+        return ERROR_MAX_BUFFER_SIZE_REACHED;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief convert NMEA ddmm.mmmm (or dddmm.mmmm) into 1e-7 degrees
+ * @param[in] field coordinate field
+ * @param[in] hemisphere direction field ("N", "S", "E" or "W")
+ * @return coordinate, negative on south and west
+ */
+static int32_t nmea_coordinate(const char* field, const char* hemisphere) {
+
+    double value = strtod(field, NULL);
+    double degrees = (int)(value / 100);
+    double minutes = value - degrees * 100;
+    int32_t coordinate = (int32_t)((degrees + minutes / 60.0) * 1e7 + 0.5);
+
+    if (*hemisphere == 'S' || *hemisphere == 'W')
+        coordinate = -coordinate;
+
+    return coordinate;
+}
+
+/**
+ * @brief convert NMEA hhmmss.sss into milliseconds of the day
+ * @param[in] field time field
+ * @return time of day [ms]
+ */
+static uint32_t nmea_time(const char* field) {
+
+    double value = strtod(field, NULL);
+    uint32_t hhmmss = (uint32_t)value;
+    uint32_t ms = (uint32_t)((value - hhmmss) * 1000 + 0.5);
+
+    return ((hhmmss / 10000) * 3600 + (hhmmss / 100 % 100) * 60
+            + hhmmss % 100) * 1000 + ms;
+}
+
+int nmea_parse_fix(char fields[NMEA_MAX_FIELDS][NMEA_FIELD_BUFFER],
+        uint8_t number_of_fields, struct gnss_fix* fix) {
+
+    const char* type;
+
+    // talker ID (2 characters) followed by the message type
+    if (number_of_fields < 1 || strlen(fields[0]) != 5)
+        return ERROR_PARSER;
+    type = fields[0] + 2;
+
+    if (!strcmp(type, "RMC")) {
+        /*
+         * RMC,time,status,lat,N/S,lon,E/W,speed[kn],course,date,...
+         */
+        if (number_of_fields < 10)
+            return ERROR_PARSER;
+
+        fix->valid = fields[2][0] == 'A';
+        if (fields[1][0])
+            fix->time = nmea_time(fields[1]);
+        if (fields[3][0] && fields[5][0]) {
+            fix->latitude = nmea_coordinate(fields[3], fields[4]);
+            fix->longitude = nmea_coordinate(fields[5], fields[6]);
+        }
+        // 1 knot = 514.444 mm/s
+        fix->speed = (uint32_t)(strtod(fields[7], NULL) * 514.444 + 0.5);
+        fix->course = (uint16_t)(strtod(fields[8], NULL) * 100 + 0.5);
+        fix->date = strtoul(fields[9], NULL, 10);
+
+        return EXIT_SUCCESS;
+    }
+
+    if (!strcmp(type, "GGA")) {
+        /*
+         * GGA,time,lat,N/S,lon,E/W,quality,satellites,hdop,altitude,M,...
+         */
+        if (number_of_fields < 10)
+            return ERROR_PARSER;
+
+        if (fields[1][0])
+            fix->time = nmea_time(fields[1]);
+        if (fields[2][0] && fields[4][0]) {
+            fix->latitude = nmea_coordinate(fields[2], fields[3]);
+            fix->longitude = nmea_coordinate(fields[4], fields[5]);
+        }
+        fix->quality = strtoul(fields[6], NULL, 10);
+        fix->satellites = strtoul(fields[7], NULL, 10);
+        fix->hdop = (uint16_t)(strtod(fields[8], NULL) * 100 + 0.5);
+        fix->altitude = (int32_t)(strtod(fields[9], NULL) * 1000);
+
+        return EXIT_SUCCESS;
+    }
+
+    return ERROR_PARSER;
+}
+
 // vim: expandtab ts=4 sw=4
@@ -20,13 +20,23 @@
 #include <unistd.h>
 #include "lis2.h"
 #include "common.h"
+#include "error.h"
+#include "regcache.h"
+#include "timestamp.h"
 
 
-void lis2_init(uint8_t dev)
+int lis2_init(uint8_t dev)
 {   
-  uint8_t reg_addr = LIS2DW12_CTRL6;
+  uint8_t ctrl1 = LIS2DW12_CTRL1_ON_DEMAND;
   uint8_t ctrl6 =  0b00000100;  
-  i2c_write(dev, ctrl6, &reg_addr, 1);
+  i2c_slave slave = { dev, LIS2_ADD };
+  // SLP_MODE_1 clears itself once the conversion is done
+  regcache_set_volatile(&slave, LIS2DW12_CTRL3);
+  if (regcache_write(LIS2DW12_CTRL1, &ctrl1, 1, &dev))
+    return ERROR_WRITE_REGISTER_FAILS;
+  if (regcache_write(LIS2DW12_CTRL6, &ctrl6, 1, &dev))
+    return ERROR_WRITE_REGISTER_FAILS;
+  return EXIT_SUCCESS;
 }
 
 
@@ -35,52 +45,323 @@ uint8_t lis2_status_reg_get(uint8_t dev, uint8_t addr)
 {
     uint8_t val;
     uint8_t buffersize=1;
-    i2c_read_8bit(dev, addr, &val, buffersize);
+    i2c_read_8bit(addr, &val, buffersize, &dev);
     return(val);
 }
 
-void lis2_get_acc_data(uint8_t dev, float ACCX, float ACCY, float ACCZ)
+void lis2_get_acc_data(uint8_t dev, float* ACCX, float* ACCY, float* ACCZ)
 {
-    uint8_t status = 0, high, low;
-    uint16_t X, Y, Z;
-    uint8_t ctrl1 =  0b00101010;    
-    uint8_t ctrl3 =  0b00000011;     
-    uint8_t ctrl6 =  0b00000100;  
-    uint8_t reg_addr = LIS2DW12_CTRL1;
-    float sensitivity = LIS2DW12_FS_2G_GAIN_LP;
-    i2c_write(dev, ctrl1, &reg_addr, 1);
-    reg_addr = LIS2DW12_CTRL3;
-    i2c_write(dev, ctrl3, &reg_addr, 1);
+    uint8_t data[LIS2DW12_SAMPLE_SIZE];
+    struct lis2_sample sample;
+    // CTRL_1 stays as lis2_init left it, SLP_MODE_1 starts the next conversion
+    lis2_trigger(dev);
     
-    i2c_read_8bit(dev, LIS2DW12_OUT_X_L, &low, 1);
-    i2c_read_8bit(dev, LIS2DW12_OUT_X_H, &high, 1);
+    if (lis2_read_raw(dev, data) != EXIT_SUCCESS)
+        return;
 
-    X = ((low | high << 8)>>4);
-   
-    ACCX = X * sensitivity;
-    //printf("OUT_X_L=0x%02X, OUT_X_H=0x%02X, X=0x%04X (%d), ACCX=%5.2f\n",low,high,X,ACCX);
+    lis2_decode(data, &sample);
+    *ACCX = sample.x;
+    *ACCY = sample.y;
+    *ACCZ = sample.z;
+}
+
+void lis2_measure(uint8_t dev, float* X, float* Y, float* Z)
+{
+    uint8_t stat = lis2_status_reg_get(dev, LIS2DW12_STATUS);
+    if (((stat<<7)>>7)== 1)  
+    {
+        lis2_get_acc_data(dev, X, Y, Z);
+    }
+}
+
+int lis2_trigger(uint8_t dev)
+{
+    uint8_t ctrl3 = 0b00000011;
+
+    if (regcache_write(LIS2DW12_CTRL3, &ctrl3, 1, &dev))
+        return ERROR_WRITE_REGISTER_FAILS;
 
-    i2c_read_8bit(dev, LIS2DW12_OUT_Y_L, &low, 1);
-    i2c_read_8bit(dev, LIS2DW12_OUT_Y_H, &high, 1);
+    return EXIT_SUCCESS;
+}
+
+int lis2_ready(uint8_t dev)
+{
+    uint8_t stat;
 
-    Y = ((low | high << 8)>>4);
-    ACCY = Y * sensitivity;
-    //printf("OUT_Y_L=0x%02X, OUT_Y_H=0x%02X, Y=0x%04X (%d), ACCY=%5.2f\n",low,high,Y,ACCY);
+    if (i2c_read_8bit(LIS2DW12_STATUS, &stat, 1, &dev))
+        return ERROR_READ_REGISTER_FAILS;
 
-    i2c_read_8bit(dev, LIS2DW12_OUT_Z_L, &low, 1);
-    i2c_read_8bit(dev, LIS2DW12_OUT_Z_H, &high, 1);
+    return (stat & LIS2DW12_STATUS_DRDY) ? EXIT_SUCCESS : ERROR_DATA_NOT_READY;
+}
 
-    Z = ((low | high << 8)>>4);
-    ACCZ = Z * sensitivity;
-    //printf("OUT_Z_L=0x%02X, OUT_Z_H=0x%02X, Z=0x%04X (%d), ACCZ=%5.2f\n",low,high,Z,ACCZ);
+int lis2_read_raw(uint8_t dev, uint8_t data[LIS2DW12_SAMPLE_SIZE])
+{
+    // OUT_X_L up to OUT_Z_H in one transfer
+    if (i2c_read_8bit(LIS2DW12_OUT_X_L, data, LIS2DW12_SAMPLE_SIZE, &dev))
+        return ERROR_READ_REGISTER_FAILS;
 
+    return EXIT_SUCCESS;
 }
 
-void lis2_measure(uint8_t dev, float X, float Y, float Z)
+void lis2_decode(const uint8_t data[LIS2DW12_SAMPLE_SIZE], struct lis2_sample* sample)
 {
-    uint8_t stat = lis2_status_reg_get(dev, LIS2DW12_STATUS);
-    if (((stat<<7)>>7)== 1)  
+    // 12-bit left aligned in Low-Power Mode 1
+    sample->x = ((int16_t)(data[0] | data[1] << 8) >> 4) * LIS2DW12_FS_2G_GAIN_LP;
+    sample->y = ((int16_t)(data[2] | data[3] << 8) >> 4) * LIS2DW12_FS_2G_GAIN_LP;
+    sample->z = ((int16_t)(data[4] | data[5] << 8) >> 4) * LIS2DW12_FS_2G_GAIN_LP;
+}
+
+int lis2_fifo_start(struct lis2_fifo* fifo, uint8_t dev, enum lis2_odr odr,
+                    uint8_t watermark)
+{
+    uint8_t ctrl1 = (uint8_t)(odr << 4) | 0b00000100; // high-performance mode
+    uint8_t ctrl2 = LIS2DW12_CTRL2_BDU_IF_ADD_INC;
+    uint8_t ctrl6 = 0b00000100;                         // FS ±2g, low noise
+    uint8_t int1 = LIS2DW12_INT1_FTH;
+    uint8_t fifo_ctrl = LIS2DW12_FIFO_MODE_BYPASS;
+
+    if (watermark == 0 || watermark > LIS2DW12_FIFO_FTH_MSK)
+        return ERROR_INVALID_BUFFER_SIZE;
+
+    fifo->dev = dev;
+    fifo->overruns = 0;
+    fifo->samples = 0;
+
+    // passing through bypass empties the FIFO
+    if (regcache_write(LIS2DW12_FIFO_CTRL, &fifo_ctrl, 1, &fifo->dev))
+        return ERROR_WRITE_REGISTER_FAILS;
+    if (regcache_write(LIS2DW12_CTRL2, &ctrl2, 1, &fifo->dev))
+        return ERROR_WRITE_REGISTER_FAILS;
+    if (regcache_write(LIS2DW12_CTRL6, &ctrl6, 1, &fifo->dev))
+        return ERROR_WRITE_REGISTER_FAILS;
+    if (regcache_write(LIS2DW12_CTRL4_INT1, &int1, 1, &fifo->dev))
+        return ERROR_WRITE_REGISTER_FAILS;
+    if (regcache_write(LIS2DW12_CTRL1, &ctrl1, 1, &fifo->dev))
+        return ERROR_WRITE_REGISTER_FAILS;
+
+    fifo_ctrl = LIS2DW12_FIFO_MODE_CONTINUOUS | (watermark & LIS2DW12_FIFO_FTH_MSK);
+    if (regcache_write(LIS2DW12_FIFO_CTRL, &fifo_ctrl, 1, &fifo->dev))
+        return ERROR_WRITE_REGISTER_FAILS;
+
+    return EXIT_SUCCESS;
+}
+
+int lis2_fifo_read(struct lis2_fifo* fifo,
+                   uint8_t data[LIS2DW12_FIFO_DEPTH * LIS2DW12_SAMPLE_SIZE], uint8_t* count)
+{
+    uint8_t status;
+    uint8_t n;
+
+    *count = 0;
+
+    if (i2c_read_8bit(LIS2DW12_FIFO_SAMPLES, &status, 1, &fifo->dev))
+        return ERROR_READ_REGISTER_FAILS;
+
+    if (status & LIS2DW12_FIFO_OVR)
+        ++fifo->overruns;
+
+    n = status & LIS2DW12_FIFO_DIFF_MSK;
+    if (n > LIS2DW12_FIFO_DEPTH)
+        n = LIS2DW12_FIFO_DEPTH;
+    if (n == 0)
+        return ERROR_DATA_NOT_READY;
+
+    // with the FIFO enabled the address wraps from OUT_Z_H back to OUT_X_L,
+    // so a single transfer pops every stored sample
+    if (i2c_read_8bit(LIS2DW12_OUT_X_L, data, n * LIS2DW12_SAMPLE_SIZE, &fifo->dev))
+        return ERROR_READ_REGISTER_FAILS;
+
+    *count = n;
+    fifo->samples += n;
+
+    return EXIT_SUCCESS;
+}
+
+int lis2_fifo_drain(struct lis2_fifo* fifo,
+                    struct lis2_sample samples[LIS2DW12_FIFO_DEPTH], uint8_t* count)
+{
+    uint8_t data[LIS2DW12_FIFO_DEPTH * LIS2DW12_SAMPLE_SIZE];
+    uint8_t i;
+    int ret;
+
+    ret = lis2_fifo_read(fifo, data, count);
+    if (ret != EXIT_SUCCESS)
+        return ret;
+
+    for (i = 0; i < *count; ++i)
     {
-        lis2_get_acc_data(dev, X, Y, Z);
+        uint8_t *raw = &data[i * LIS2DW12_SAMPLE_SIZE];
+        // 14-bit left aligned in high-performance mode; the 12-bit samples
+        // taken in the sleep state are left aligned too, so the scale holds
+        samples[i].x = ((int16_t)(raw[0] | raw[1] << 8) >> 2) * LIS2DW12_FS_2G_GAIN_HP;
+        samples[i].y = ((int16_t)(raw[2] | raw[3] << 8) >> 2) * LIS2DW12_FS_2G_GAIN_HP;
+        samples[i].z = ((int16_t)(raw[4] | raw[5] << 8) >> 2) * LIS2DW12_FS_2G_GAIN_HP;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+int lis2_fifo_stop(struct lis2_fifo* fifo)
+{
+    uint8_t fifo_ctrl = LIS2DW12_FIFO_MODE_BYPASS;
+    uint8_t ctrl1 = LIS2DW12_CTRL1_ON_DEMAND;
+
+    if (regcache_write(LIS2DW12_FIFO_CTRL, &fifo_ctrl, 1, &fifo->dev))
+        return ERROR_WRITE_REGISTER_FAILS;
+    if (regcache_write(LIS2DW12_CTRL1, &ctrl1, 1, &fifo->dev))
+        return ERROR_WRITE_REGISTER_FAILS;
+
+    return EXIT_SUCCESS;
+}
+
+uint32_t lis2_odr_mhz(enum lis2_odr odr)
+{
+    // ODR doubles from 12.5 Hz with each step of the ODR field
+    return (uint32_t)LIS2DW12_SLEEP_RATE_MHZ << (odr - LIS2_ODR_12HZ5);
+}
+
+int lis2_duty_start(struct lis2_duty* duty, uint8_t dev, enum lis2_odr odr,
+                    uint8_t watermark, uint8_t threshold, uint8_t sleep_dur)
+{
+    uint8_t wake_up_dur = sleep_dur & LIS2DW12_SLEEP_DUR_MSK;
+    uint8_t wake_up_ths = LIS2DW12_SLEEP_ON | (threshold & LIS2DW12_WK_THS_MSK);
+    uint8_t ctrl7 = LIS2DW12_INTERRUPTS_ENABLE;
+    int ret;
+
+    if (threshold == 0 || threshold > LIS2DW12_WK_THS_MSK)
+        return ERROR_INVALID_BUFFER_SIZE;
+
+    ret = lis2_fifo_start(&duty->fifo, dev, odr, watermark);
+    if (ret != EXIT_SUCCESS)
+        return ret;
+
+    duty->odr = odr;
+    duty->state = LIS2_ACTIVE;
+    duty->transitions = 0;
+
+    if (regcache_write(LIS2DW12_WAKE_UP_DUR, &wake_up_dur, 1, &duty->fifo.dev))
+        return ERROR_WRITE_REGISTER_FAILS;
+    if (regcache_write(LIS2DW12_CTRL7, &ctrl7, 1, &duty->fifo.dev))
+        return ERROR_WRITE_REGISTER_FAILS;
+    if (regcache_write(LIS2DW12_WAKE_UP_THS, &wake_up_ths, 1, &duty->fifo.dev))
+        return ERROR_WRITE_REGISTER_FAILS;
+
+    return EXIT_SUCCESS;
+}
+
+int lis2_duty_poll(struct lis2_duty* duty, enum lis2_activity* state,
+                   uint32_t* rate_mhz)
+{
+    uint8_t src;
+    enum lis2_activity now;
+
+    if (i2c_read_8bit(LIS2DW12_WAKE_UP_SRC, &src, 1, &duty->fifo.dev))
+        return ERROR_READ_REGISTER_FAILS;
+
+    now = (src & LIS2DW12_SLEEP_STATE_IA) ? LIS2_SLEEPING : LIS2_ACTIVE;
+    *state = now;
+    *rate_mhz = now == LIS2_SLEEPING ? LIS2DW12_SLEEP_RATE_MHZ : lis2_odr_mhz(duty->odr);
+
+    if (now == duty->state)
+        return ERROR_DATA_NOT_READY;
+
+    duty->state = now;
+    ++duty->transitions;
+
+    return EXIT_SUCCESS;
+}
+
+int lis2_duty_stop(struct lis2_duty* duty)
+{
+    i2c_slave slave = { duty->fifo.dev, LIS2_ADD };
+    int ret;
+
+    ret = regcache_update(&slave, LIS2DW12_WAKE_UP_THS, LIS2DW12_SLEEP_ON, 0);
+    if (ret == EXIT_SUCCESS)
+        ret = regcache_update(&slave, LIS2DW12_CTRL7, LIS2DW12_INTERRUPTS_ENABLE, 0);
+    if (ret != EXIT_SUCCESS)
+        return ret;
+
+    return lis2_fifo_stop(&duty->fifo);
+}
+
+/*
+ * registry adapters, FIFO streaming
+ */
+
+static const struct sensor_field lis2_fields[] = {
+    { "x", "mg", -3 },
+    { "y", "mg", -3 },
+    { "z", "mg", -3 },
+    { "rate", "Hz", -3 },
+};
+
+static int lis2_sensor_init(struct sensor* sensor)
+{
+    i2c_set_address(sensor->slave.fd, sensor->slave.addr);
+    return lis2_duty_start(sensor->ctx, sensor->slave.fd, LIS2_SENSOR_ODR,
+                           LIS2_SENSOR_WATERMARK, LIS2_SENSOR_WAKE_THS, LIS2_SENSOR_SLEEP_DUR);
+}
+
+static int lis2_sensor_collect(struct sensor* sensor, struct sensor_raw* raw)
+{
+    struct lis2_duty* duty = sensor->ctx;
+    enum lis2_activity state;
+    uint32_t rate_mhz;
+    uint8_t count;
+    int ret;
+
+    i2c_set_address(sensor->slave.fd, sensor->slave.addr);
+    // a transition is reported once, the rate of the rows carries it on
+    ret = lis2_duty_poll(duty, &state, &rate_mhz);
+    if (ret != EXIT_SUCCESS && ret != ERROR_DATA_NOT_READY)
+        return ret;
+    ret = lis2_fifo_read(&duty->fifo, raw->data, &count);
+    if (ret != EXIT_SUCCESS)
+        return ret;
+
+    // the samples, then the rate they were taken at
+    memcpy(&raw->data[count * LIS2DW12_SAMPLE_SIZE], &rate_mhz, sizeof(rate_mhz));
+    raw->len = count * LIS2DW12_SAMPLE_SIZE + sizeof(rate_mhz);
+    raw->records = count;
+    return EXIT_SUCCESS;
+}
+
+static int lis2_sensor_decode(const struct sensor* sensor, const struct sensor_raw* raw,
+                              int32_t values[SENSOR_MAX_VALUES])
+{
+    const uint8_t* data;
+    uint32_t rate_mhz;
+
+    (void)sensor; // the samples are all in raw
+    memcpy(&rate_mhz, &raw->data[raw->records * LIS2DW12_SAMPLE_SIZE], sizeof(rate_mhz));
+    // 14-bit left aligned, 244 ug per digit: exact in integers
+    for (uint8_t r = 0; r < raw->records; r++) {
+        data = &raw->data[r * LIS2DW12_SAMPLE_SIZE];
+        for (int i = 0; i < 3; i++)
+            values[r * 4 + i] = ((int16_t)(data[2 * i] | data[2 * i + 1] << 8) >> 2)
+                * LIS2DW12_FS_2G_GAIN_HP_UG;
+        values[r * 4 + 3] = rate_mhz;
     }
-}
\ No newline at end of file
+    return EXIT_SUCCESS;
+}
+
+const struct sensor_driver lis2_driver = {
+    .name = "lis2",
+    .fields = lis2_fields,
+    .n_fields = ARRAY_SIZE(lis2_fields),
+    .init = lis2_sensor_init,
+    .trigger = NULL, // streams on its own
+    .ready = NULL,   // an empty FIFO is reported by collect
+    .collect = lis2_sensor_collect,
+    .decode = lis2_sensor_decode,
+};
+
+void lis2_sensor_report(const struct sensor* sensor, FILE* out)
+{
+    const struct lis2_duty* duty = sensor->ctx;
+
+    fprintf(out, "%s: %u samples drained, %u FIFO overruns, %u activity transitions, %s\n",
+            sensor->driver->name, duty->fifo.samples, duty->fifo.overruns, duty->transitions,
+            duty->state == LIS2_SLEEPING ? "sleeping" : "active");
+}
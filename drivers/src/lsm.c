@@ -46,13 +46,21 @@ int lsm_init(int* bus, char* block_device) {
 
 #ifdef LSM_CHECK_INIT
 
-    return lsm_read_test(bus);
+    if (ret == EXIT_SUCCESS)
+        ret = lsm_read_test(*bus);
 
 #endif /* LSM_CHECK_INIT */
 
     return ret;
 }
 
+/**
+ * @brief Read from sensor
+ * @note message is read @ reg->data
+ * @param[in] bus bus file descriptor
+ * @param[inout] reg register to read
+ * @return error code
+ */
 static inline int lsm_read(int* bus, dev_reg* reg) {
 
     /*
@@ -66,6 +74,14 @@ static inline int lsm_read(int* bus, dev_reg* reg) {
     return spi_read(bus, reg);
 }
 
+/**
+ * @brief Write to sensor
+ * @note message writes as reg->data;
+ * you only have REGISTER_DATA_SIZE-1 available
+ * @param[in] bus bus file descriptor
+ * @param[in] reg register to write
+ * @return error code
+ */
 static inline int lsm_write(int* bus, dev_reg* reg) {
 
     /*
@@ -94,7 +110,7 @@ int lsm_activate_acc_gyro(int bus) {
      * LPF1_BW_SEL = 0
      * 1.5kHz bandwidth selection
      */
-    lsm_write(bus, &reg);
+    lsm_write(&bus, &reg);
 
     //gyroscope
     reg.addr = CTRL2_G;
@@ -104,7 +120,7 @@ int lsm_activate_acc_gyro(int bus) {
      * Gyroscope full-scale at 125 dps
      * 0
      */
-    lsm_write(bus, &reg);
+    lsm_write(&bus, &reg);
 
     return EXIT_SUCCESS;
 }
@@ -116,7 +132,7 @@ int lsm_read_test(int bus) {
         .data = {0},
         .size = 1
     };
-    lsm_read(bus, &reg);
+    lsm_read(&bus, &reg);
 
     // this buffer always return 0x6A
     if (reg.data[0] == 0x6A)
@@ -21,18 +21,73 @@
 #include <sys/stat.h>
 #include "main.h"
 #include "common.h"
+#include "bus.h"
+#ifdef SIM_SHIELD
+#include "sim.h"
+#endif
+#if defined(CAPTURE_FILE) || defined(REPLAY_FILE)
+#include "capture.h"
+#endif
+#ifdef SYNTH_LOAD
+#include "synth.h"
+#include "sample.h"
+#endif
 #include "csv_manipulation.h"
 
 
 int main(int argc, char* argv[])
 {
+#ifdef SYNTH_LOAD
+    // -DSYNTH_LOAD: ramp synthetic sensors through scheduler, ring and writer
+    // until they saturate, no bus is touched;
+    // usage: main [generators [rate_hz [channels [records]]]]
+    struct synth_config synth = SYNTH_CONFIG_DEFAULT;
+    int generators = argc > 1 ? atoi(argv[1]) : synth.generators;
+    int rate_hz = argc > 2 ? atoi(argv[2]) : (int)synth.rate_hz;
+    int channels = argc > 3 ? atoi(argv[3]) : synth.channels;
+    int records = argc > 4 ? atoi(argv[4]) : synth.records;
+
+    // checked before narrowing, 257 generators must not become 1
+    if (generators < 1 || generators > SYNTH_MAX_GENERATORS || rate_hz < 1
+        || channels < 1 || channels > SAMPLE_MAX_CHANNELS
+        || records < 1 || records > SAMPLE_MAX_RECORDS) {
+        print_error(ERROR_UNDEFINED_STATE, "synthetic load argument out of range");
+        printf("generators 1 to %u, rate_hz from 1 [Hz], channels 1 to %u, records 1 to %u\n",
+               SYNTH_MAX_GENERATORS, SAMPLE_MAX_CHANNELS, SAMPLE_MAX_RECORDS);
+        return EXIT_FAILURE;
+    }
+    synth.generators = generators;
+    synth.rate_hz = rate_hz;
+    synth.channels = channels;
+    synth.records = records;
+    return synth_ramp(&synth, NULL, stdout) == EXIT_SUCCESS ? EXIT_SUCCESS : EXIT_FAILURE;
+#endif
+#ifdef SIM_SHIELD
+    // -DSIM_SHIELD: run on the simulated shield instead of the hardware
+    sim_init(NULL);
+    if (sim_shield())
+        return EXIT_FAILURE;
+    bus_set_backend(&sim_backend);
+#endif
+#if defined(REPLAY_FILE)
+    // -DREPLAY_FILE=\"x.cap\": answer from a capture, as fast as asked
+    if (replay_open(REPLAY_FILE, REPLAY_FAST))
+        return EXIT_FAILURE;
+    bus_set_backend(&replay_backend);
+#elif defined(CAPTURE_FILE)
+    // -DCAPTURE_FILE=\"x.cap\": record what goes over the buses
+    if (capture_start(CAPTURE_FILE))
+        return EXIT_FAILURE;
+#endif
     if (I2C_DRV){
         uint8_t dev_id;
-        dev_id = open("/dev/i2c-1", O_RDWR);
+        dev_id = bus_open("/dev/i2c-1", O_RDWR);
         //write_control(dev_id); origin
-        
-        for (uint8_t act_slv = 0; act_slv<=1; act_slv ++){ // foo to do - !!!remove this loop, its only for debugging!!!
-            char buffer[32];
+
+        // the sensors sit behind the PI4 channels, select them like write_control() does
+        sensor_plan_mux();
+        for (uint8_t act_slv = 0; act_slv<SENSOR_COUNT; act_slv ++){ // foo to do - !!!remove this loop, its only for debugging!!!
+            char buffer[SENSOR_STRING_SIZE];
             sensor_activate(act_slv, dev_id);
             memset(buffer, 0, sizeof(buffer));
             sensor_measure(act_slv, dev_id, buffer, sizeof(buffer));
@@ -41,5 +96,10 @@ int main(int argc, char* argv[])
 
         i2c_close(dev_id);
     }
+#if defined(REPLAY_FILE)
+    replay_close();
+#elif defined(CAPTURE_FILE)
+    capture_stop();
+#endif
     return 0;
 }
@@ -15,119 +15,352 @@
 #include <linux/i2c-dev.h>
 #include <fcntl.h>
 #include <string.h>
+#include <stddef.h>
+#include <errno.h>
 #include <sys/ioctl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <math.h>
+#include <pthread.h>
 #include "mlx.h"
 #include "common.h"
+#include "error.h"
+#include "timestamp.h"
+
+/**
+* @struct mlx_cache
+* @brief  calibration cache file contents
+*/
+struct mlx_cache
+{
+  uint32_t magic;
+  uint16_t id[MLX_ID_WORDS];
+  struct mlx_calib calib;
+  uint32_t checksum;
+};
+
+
+/** 32-bit constant stored as two words, LSW at the lower address */
+#define MLX_EE_32(words, addr) \
+    ((int32_t)((uint32_t)(words)[(addr) - MLX_EE_P_R] | \
+               (uint32_t)(words)[(addr) - MLX_EE_P_R + 1] << 16))
+#define MLX_EE_16(words, addr) ((int16_t)(words)[(addr) - MLX_EE_P_R])
+
+int mlx_read_calib(const i2c_slave *slave, struct mlx_calib *calib)
+{
+    uint16_t ee[MLX_EE_CALIB_WORDS];
+    uint16_t h[MLX_EE_H_WORDS];
+
+    if (i2c_slave_read_16bit(slave, MLX_EE_P_R, ee, MLX_EE_CALIB_WORDS)
+        || i2c_slave_read_16bit(slave, MLX_EE_Ha, h, MLX_EE_H_WORDS))
+        return ERROR_READ_REGISTER_FAILS;
+
+    calib->P_R = MLX_EE_32(ee, MLX_EE_P_R);
+    calib->P_G = MLX_EE_32(ee, MLX_EE_P_G);
+    calib->P_T = MLX_EE_32(ee, MLX_EE_P_T);
+    calib->P_O = MLX_EE_32(ee, MLX_EE_P_O);
+    calib->Ea = MLX_EE_32(ee, MLX_EE_Ea);
+    calib->Eb = MLX_EE_32(ee, MLX_EE_Eb);
+    calib->Fa = MLX_EE_32(ee, MLX_EE_Fa);
+    calib->Fb = MLX_EE_32(ee, MLX_EE_Fb);
+    calib->Ga = MLX_EE_32(ee, MLX_EE_Ga);
+    calib->Gb = MLX_EE_16(ee, MLX_EE_Gb);
+    calib->Ka = MLX_EE_16(ee, MLX_EE_Ka);
+    calib->Ha = (int16_t)h[0];
+    calib->Hb = (int16_t)h[1];
+
+    return EXIT_SUCCESS;
+}
+
+static uint32_t mlx_cache_checksum(const struct mlx_cache *cache)
+{
+    const uint8_t *byte = (const uint8_t *)cache;
+    uint32_t sum = 0;
 
+    // rotate-add, catches truncated and shuffled files
+    for (size_t i = 0; i < offsetof(struct mlx_cache, checksum); i++)
+        sum = (sum << 1 | sum >> 31) + byte[i];
+    return sum;
+}
+
+static void mlx_cache_path(const uint16_t id[MLX_ID_WORDS], char *path, size_t size)
+{
+    snprintf(path, size, MLX_CACHE_DIR "/mlx90632_%04x%04x%04x.cal", id[0], id[1], id[2]);
+}
+
+/**
+* @brief  load the calibration of a chip ID from its cache file
+* @return error code
+*/
+static int mlx_cache_load(const uint16_t id[MLX_ID_WORDS], struct mlx_calib *calib)
+{
+    struct mlx_cache cache;
+    char path[64];
+    FILE *f;
+    size_t n;
+
+    mlx_cache_path(id, path, sizeof(path));
+    if ((f = fopen(path, "rb")) == NULL)
+        return ERROR_NOTHING_TO_READ;
+    n = fread(&cache, sizeof(cache), 1, f);
+    fclose(f);
+
+    if (n != 1 || cache.magic != MLX_CACHE_MAGIC
+        || memcmp(cache.id, id, sizeof(cache.id))
+        || cache.checksum != mlx_cache_checksum(&cache))
+        return ERROR_CHECKSUM_FAILED;
+
+    *calib = cache.calib;
+    return EXIT_SUCCESS;
+}
 
-uint mlx_read_eeprom(uint8_t dev, uint32_t Ea, uint32_t Eb, uint32_t Fa, uint32_t Fb, uint32_t Ga, 
-        uint16_t Gb, uint16_t Ha, uint16_t Hb, uint16_t Ka)
+/**
+* @brief  write the cache file of a chip ID, replaced in one step
+* @return error code
+*/
+static int mlx_cache_store(const uint16_t id[MLX_ID_WORDS], const struct mlx_calib *calib)
 {
-    uint16_t reg_lsb;
-    uint16_t reg_msb;
+    struct mlx_cache cache;
+    char path[64];
+    char tmp[70];
+    FILE *f;
+
+    memset(&cache, 0, sizeof(cache));
+    cache.magic = MLX_CACHE_MAGIC;
+    memcpy(cache.id, id, sizeof(cache.id));
+    cache.calib = *calib;
+    cache.checksum = mlx_cache_checksum(&cache);
+
+    mlx_cache_path(id, path, sizeof(path));
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    if ((f = fopen(tmp, "wb")) == NULL)
+        return errno;
+    if (fwrite(&cache, sizeof(cache), 1, f) != 1)
+    {
+        fclose(f);
+        remove(tmp);
+        return EIO;
+    }
+    if (fclose(f) || rename(tmp, path))
+        return errno;
 
-    i2c_read_16bit(dev, MLX_EE_Ea,  &reg_lsb, 1);
-    i2c_read_16bit(dev, MLX_EE_Ea,  &reg_msb, 1);
-    Ea = (reg_msb<<16) + reg_lsb;
+    return EXIT_SUCCESS;
+}
 
-    i2c_read_16bit(dev, MLX_EE_Eb,  &reg_lsb, 1);
-    i2c_read_16bit(dev, MLX_EE_Eb,  &reg_msb, 1);
-    Eb = (reg_msb<<16) + reg_lsb;
+/**
+* @brief  re-read the EEPROM behind a calibration loaded from the cache
+* @param[inout] arg struct mlx *
+*/
+static void *mlx_validate(void *arg)
+{
+    struct mlx *mlx = arg;
+    struct mlx_calib calib;
 
-    i2c_read_16bit(dev, MLX_EE_Fa,  &reg_lsb, 1);
-    i2c_read_16bit(dev, MLX_EE_Fa,  &reg_msb, 1);
-    Fa = (reg_msb<<16) + reg_lsb;
+    if (mlx_read_calib(&mlx->slave, &calib) != EXIT_SUCCESS)
+        return NULL;
 
-    i2c_read_16bit(dev, MLX_EE_Fb,  &reg_lsb, 1);
-    i2c_read_16bit(dev, MLX_EE_Fb,  &reg_msb, 1);
-    Fb = (reg_msb<<16) + reg_lsb;
+    pthread_mutex_lock(&mlx->lock);
+    if (memcmp(&calib, &mlx->calib, sizeof(calib)) == 0)
+    {
+        pthread_mutex_unlock(&mlx->lock);
+        return NULL;
+    }
+    mlx->calib = calib;
+    mlx_calc_terms(&calib, &mlx->terms);
+    pthread_mutex_unlock(&mlx->lock);
 
-    i2c_read_16bit(dev, MLX_EE_Ga,  &reg_lsb, 1);
-    i2c_read_16bit(dev, MLX_EE_Ga,  &reg_msb, 1);
-    Ga = (reg_msb<<16) + reg_lsb;
+    print_warning(ERROR_CHECKSUM_FAILED, "stale MLX90632 calibration cache replaced");
+    mlx_cache_store(mlx->id, &calib);
 
-    i2c_read_16bit(dev, MLX_EE_Gb,  &Gb, 1);
+    return NULL;
+}
 
-    i2c_read_16bit(dev, MLX_EE_Ha,  &Ha, 1);
+/**
+* @brief  read the refresh rate and start continuous mode
+* @param[inout] mlx sensor state
+* @return error code
+*/
+static int mlx_start(struct mlx *mlx)
+{
+    uint16_t meas_1;
 
-    i2c_read_16bit(dev, MLX_EE_Hb,  &Hb, 1);
+    if (i2c_slave_read_16bit(&mlx->slave, MLX_EE_MEAS_1, &meas_1, 1))
+        return ERROR_READ_REGISTER_FAILS;
+    mlx->period_us = MLX_MEAS_MAX_TIME >> ((meas_1 & MLX_EE_REFRESH) >> 8);
 
-    i2c_read_16bit(dev, MLX_EE_Ka,  &Ka, 1);
-    return 0;
+    return mlx_set_mode(mlx, MLX_MODE_CONTINUOUS);
 }
 
-uint32_t mlx_read_ambient_raw(uint8_t dev, uint16_t *ambient_new_raw, uint16_t *ambient_old_raw)
+int mlx_init(struct mlx *mlx, uint8_t dev, uint8_t addr)
 {
-    i2c_read_16bit(dev, MLX_RAM_3(1), ambient_new_raw, 2);
+    int ret;
+
+    // the validator of a previous init still uses the state
+    if (mlx->open)
+        mlx_close(mlx);
+
+    memset(mlx, 0, sizeof(*mlx));
+    mlx->slave.fd = dev;
+    mlx->slave.addr = addr;
+    pthread_mutex_init(&mlx->lock, NULL);
+    mlx->open = 1;
+
+    if (i2c_slave_read_16bit(&mlx->slave, MLX_EE_ID0, mlx->id, MLX_ID_WORDS))
+        return ERROR_READ_REGISTER_FAILS;
+
+    if (mlx_cache_load(mlx->id, &mlx->calib) == EXIT_SUCCESS)
+    {
+        mlx_calc_terms(&mlx->calib, &mlx->terms);
+        // use the cache right away, the EEPROM only confirms it
+        if (pthread_create(&mlx->validator, NULL, mlx_validate, mlx) == 0)
+            mlx->validating = 1;
+        return mlx_start(mlx);
+    }
+
+    ret = mlx_read_calib(&mlx->slave, &mlx->calib);
+    if (ret != EXIT_SUCCESS)
+        return ret;
+    mlx_calc_terms(&mlx->calib, &mlx->terms);
 
-    i2c_read_16bit(dev, MLX_RAM_3(2), ambient_old_raw, 2);
+    ret = mlx_cache_store(mlx->id, &mlx->calib);
+    if (ret != EXIT_SUCCESS)
+        print_warning(ret, "cannot write MLX90632 calibration cache");
 
-    return 0;
+    return mlx_start(mlx);
 }
 
-uint32_t mlx_read_object_raw(uint8_t dev, uint16_t *object_new_raw, uint16_t *object_old_raw)
+void mlx_close(struct mlx *mlx)
 {
-    uint16_t read_tmp;
-    uint16_t read;
+    if (mlx->validating)
+    {
+        pthread_join(mlx->validator, NULL);
+        mlx->validating = 0;
+    }
+    if (mlx->open)
+        pthread_mutex_destroy(&mlx->lock);
+    mlx->open = 0;
+}
 
-    i2c_read_16bit(dev, MLX_RAM_2(1),&read_tmp, 2);
+int mlx_set_mode(struct mlx *mlx, enum mlx_mode mode)
+{
+    uint16_t ctrl;
 
-    read = (uint16_t)read_tmp;
+    if (i2c_slave_read_16bit(&mlx->slave, MLX_REG_CTRL, &ctrl, 1))
+        return ERROR_READ_REGISTER_FAILS;
 
-    i2c_read_16bit(dev, MLX_RAM_1(1), &read_tmp, 2);
+    ctrl = (ctrl & ~MLX_CTRL_MODE) | mode;
+    if (i2c_slave_write_16bit(&mlx->slave, MLX_REG_CTRL, ctrl))
+        return ERROR_WRITE_REGISTER_FAILS;
 
-    *object_new_raw = (read + (uint16_t)read_tmp)/2;
+    mlx->mode = mode;
+    mlx->fresh = 0;
+    mlx->busy = 0;
+    mlx->next_us = 0;
 
-    i2c_read_16bit(dev, MLX_RAM_2(2),&read_tmp, 2);
+    return EXIT_SUCCESS;
+}
 
-    read = (uint16_t)read_tmp;
+/**
+* @brief  start a pass of the measurement table in sleeping step mode
+*/
+static int mlx_trigger_burst(struct mlx *mlx, uint64_t now)
+{
+    uint16_t ctrl;
 
-    i2c_read_16bit(dev, MLX_RAM_1(2), &read_tmp, 2);
+    if (i2c_slave_read_16bit(&mlx->slave, MLX_REG_CTRL, &ctrl, 1)
+        || i2c_slave_write_16bit(&mlx->slave, MLX_REG_CTRL, ctrl | MLX_CTRL_SOB))
+        return ERROR_WRITE_REGISTER_FAILS;
 
-    *object_old_raw = (read + (uint16_t)read_tmp)/2;
+    mlx->busy = 1;
+    mlx->next_us = now + 2 * mlx->period_us;
 
-    return 0;
+    return EXIT_SUCCESS;
 }
 
-void mlx_start_measurement(uint8_t dev, uint8_t meas_rtn)
+int mlx_start_measurement(struct mlx *mlx, uint8_t *cycle_pos)
 {
+    uint64_t now = timestamp_us();
     uint16_t reg_status;
-    i2c_read_16bit(dev, MLX_REG_STATUS, &reg_status,2);
+    uint8_t pos;
 
-    uint tries = MLX_MAX_NUMBER_MESUREMENT_READ_TRIES; 
+    if (mlx->mode == MLX_MODE_SLEEPING_STEP && !mlx->busy)
+    {
+        if (mlx_trigger_burst(mlx, now) != EXIT_SUCCESS)
+            return ERROR_WRITE_REGISTER_FAILS;
+        return ERROR_DATA_NOT_READY;
+    }
 
-    while(tries -- >0)
+    // the sensor cannot have anything new before its refresh period is over
+    if (now < mlx->next_us)
+        return ERROR_DATA_NOT_READY;
+
+    if (i2c_slave_read_16bit(&mlx->slave, MLX_REG_STATUS, &reg_status, 1))
+        return ERROR_READ_REGISTER_FAILS;
+
+    if (!(reg_status & MLX_STAT_DATA_RDY)
+        || (mlx->mode == MLX_MODE_SLEEPING_STEP && (reg_status & MLX_STAT_BUSY)))
     {
-        if ((reg_status<<15)>>15 == 1 )
-        {
-            break;
-        }
-        delay_ms(50);
+        // late, look again soon rather than a full period later
+        mlx->next_us = now + mlx->period_us / 16;
+        return ERROR_DATA_NOT_READY;
     }
-    
-    meas_rtn = (reg_status<<9)>>11;
-}
 
+    pos = (reg_status & MLX_STAT_CYCLE_POS) >> 2;
+
+    if (mlx->mode == MLX_MODE_SLEEPING_STEP)
+    {
+        // RAM_4 up to RAM_9, both measurements of the pass in one read
+        if (i2c_slave_read_16bit(&mlx->slave, MLX_RAM_1(1), mlx->bank[0], 2 * MLX_BANK_WORDS))
+            return ERROR_READ_REGISTER_FAILS;
+        mlx->fresh = 0x3;
+        mlx->busy = 0;
+        pos = 2;
+    }
+    else
+    {
+        if (pos != 1 && pos != 2)
+            return ERROR_UNDEFINED_STATE;
+        if (i2c_slave_read_16bit(&mlx->slave, MLX_RAM_1(pos), mlx->bank[pos - 1], MLX_BANK_WORDS))
+            return ERROR_READ_REGISTER_FAILS;
+        mlx->fresh |= 1 << (pos - 1);
+        mlx->next_us = now + mlx->period_us;
+    }
 
-uint32_t mlx_read_temp_raw(uint8_t dev, uint16_t *ambient_new_raw, uint16_t *ambient_old_raw,
-        uint16_t *object_new_raw, uint16_t *object_old_raw)
+    if (i2c_slave_write_16bit(&mlx->slave, MLX_REG_STATUS, reg_status & ~MLX_STAT_DATA_RDY))
+        return ERROR_WRITE_REGISTER_FAILS;
+
+    *cycle_pos = pos;
+    return EXIT_SUCCESS;
+}
+
+int mlx_read_temp_raw(struct mlx *mlx, struct mlx_raw *raw)
 {
-    uint8_t measurement_retn = 0;
+    const uint16_t *new_bank, *old_bank;
+    uint8_t cycle_pos;
+    int ret;
+
+    ret = mlx_start_measurement(mlx, &cycle_pos);
+    if (ret != EXIT_SUCCESS)
+        return ret;
 
-    mlx_start_measurement(dev, measurement_retn);
+    // the first measurement after start has nothing to pair with yet
+    if (mlx->fresh != 0x3)
+        return ERROR_DATA_NOT_READY;
 
-    mlx_read_ambient_raw(dev, ambient_new_raw, ambient_old_raw);
+    new_bank = mlx->bank[cycle_pos - 1];
+    old_bank = mlx->bank[2 - cycle_pos];
 
-    mlx_read_object_raw(dev, object_new_raw, object_old_raw);
+    // signed words, averaged signed like the vendor reference
+    raw->ambient_new = (int16_t)mlx->bank[0][2];
+    raw->ambient_old = (int16_t)mlx->bank[1][2];
+    raw->object_new = ((int16_t)new_bank[0] + (int16_t)new_bank[1]) / 2;
+    raw->object_old = ((int16_t)old_bank[0] + (int16_t)old_bank[1]) / 2;
 
-    return 0;
+    return EXIT_SUCCESS;
 }
 
-double mlx_preprocess_temp_ambient(uint16_t ambient_new_raw, uint16_t ambient_old_raw, uint16_t Gb)
+double mlx_preprocess_temp_ambient(uint16_t ambient_new_raw, uint16_t ambient_old_raw, int16_t Gb)
 {
     double VR_Ta, kGb;
 
@@ -139,7 +372,7 @@ double mlx_preprocess_temp_ambient(uint16_t ambient_new_raw, uint16_t ambient_ol
 }
 
 double mlx_preprocess_temp_object(uint16_t object_new_raw, uint16_t object_old_raw,
-        uint16_t ambient_new_raw, uint16_t ambient_old_raw, uint32_t Ka)
+        uint16_t ambient_new_raw, uint16_t ambient_old_raw, int16_t Ka)
 {
     double VR_IR, kKa;
 
@@ -150,8 +383,8 @@ double mlx_preprocess_temp_object(uint16_t object_new_raw, uint16_t object_old_r
 
 }
 
-double  mlx_calc_temp_object_iteration(double prev_object_temp, uint32_t object, double TAdut,
-        uint32_t Ga, uint32_t Fa, uint32_t Fb, uint16_t Ha, uint16_t Hb)
+double  mlx_calc_temp_object_iteration(double prev_object_temp, int32_t object, double TAdut,
+        int32_t Ga, int32_t Fa, int32_t Fb, int16_t Ha, int16_t Hb)
 {
     double calcedGa, calcedGb, calcedFa, TAdut4, first_sqrt;
     // temp variables
@@ -174,8 +407,8 @@ double  mlx_calc_temp_object_iteration(double prev_object_temp, uint32_t object,
     return sqrt(first_sqrt) - 273.15f - Hb_customer;
 }
 
-double mlx_calc_temp_object(uint32_t object, uint32_t ambient, uint32_t Ea, uint32_t Eb, 
-        uint32_t Ga, uint32_t Fa, uint32_t Fb, uint16_t Ha, uint16_t Hb)
+double mlx_calc_temp_object(int32_t object, int32_t ambient, int32_t Ea, int32_t Eb, 
+        int32_t Ga, int32_t Fa, int32_t Fb, int16_t Ha, int16_t Hb)
 {
     double kEa, kEb, TAdut;
     double temp = 25.0f;
@@ -193,25 +426,219 @@ double mlx_calc_temp_object(uint32_t object, uint32_t ambient, uint32_t Ea, uint
     return temp;
 }
 
-void mlx_measure(uint8_t dev, double object)
-{
-    double precalculation_ambient, precalculation_object;
-    uint32_t Ea = 0; 
-    uint32_t Eb = 0;
-    uint32_t Fa = 0; 
-    uint32_t Fb = 0; 
-    uint32_t Ga = 0; 
-    uint16_t Gb = 0; 
-    uint16_t Ha = 0; 
-    uint16_t Hb = 0; 
-    uint16_t Ka = 0;
-    uint16_t ambient_new_raw;
-	uint16_t ambient_old_raw;
-	uint16_t object_new_raw;
-	uint16_t object_old_raw;
-    mlx_read_eeprom (dev, Ea, Eb, Fa, Fb, Ga, Gb, Ha, Hb, Ka);
-    mlx_read_temp_raw(dev, &ambient_new_raw, &ambient_old_raw, &object_new_raw, &object_old_raw);
-    precalculation_ambient = mlx_preprocess_temp_ambient(ambient_new_raw, ambient_old_raw, Gb);
-    precalculation_object = mlx_preprocess_temp_object(object_new_raw, object_old_raw, ambient_new_raw, ambient_old_raw, Ka);
-    object = mlx_calc_temp_object(precalculation_object, precalculation_ambient, Ea, Eb, Ga, Fa, Fb, Ha, Hb);
-}
\ No newline at end of file
+/** 2^36, scale of Ga and Fb */
+#define MLX_2_36 68719476736.0
+/** 2^46 * 2^14, scale of Fa and Ha together */
+#define MLX_2_60 1152921504606846976.0
+
+void mlx_calc_terms(const struct mlx_calib *calib, struct mlx_terms *terms)
+{
+    terms->kEa = calib->Ea / 65536.0;
+    terms->kEb = calib->Eb / 256.0;
+    terms->kGb = calib->Gb / 1024.0;
+    terms->kKa = calib->Ka / 1024.0;
+    terms->fa_ha = (double)calib->Fa * calib->Ha / MLX_2_60;
+    terms->ga = calib->Ga / MLX_2_36;
+    terms->fb = calib->Fb / MLX_2_36;
+    terms->hb = calib->Hb / 1024.0;
+}
+
+/**
+* @brief  preprocessing shared by mlx_compensate and mlx_compensate_batch
+* @param[in] terms compensation terms
+* @param[in] raw raw values
+* @param[out] object preprocessed object value
+* @param[out] ta4 (TAdut + 273.15)^4
+* @param[out] fb_term Fb correction, 1 + Fb * (TAdut - 25)
+*/
+static inline void mlx_prepare(const struct mlx_terms *terms, const struct mlx_raw *raw,
+    float *object, float *ta4, float *fb_term)
+{
+    double ambient_new = raw->ambient_new / (double)MLX_REF_3;
+    float ambient, TAdut, ta2;
+
+    // double here, then truncated like the integer arguments of
+    // mlx_calc_temp_object; single precision would move the cut by one LSB
+    ambient = (int32_t)(ambient_new / (raw->ambient_old + terms->kGb * ambient_new) * 524288.0);
+    *object = (int32_t)(((raw->object_new + raw->object_old) / 2) / (double)MLX_REF_12
+        / (raw->ambient_old + terms->kKa * ambient_new) * 524288.0);
+
+    TAdut = (ambient - terms->kEb) / terms->kEa + 25.0f;
+    ta2 = (TAdut + 273.15f) * (TAdut + 273.15f);
+    *ta4 = ta2 * ta2;
+    *fb_term = 1.0f + terms->fb * (TAdut - 25.0f);
+}
+
+/**
+* @brief  one iteration of the object temperature
+*/
+static inline float mlx_iterate(const struct mlx_terms *terms, float temp, float object,
+    float ta4, float fb_term)
+{
+    float alpha = terms->fa_ha * (fb_term + terms->ga * (temp - 25.0f));
+
+    return sqrtf(sqrtf(object / (EMISSIVITY * alpha) + ta4)) - 273.15f - terms->hb;
+}
+
+float mlx_compensate(const struct mlx_terms *terms, const struct mlx_raw *raw)
+{
+    float object, ta4, fb_term, prev;
+    float temp = 25.0f;
+
+    mlx_prepare(terms, raw, &object, &ta4, &fb_term);
+
+    for (int i = 0; i < MLX_ITERATIONS; ++i)
+    {
+        prev = temp;
+        temp = mlx_iterate(terms, temp, object, ta4, fb_term);
+        if (fabsf(temp - prev) < MLX_CONVERGENCE)
+            break;
+    }
+    return temp;
+}
+
+void mlx_compensate_batch(const struct mlx_terms *terms, const struct mlx_raw raw[],
+    float object[], size_t n)
+{
+    float obj[MLX_BATCH_LANES], ta4[MLX_BATCH_LANES], fb_term[MLX_BATCH_LANES];
+    float temp[MLX_BATCH_LANES], delta[MLX_BATCH_LANES];
+    float next, worst;
+    size_t base, lanes, l;
+
+    for (base = 0; base < n; base += MLX_BATCH_LANES)
+    {
+        lanes = n - base < MLX_BATCH_LANES ? n - base : MLX_BATCH_LANES;
+
+        // struct of arrays, padded lanes repeat the last sample
+        for (l = 0; l < MLX_BATCH_LANES; ++l)
+        {
+            mlx_prepare(terms, &raw[base + (l < lanes ? l : lanes - 1)],
+                        &obj[l], &ta4[l], &fb_term[l]);
+            temp[l] = 25.0f;
+        }
+
+        for (int i = 0; i < MLX_ITERATIONS; ++i)
+        {
+            for (l = 0; l < MLX_BATCH_LANES; ++l)
+            {
+                next = mlx_iterate(terms, temp[l], obj[l], ta4[l], fb_term[l]);
+                delta[l] = fabsf(next - temp[l]);
+                temp[l] = next;
+            }
+            worst = 0.0f;
+            for (l = 0; l < MLX_BATCH_LANES; ++l)
+                worst = delta[l] > worst ? delta[l] : worst;
+            if (worst < MLX_CONVERGENCE)
+                break;
+        }
+
+        memcpy(&object[base], temp, lanes * sizeof(temp[0]));
+    }
+}
+
+int mlx_poll(struct mlx *mlx, double *object)
+{
+    struct mlx_terms terms;
+    struct mlx_raw raw;
+    int ret;
+
+    ret = mlx_read_temp_raw(mlx, &raw);
+    if (ret != EXIT_SUCCESS)
+        return ret;
+
+    pthread_mutex_lock(&mlx->lock);
+    terms = mlx->terms;
+    pthread_mutex_unlock(&mlx->lock);
+
+    *object = mlx_compensate(&terms, &raw);
+    return EXIT_SUCCESS;
+}
+
+int mlx_measure(struct mlx *mlx, double *object)
+{
+    uint tries = MLX_MAX_NUMBER_MESUREMENT_READ_TRIES;
+    uint64_t now;
+    int ret;
+
+    while (tries-- > 0)
+    {
+        ret = mlx_poll(mlx, object);
+        if (ret != ERROR_DATA_NOT_READY)
+            return ret;
+
+        now = timestamp_us();
+        if (mlx->next_us > now)
+            usleep(mlx->next_us - now);
+    }
+    return ERROR_DATA_NOT_READY;
+}
+
+/*
+ * registry adapters, the sensor runs continuously after mlx_init()
+ */
+
+static const struct sensor_field mlx_fields[] = {
+    { "object", "degC", -3 },
+};
+
+static int mlx_sensor_init(struct sensor *sensor)
+{
+    struct mlx *mlx = sensor->ctx;
+    int ret;
+
+    ret = mlx_init(mlx, sensor->slave.fd, sensor->slave.addr);
+    // the first result pairs two measurements
+    sensor->timeout_us = 2 * mlx->period_us + SENSOR_TIMEOUT * 100000;
+    return ret;
+}
+
+static int mlx_sensor_trigger(struct sensor *sensor, uint64_t *ready_at)
+{
+    const struct mlx *mlx = sensor->ctx;
+
+    *ready_at = mlx->next_us;
+    return EXIT_SUCCESS;
+}
+
+static int mlx_sensor_collect(struct sensor *sensor, struct sensor_raw *raw)
+{
+    struct mlx_raw temp_raw;
+    int ret;
+
+    ret = mlx_read_temp_raw(sensor->ctx, &temp_raw);
+    if (ret != EXIT_SUCCESS)
+        return ret;
+
+    memcpy(raw->data, &temp_raw, sizeof(temp_raw));
+    raw->len = sizeof(temp_raw);
+    raw->records = 1;
+    return EXIT_SUCCESS;
+}
+
+static int mlx_sensor_decode(const struct sensor *sensor, const struct sensor_raw *raw,
+                             int32_t values[SENSOR_MAX_VALUES])
+{
+    struct mlx *mlx = sensor->ctx;
+    struct mlx_terms terms;
+    struct mlx_raw temp_raw;
+
+    memcpy(&temp_raw, raw->data, sizeof(temp_raw));
+
+    pthread_mutex_lock(&mlx->lock);
+    terms = mlx->terms;
+    pthread_mutex_unlock(&mlx->lock);
+
+    values[0] = lroundf(mlx_compensate(&terms, &temp_raw) * 1000);
+    return EXIT_SUCCESS;
+}
+
+const struct sensor_driver mlx_driver = {
+    .name = "mlx",
+    .fields = mlx_fields,
+    .n_fields = ARRAY_SIZE(mlx_fields),
+    .init = mlx_sensor_init,
+    .trigger = mlx_sensor_trigger,
+    .ready = NULL,
+    .collect = mlx_sensor_collect,
+    .decode = mlx_sensor_decode,
+};
@@ -0,0 +1,333 @@
+/**
+ * @file    nmea_server.c
+ * @author  Jie Liu
+ * @version V1.0
+ * @date    2026-10-18
+ * @brief Local fan-out of the GNSS module to several processes
+ */
+
+#define _GNU_SOURCE /* accept4 */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "nmea_server.h"
+#include "gnss.h"
+#include "common.h"
+#include "error.h"
+
+/** listening sockets and UART in front of the clients in the poll set */
+#define NMEA_SERVER_FIXED_FDS 3
+/** poll timeout, bounds how long nmea_server_stop() takes effect [ms] */
+#define NMEA_SERVER_POLL_TIMEOUT 500
+
+/**
+ * @brief open a non-blocking listening Unix socket
+ * @param[out] fd socket
+ * @param[in] path socket path
+ * @return error code
+ */
+static int nmea_server_listen(int* fd, const char* path) {
+
+    struct sockaddr_un addr;
+
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        print_error(ERROR_INVALID_BUFFER_SIZE, "socket path too long");
+        return ERROR_INVALID_BUFFER_SIZE;
+    }
+
+    *fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (*fd < 0) {
+        print_errno("cannot create socket");
+        return errno;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    unlink(path);
+
+    if (bind(*fd, (struct sockaddr*)&addr, sizeof(addr)) == -1 ||
+        listen(*fd, NMEA_SERVER_MAX_CLIENTS) == -1) {
+        print_errno("cannot listen on socket");
+        close(*fd);
+        *fd = -1;
+        return errno;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief release a client slot
+ * @param[inout] client client to disconnect
+ */
+static void nmea_client_close(struct nmea_client* client) {
+
+    close(client->fd);
+    client->fd = -1;
+    client->head = 0;
+    client->tail = 0;
+}
+
+/**
+ * @brief send as much of the pending output as the socket takes
+ * @param[inout] client client to flush
+ */
+static void nmea_client_flush(struct nmea_client* client) {
+
+    ssize_t count;
+
+    if (client->fd < 0 || client->head == client->tail)
+        return;
+
+    count = send(client->fd, client->buffer + client->head,
+            client->tail - client->head, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (count < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+            nmea_client_close(client);
+        return;
+    }
+
+    client->head += count;
+    if (client->head == client->tail) {
+        client->head = 0;
+        client->tail = 0;
+    }
+}
+
+/**
+ * @brief queue a line for every client of a channel
+ * @note clients without room for the line are disconnected
+ * @param[inout] server server state
+ * @param[in] channel channel the line belongs to
+ * @param[in] line line to queue
+ * @param[in] length line length
+ */
+static void nmea_server_publish(struct nmea_server* server,
+        enum nmea_channel channel, const char* line, size_t length) {
+
+    struct nmea_client* client;
+    int i;
+
+    for (i = 0; i < NMEA_SERVER_MAX_CLIENTS; ++i) {
+        client = &server->clients[i];
+        if (client->fd < 0 || client->channel != channel)
+            continue;
+
+        if (client->tail + length > sizeof(client->buffer) && client->head) {
+            client->tail -= client->head;
+            memmove(client->buffer, client->buffer + client->head, client->tail);
+            client->head = 0;
+        }
+        if (client->tail + length > sizeof(client->buffer)) {
+            print_warning(ERROR_MAX_BUFFER_SIZE_REACHED, "client lagging behind, disconnected");
+            nmea_client_close(client);
+            ++server->dropped;
+            continue;
+        }
+
+        memcpy(client->buffer + client->tail, line, length);
+        client->tail += length;
+    }
+}
+
+/**
+ * @brief accept every pending connection on a listening socket
+ * @param[inout] server server state
+ * @param[in] channel channel of the listening socket
+ */
+static void nmea_server_accept(struct nmea_server* server,
+        enum nmea_channel channel) {
+
+    int fd;
+    int i;
+
+    while ((fd = accept4(server->listener[channel], NULL, NULL,
+                    SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+        for (i = 0; i < NMEA_SERVER_MAX_CLIENTS; ++i) {
+            if (server->clients[i].fd < 0)
+                break;
+        }
+        if (i == NMEA_SERVER_MAX_CLIENTS) {
+            print_warning(ERROR_MAX_BUFFER_SIZE_REACHED, "too many clients, connection refused");
+            close(fd);
+            continue;
+        }
+
+        server->clients[i].fd = fd;
+        server->clients[i].channel = channel;
+        server->clients[i].head = 0;
+        server->clients[i].tail = 0;
+    }
+}
+
+/**
+ * @brief parse every complete message received so far and queue the results
+ * @param[inout] server server state
+ */
+static void nmea_server_dispatch(struct nmea_server* server) {
+
+    char message[NMEA_SERVER_LINE_SIZE];
+    char line[NMEA_SERVER_LINE_SIZE];
+    char fields[NMEA_MAX_FIELDS][NMEA_FIELD_BUFFER];
+    uint8_t number_of_fields;
+    uint8_t checksum;
+    struct gnss_fix* fix = &server->fix;
+    int length;
+    int ret;
+
+    while ((ret = nmea_stream_next(&server->stream, message, sizeof(message)))
+            != ERROR_NMEA_NOT_FOUND) {
+        if (ret != EXIT_SUCCESS)
+            continue;
+
+        if (nmea_parse_fields(message, fields, &number_of_fields, &checksum)
+                != EXIT_SUCCESS || checksum != nmea_checksum(message))
+            continue;
+
+        nmea_server_publish(server, NMEA_CHANNEL_RAW, message, strlen(message));
+
+        if (nmea_parse_fix(fields, number_of_fields, fix) != EXIT_SUCCESS)
+            continue;
+
+        length = snprintf(line, sizeof(line),
+                "%u,%u,%u,%u,%u,%d,%d,%d,%u,%u,%u\n",
+                fix->time, fix->date, fix->valid, fix->quality,
+                fix->satellites, fix->latitude, fix->longitude,
+                fix->altitude, fix->hdop, fix->speed, fix->course);
+        nmea_server_publish(server, NMEA_CHANNEL_FIX, line, length);
+    }
+}
+
+int nmea_server_open(struct nmea_server* server, char* block_device,
+        const char* raw_path, const char* fix_path) {
+
+    int ret;
+    int i;
+
+    memset(server, 0, sizeof(*server));
+    server->listener[NMEA_CHANNEL_RAW] = -1;
+    server->listener[NMEA_CHANNEL_FIX] = -1;
+    server->path[NMEA_CHANNEL_RAW] = raw_path;
+    server->path[NMEA_CHANNEL_FIX] = fix_path;
+    for (i = 0; i < NMEA_SERVER_MAX_CLIENTS; ++i)
+        server->clients[i].fd = -1;
+
+    ret = gnss_init(&server->uart, block_device);
+    if (ret != EXIT_SUCCESS)
+        return ret;
+
+    ret = nmea_server_listen(&server->listener[NMEA_CHANNEL_RAW], raw_path);
+    if (ret == EXIT_SUCCESS)
+        ret = nmea_server_listen(&server->listener[NMEA_CHANNEL_FIX], fix_path);
+    if (ret != EXIT_SUCCESS) {
+        nmea_server_close(server);
+        return ret;
+    }
+
+    server->running = 1;
+
+    return EXIT_SUCCESS;
+}
+
+int nmea_server_run(struct nmea_server* server) {
+
+    struct pollfd fds[NMEA_SERVER_FIXED_FDS + NMEA_SERVER_MAX_CLIENTS];
+    struct nmea_client* client;
+    char discard[64];
+    int i;
+
+    while (server->running) {
+
+        fds[0].fd = server->uart;
+        fds[0].events = POLLIN;
+        fds[1].fd = server->listener[NMEA_CHANNEL_RAW];
+        fds[1].events = POLLIN;
+        fds[2].fd = server->listener[NMEA_CHANNEL_FIX];
+        fds[2].events = POLLIN;
+        for (i = 0; i < NMEA_SERVER_MAX_CLIENTS; ++i) {
+            client = &server->clients[i];
+            // negative descriptors are ignored by poll
+            fds[NMEA_SERVER_FIXED_FDS + i].fd = client->fd;
+            fds[NMEA_SERVER_FIXED_FDS + i].events = POLLIN;
+            if (client->head != client->tail)
+                fds[NMEA_SERVER_FIXED_FDS + i].events |= POLLOUT;
+        }
+
+        if (poll(fds, ARRAY_SIZE(fds), NMEA_SERVER_POLL_TIMEOUT) < 0) {
+            if (errno == EINTR)
+                continue;
+            print_errno("poll failed");
+            return errno;
+        }
+
+        if (fds[1].revents & POLLIN)
+            nmea_server_accept(server, NMEA_CHANNEL_RAW);
+        if (fds[2].revents & POLLIN)
+            nmea_server_accept(server, NMEA_CHANNEL_FIX);
+
+        // clients only listen; anything they send is dropped
+        for (i = 0; i < NMEA_SERVER_MAX_CLIENTS; ++i) {
+            client = &server->clients[i];
+            if (client->fd < 0 || client->fd != fds[NMEA_SERVER_FIXED_FDS + i].fd)
+                continue;
+            if (fds[NMEA_SERVER_FIXED_FDS + i].revents & (POLLHUP | POLLERR)) {
+                nmea_client_close(client);
+                continue;
+            }
+            if ((fds[NMEA_SERVER_FIXED_FDS + i].revents & POLLIN) &&
+                recv(client->fd, discard, sizeof(discard), MSG_DONTWAIT) == 0)
+                nmea_client_close(client);
+        }
+
+        if (fds[0].revents & POLLIN) {
+            while (nmea_stream_read(&server->uart, &server->stream) == EXIT_SUCCESS)
+                nmea_server_dispatch(server);
+        }
+        // the device went away: poll() would report it again at once, forever
+        if (fds[0].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+            print_error(EIO, "GNSS UART lost");
+            return EIO;
+        }
+
+        // one write per client for everything queued in this round
+        for (i = 0; i < NMEA_SERVER_MAX_CLIENTS; ++i)
+            nmea_client_flush(&server->clients[i]);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+void nmea_server_stop(struct nmea_server* server) {
+    server->running = 0;
+}
+
+void nmea_server_close(struct nmea_server* server) {
+
+    int i;
+
+    for (i = 0; i < NMEA_SERVER_MAX_CLIENTS; ++i) {
+        if (server->clients[i].fd >= 0)
+            nmea_client_close(&server->clients[i]);
+    }
+
+    for (i = 0; i < 2; ++i) {
+        if (server->listener[i] < 0)
+            continue;
+        close(server->listener[i]);
+        server->listener[i] = -1;
+        unlink(server->path[i]);
+    }
+
+    uart_close(&server->uart);
+}
+
+// vim: expandtab ts=4 sw=4
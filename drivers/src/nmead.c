@@ -0,0 +1,51 @@
+/**
+ * @file    nmead.c
+ * @author  Jie Liu
+ * @version V1.0
+ * @date    2026-10-18
+ * @brief GNSS fan-out daemon, owns the GNSS UART for every local consumer
+ * @note usage: nmead [block_device [raw_socket [fix_socket]]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+
+#include "nmea_server.h"
+
+/** default GNSS block device on the raspi-sensor-shield */
+#define NMEAD_BLOCK_DEVICE "/dev/serial0"
+
+static struct nmea_server server;
+
+static void nmead_signal(int signal) {
+    (void)signal; // unused
+    nmea_server_stop(&server);
+}
+
+int main(int argc, char* argv[]) {
+
+    char* block_device = argc > 1 ? argv[1] : NMEAD_BLOCK_DEVICE;
+    const char* raw_path = argc > 2 ? argv[2] : NMEA_SERVER_RAW_SOCKET;
+    const char* fix_path = argc > 3 ? argv[3] : NMEA_SERVER_FIX_SOCKET;
+    struct sigaction action = { .sa_handler = nmead_signal };
+    int ret;
+
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    ret = nmea_server_open(&server, block_device, raw_path, fix_path);
+    if (ret != EXIT_SUCCESS)
+        return ret;
+
+    ret = nmea_server_run(&server);
+
+    if (server.dropped)
+        printf("nmead: %u clients dropped for lagging behind\n", server.dropped);
+
+    nmea_server_close(&server);
+
+    return ret;
+}
+
+// vim: expandtab ts=4 sw=4
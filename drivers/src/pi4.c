@@ -12,12 +12,20 @@
 #include <fcntl.h>
 #include <string.h>
 #include <errno.h>
+#include <pthread.h>
 #include <sys/ioctl.h>
 #include <linux/i2c-dev.h>
 
 #include "common.h"
 #include "error.h"
 #include "pi4.h"
+#include "regcache.h"
+
+/** channels last written, valid if pi4_known; one mux, whichever file wrote it */
+static uint8_t pi4_current;
+static uint8_t pi4_known;
+static uint32_t pi4_writes;
+static pthread_mutex_t pi4_lock = PTHREAD_MUTEX_INITIALIZER;
 
 int pi4_set_channel(int* bus, uint8_t* mask) {
 
@@ -31,11 +39,14 @@ int pi4_set_channel(int* bus, uint8_t* mask) {
     reg.data[0] = *mask;
     reg.size = 1;
     ret = i2c_write_no_reg(bus, PI4_ADDR, &reg);
+    pi4_current = *mask;
+    pi4_known = ret == EXIT_SUCCESS;
 
 #ifdef PI4_CHECK_WRITE
     uint8_t return_mark = 0;
-    pi4_read_channel(bus, &return_mark);
+    pi4_get_channel(bus, &return_mark);
     if (*mask != return_mark) {
+        pi4_known = 0;
         print_errno("PI4 write failed!");
         return errno;
     }
@@ -44,6 +55,25 @@ int pi4_set_channel(int* bus, uint8_t* mask) {
     return ret;
 }
 
+int pi4_select(int bus, uint8_t mask) {
+
+    int ret = EXIT_SUCCESS;
+
+    pthread_mutex_lock(&pi4_lock);
+    if (!pi4_known || pi4_current != mask) {
+        ret = pi4_set_channel(&bus, &mask);
+        pi4_writes++;
+        regcache_invalidate(bus, REGCACHE_ANY_ADDR);
+    }
+    pthread_mutex_unlock(&pi4_lock);
+
+    return ret;
+}
+
+uint32_t pi4_switches(void) {
+    return pi4_writes;
+}
+
 int pi4_get_channel(int* bus, uint8_t* mask) {
 
 #ifdef PI4_DEBUG
@@ -0,0 +1,359 @@
+/**
+ * @file    regcache.c
+ * @author  Jie Liu
+ * @version V1.0
+ * @date    2026-10-18
+ * @brief Shadow of the configuration registers of every I2C slave
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "regcache.h"
+#include "common.h"
+#include "error.h"
+
+/** registers of a slave, 8-bit register addresses */
+#define REGCACHE_REGISTERS (UINT8_MAX + 1)
+/** words of a register bit map */
+#define REGCACHE_MAP_WORDS (REGCACHE_REGISTERS / 32)
+
+/**
+ * @struct regcache_dev
+ * @brief shadow of one slave
+ * @var used slot taken
+ * @var fd bus device file
+ * @var addr slave address
+ * @var valid registers whose value is known
+ * @var volatile_regs registers that are always passed through
+ * @var value last value written
+ */
+struct regcache_dev {
+    uint8_t used;
+    uint8_t fd;
+    uint8_t addr;
+    uint32_t valid[REGCACHE_MAP_WORDS];
+    uint32_t volatile_regs[REGCACHE_MAP_WORDS];
+    uint8_t value[REGCACHE_REGISTERS];
+};
+
+static struct regcache_dev devices[REGCACHE_MAX_DEVICES];
+/** bring-up threads and acquisition share the shadows; held over the writes
+ * too, so a shadow always matches what reached its slave */
+static pthread_mutex_t regcache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static inline int regcache_test(const uint32_t* map, uint8_t reg) {
+    return (map[reg / 32] >> (reg % 32)) & 1;
+}
+
+static inline void regcache_mark(uint32_t* map, uint8_t reg) {
+    map[reg / 32] |= UINT32_C(1) << (reg % 32);
+}
+
+static inline void regcache_clear(uint32_t* map, uint8_t reg) {
+    map[reg / 32] &= ~(UINT32_C(1) << (reg % 32));
+}
+
+/**
+ * @brief find the shadow of a slave, take a free slot for a new one
+ * @note with regcache_lock held
+ * @param[in] fd bus device file
+ * @param[in] addr slave address, 0 if unknown
+ * @return shadow, NULL if the slave cannot be shadowed
+ */
+static struct regcache_dev* regcache_find(uint8_t fd, uint8_t addr) {
+
+    struct regcache_dev* free_slot = NULL;
+    int i;
+
+    if (addr == 0)
+        return NULL;
+
+    for (i = 0; i < REGCACHE_MAX_DEVICES; ++i) {
+        if (!devices[i].used) {
+            if (!free_slot)
+                free_slot = &devices[i];
+            continue;
+        }
+        if (devices[i].fd == fd && devices[i].addr == addr)
+            return &devices[i];
+    }
+
+    if (free_slot) {
+        memset(free_slot, 0, sizeof(*free_slot));
+        free_slot->used = 1;
+        free_slot->fd = fd;
+        free_slot->addr = addr;
+    }
+
+    return free_slot;
+}
+
+/**
+ * @brief whether writing a value would change a register
+ * @param[in] dev shadow
+ * @param[in] reg register address
+ * @param[in] value value to write
+ * @return 1 if the write has to reach the slave
+ */
+static int regcache_differs(const struct regcache_dev* dev, uint8_t reg, uint8_t value) {
+    return regcache_test(dev->volatile_regs, reg) || !regcache_test(dev->valid, reg)
+        || dev->value[reg] != value;
+}
+
+/**
+ * @brief remember a value that reached the slave
+ * @param[inout] dev shadow
+ * @param[in] reg register address
+ * @param[in] value value written
+ */
+static void regcache_store(struct regcache_dev* dev, uint8_t reg, uint8_t value) {
+
+    if (regcache_test(dev->volatile_regs, reg))
+        return;
+    dev->value[reg] = value;
+    regcache_mark(dev->valid, reg);
+}
+
+/**
+ * @brief serve a read from the shadow if every register is known
+ * @param[in] dev shadow, may be NULL
+ * @param[in] reg first register address
+ * @param[out] data register values
+ * @param[in] len number of registers
+ * @return 1 if data was filled in
+ */
+static int regcache_lookup(const struct regcache_dev* dev, uint8_t reg,
+        uint8_t* data, uint32_t len) {
+
+    uint32_t i;
+
+    if (!dev || reg + len > REGCACHE_REGISTERS)
+        return 0;
+
+    for (i = 0; i < len; ++i) {
+        if (!regcache_test(dev->valid, reg + i) || regcache_test(dev->volatile_regs, reg + i))
+            return 0;
+    }
+    memcpy(data, &dev->value[reg], len);
+
+    return 1;
+}
+
+/**
+ * @brief write an auto increment burst, without the unchanged registers at
+ * either end
+ * @param[in] dev shadow, may be NULL
+ * @param[in] reg first register address
+ * @param[in] data register values
+ * @param[in] len number of registers
+ * @param[in] write transfer function
+ * @param[in] intf_ptr argument of the transfer function
+ * @return 0 on success, 1 otherwise
+ */
+static int8_t regcache_burst(struct regcache_dev* dev, uint8_t reg, const uint8_t* data,
+        uint32_t len, int8_t (*write)(uint8_t, const uint8_t*, uint32_t, void*), void* intf_ptr) {
+
+    uint32_t first;
+    uint32_t last;
+    int8_t ret;
+
+    if (!dev || reg + len > REGCACHE_REGISTERS)
+        return write(reg, data, len, intf_ptr);
+
+    for (first = 0; first < len && !regcache_differs(dev, reg + first, data[first]); ++first)
+        ;
+    if (first == len)
+        return 0;
+    for (last = len - 1; !regcache_differs(dev, reg + last, data[last]); --last)
+        ;
+
+    ret = write(reg + first, data + first, last - first + 1, intf_ptr);
+    for (; first <= last; ++first) {
+        if (ret)
+            regcache_clear(dev->valid, reg + first);
+        else
+            regcache_store(dev, reg + first, data[first]);
+    }
+
+    return ret;
+}
+
+/**
+ * @brief forget the shadow, see regcache_invalidate()
+ * @note with regcache_lock held
+ */
+static void regcache_forget(uint8_t fd, uint8_t addr) {
+
+    int i;
+
+    for (i = 0; i < REGCACHE_MAX_DEVICES; ++i) {
+        if (!devices[i].used || devices[i].fd != fd)
+            continue;
+        if (addr != REGCACHE_ANY_ADDR && devices[i].addr != addr)
+            continue;
+        memset(devices[i].valid, 0, sizeof(devices[i].valid));
+    }
+}
+
+int8_t regcache_write(uint8_t reg_addr, const uint8_t *reg_data, uint32_t len, void *intf_ptr) {
+
+    uint8_t fd = *(uint8_t*)intf_ptr;
+    int8_t ret;
+
+    pthread_mutex_lock(&regcache_lock);
+    ret = regcache_burst(regcache_find(fd, i2c_get_address(fd)), reg_addr, reg_data, len,
+            i2c_write, intf_ptr);
+    pthread_mutex_unlock(&regcache_lock);
+
+    return ret;
+}
+
+int8_t regcache_read(uint8_t reg_addr, uint8_t *reg_data, uint32_t len, void *intf_ptr) {
+
+    uint8_t fd = *(uint8_t*)intf_ptr;
+    int hit;
+
+    pthread_mutex_lock(&regcache_lock);
+    hit = regcache_lookup(regcache_find(fd, i2c_get_address(fd)), reg_addr, reg_data, len);
+    pthread_mutex_unlock(&regcache_lock);
+    if (hit)
+        return 0;
+
+    return i2c_read_8bit(reg_addr, reg_data, len, intf_ptr);
+}
+
+/**
+ * @brief regcache_slave_write() with regcache_lock held
+ */
+static int8_t regcache_slave_write_locked(uint8_t reg_addr, const uint8_t *reg_data,
+        uint32_t len, void *intf_ptr) {
+
+    i2c_slave* slave = intf_ptr;
+    struct regcache_dev* dev = regcache_find(slave->fd, slave->addr);
+    uint8_t pairs[2 * REGISTER_DATA_SIZE];
+    uint8_t reg;
+    uint8_t value;
+    uint32_t count = 0;
+    uint32_t i;
+    int8_t ret;
+
+    if (len == 1)
+        return regcache_burst(dev, reg_addr, reg_data, len, i2c_slave_write, intf_ptr);
+    if (!dev || len + 1 > sizeof(pairs)) {
+        regcache_forget(slave->fd, slave->addr);
+        return i2c_slave_write(reg_addr, reg_data, len, intf_ptr);
+    }
+
+    // {reg0, val0, reg1, val1, ...}, keep only the pairs that change something
+    for (i = 0; i < len; i += 2) {
+        reg = i ? reg_data[i - 1] : reg_addr;
+        value = reg_data[i];
+        if (!regcache_differs(dev, reg, value))
+            continue;
+        pairs[count++] = reg;
+        pairs[count++] = value;
+    }
+    if (count == 0)
+        return 0;
+
+    ret = i2c_slave_write(pairs[0], &pairs[1], count - 1, intf_ptr);
+    for (i = 0; i < count; i += 2) {
+        if (ret)
+            regcache_clear(dev->valid, pairs[i]);
+        else
+            regcache_store(dev, pairs[i], pairs[i + 1]);
+    }
+
+    return ret;
+}
+
+int8_t regcache_slave_write(uint8_t reg_addr, const uint8_t *reg_data, uint32_t len, void *intf_ptr) {
+
+    int8_t ret;
+
+    pthread_mutex_lock(&regcache_lock);
+    ret = regcache_slave_write_locked(reg_addr, reg_data, len, intf_ptr);
+    pthread_mutex_unlock(&regcache_lock);
+
+    return ret;
+}
+
+int8_t regcache_slave_read(uint8_t reg_addr, uint8_t *reg_data, uint32_t len, void *intf_ptr) {
+
+    i2c_slave* slave = intf_ptr;
+    int hit;
+
+    pthread_mutex_lock(&regcache_lock);
+    hit = regcache_lookup(regcache_find(slave->fd, slave->addr), reg_addr, reg_data, len);
+    pthread_mutex_unlock(&regcache_lock);
+    if (hit)
+        return 0;
+
+    return i2c_slave_read(reg_addr, reg_data, len, intf_ptr);
+}
+
+/**
+ * @brief regcache_update() with regcache_lock held
+ */
+static int regcache_update_locked(const i2c_slave *slave, uint8_t reg_addr, uint8_t mask,
+        uint8_t value) {
+
+    struct regcache_dev* dev = regcache_find(slave->fd, slave->addr);
+    i2c_slave target = *slave;
+    uint8_t current;
+    uint8_t next;
+
+    if (!regcache_lookup(dev, reg_addr, &current, 1) &&
+        i2c_slave_read(reg_addr, &current, 1, &target))
+        return ERROR_READ_REGISTER_FAILS;
+
+    next = (current & ~mask) | (value & mask);
+    if (dev && regcache_test(dev->valid, reg_addr) && next == current)
+        return EXIT_SUCCESS;
+
+    if (i2c_slave_write(reg_addr, &next, 1, &target)) {
+        if (dev)
+            regcache_clear(dev->valid, reg_addr);
+        return ERROR_WRITE_REGISTER_FAILS;
+    }
+    if (dev)
+        regcache_store(dev, reg_addr, next);
+
+    return EXIT_SUCCESS;
+}
+
+int regcache_update(const i2c_slave *slave, uint8_t reg_addr, uint8_t mask, uint8_t value) {
+
+    int ret;
+
+    pthread_mutex_lock(&regcache_lock);
+    ret = regcache_update_locked(slave, reg_addr, mask, value);
+    pthread_mutex_unlock(&regcache_lock);
+
+    return ret;
+}
+
+void regcache_set_volatile(const i2c_slave *slave, uint8_t reg_addr) {
+
+    struct regcache_dev* dev;
+
+    pthread_mutex_lock(&regcache_lock);
+    dev = regcache_find(slave->fd, slave->addr);
+    if (dev) {
+        regcache_mark(dev->volatile_regs, reg_addr);
+        regcache_clear(dev->valid, reg_addr);
+    }
+    pthread_mutex_unlock(&regcache_lock);
+}
+
+void regcache_invalidate(uint8_t fd, uint8_t addr) {
+
+    pthread_mutex_lock(&regcache_lock);
+    regcache_forget(fd, addr);
+    pthread_mutex_unlock(&regcache_lock);
+}
+
+// vim: expandtab ts=4 sw=4
@@ -0,0 +1,93 @@
+/**
+ * @file    ring.c
+ * @author  Jie Liu
+ * @version V1.0
+ * @date    2026-10-18
+ * @brief Lock-free single producer, single consumer ring of fixed-size records
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "ring.h"
+#include "error.h"
+
+int ring_init(struct ring* ring, uint32_t depth, size_t size) {
+
+    if (depth == 0 || (depth & (depth - 1)) || size == 0)
+        return ERROR_INVALID_BUFFER_SIZE;
+
+    ring->data = calloc(depth, size);
+    if (!ring->data) {
+        print_errno("cannot allocate ring");
+        return errno;
+    }
+
+    ring->size = size;
+    ring->mask = depth - 1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->high_water, 0);
+    atomic_init(&ring->drops, 0);
+    atomic_init(&ring->tail, 0);
+
+    return EXIT_SUCCESS;
+}
+
+void ring_free(struct ring* ring) {
+
+    free(ring->data);
+    ring->data = NULL;
+}
+
+int ring_push(struct ring* ring, const void* record) {
+
+    // indices run freely, the difference is the fill level
+    unsigned head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    unsigned level = head - tail;
+
+    if (level > ring->mask) {
+        atomic_fetch_add_explicit(&ring->drops, 1, memory_order_relaxed);
+        return ERROR_MAX_BUFFER_SIZE_REACHED;
+    }
+
+    memcpy(ring->data + (head & ring->mask) * ring->size, record, ring->size);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+
+    if (level + 1 > atomic_load_explicit(&ring->high_water, memory_order_relaxed))
+        atomic_store_explicit(&ring->high_water, level + 1, memory_order_relaxed);
+
+    return EXIT_SUCCESS;
+}
+
+uint32_t ring_pop(struct ring* ring, void* records, uint32_t max) {
+
+    unsigned tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    uint32_t n = head - tail;
+    uint32_t first;
+    uint32_t i;
+
+    if (n > max)
+        n = max;
+
+    // at most two copies, before and after the wrap
+    i = tail & ring->mask;
+    first = n < ring->mask + 1 - i ? n : ring->mask + 1 - i;
+    memcpy(records, ring->data + i * ring->size, first * ring->size);
+    memcpy((uint8_t*)records + first * ring->size, ring->data, (n - first) * ring->size);
+
+    atomic_store_explicit(&ring->tail, tail + n, memory_order_release);
+
+    return n;
+}
+
+uint32_t ring_level(struct ring* ring) {
+
+    return atomic_load_explicit(&ring->head, memory_order_acquire)
+        - atomic_load_explicit(&ring->tail, memory_order_acquire);
+}
+
+// vim: expandtab ts=4 sw=4
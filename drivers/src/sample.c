@@ -0,0 +1,77 @@
+/**
+ * @file    sample.c
+ * @author  Jie Liu
+ * @version V1.0
+ * @date    2026-10-18
+ * @brief Fixed-layout binary sample record, from decode to export
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sample.h"
+#include "sensor.h"
+#include "error.h"
+
+int sample_decode(const struct sensor* sensor, const struct sensor_raw* raw,
+        struct sample_record records[SAMPLE_MAX_RECORDS], uint8_t* n_records) {
+
+    int32_t values[SENSOR_MAX_VALUES];
+    uint8_t n_fields = sensor->driver->n_fields;
+    int ret;
+
+    *n_records = 0;
+    if (raw->records > SAMPLE_MAX_RECORDS || n_fields > SAMPLE_MAX_CHANNELS)
+        return ERROR_INVALID_BUFFER_SIZE;
+
+    ret = sensor_decode(sensor, raw, values);
+    if (ret != EXIT_SUCCESS)
+        return ret;
+
+    for (uint8_t r = 0; r < raw->records; r++) {
+        memset(&records[r], 0, sizeof(records[r]));
+        records[r].stamp_ns = raw->stamp_ns;
+        records[r].sensor = sensor->id;
+        records[r].channels = n_fields;
+        memcpy(records[r].value, &values[r * n_fields], n_fields * sizeof(values[0]));
+    }
+    *n_records = raw->records;
+
+    return EXIT_SUCCESS;
+}
+
+int sample_format(const struct sample_record* record, char* str, size_t len) {
+
+    const struct sensor* sensor = sensor_get(record->sensor);
+    size_t used = 0;
+    int64_t value;
+    int64_t scale;
+    int8_t exponent;
+
+    if (len)
+        *str = '\0';
+    if (!sensor || record->channels > sensor->driver->n_fields)
+        return ERROR_PARSER;
+
+    for (uint8_t c = 0; c < record->channels && used < len; c++) {
+        const char* sep = c ? "," : "";
+
+        value = record->value[c];
+        exponent = sensor->driver->fields[c].exponent;
+        if (exponent >= 0) {
+            used += snprintf(str + used, len - used, "%s%lld", sep, (long long)value);
+            continue;
+        }
+
+        for (scale = 1; exponent < 0; exponent++)
+            scale *= 10;
+        used += snprintf(str + used, len - used, "%s%s%lld.%0*lld", sep, value < 0 ? "-" : "",
+                         (long long)(llabs(value) / scale),
+                         -sensor->driver->fields[c].exponent, (long long)(llabs(value) % scale));
+    }
+
+    return used < len ? EXIT_SUCCESS : ERROR_INVALID_BUFFER_SIZE;
+}
+
+// vim: expandtab ts=4 sw=4
@@ -0,0 +1,467 @@
+/**
+ * @file    scheduler.c
+ * @author  Jie Liu
+ * @version V1.0
+ * @date    2026-10-18
+ * @brief Multi-rate acquisition scheduler on absolute deadline timerfds
+ */
+
+#define _GNU_SOURCE /* CPU_SET, pthread_attr_setaffinity_np */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/timerfd.h>
+
+#include "scheduler.h"
+#include "sensor.h"
+#include "common.h"
+#include "error.h"
+#include "timestamp.h"
+
+static inline struct timespec scheduler_timespec(uint64_t us) {
+    struct timespec ts = { us / 1000000, (us % 1000000) * 1000 };
+    return ts;
+}
+
+/**
+ * @brief histogram bucket of a latency
+ * @param[in] late_us latency [us]
+ * @return bucket, see SCHEDULER_LATENCY_BUCKETS
+ */
+static inline unsigned scheduler_bucket(uint64_t late_us) {
+
+    unsigned bucket;
+
+    if (late_us == 0)
+        return 0;
+    bucket = 64 - __builtin_clzll(late_us);
+    return bucket < SCHEDULER_LATENCY_BUCKETS ? bucket : SCHEDULER_LATENCY_BUCKETS - 1;
+}
+
+/**
+ * @brief take a free task slot
+ * @param[inout] sched scheduler state
+ * @return task, NULL if every slot is taken
+ */
+static struct scheduler_task* scheduler_alloc(struct scheduler* sched) {
+
+    struct scheduler_task* task;
+
+    if (sched->n_tasks >= SCHEDULER_MAX_TASKS) {
+        print_error(ERROR_MAX_BUFFER_SIZE_REACHED, "too many tasks");
+        return NULL;
+    }
+
+    task = &sched->tasks[sched->n_tasks];
+    memset(task, 0, sizeof(*task));
+    task->fd = -1;
+
+    return task;
+}
+
+void scheduler_init(struct scheduler* sched) {
+
+    memset(sched, 0, sizeof(*sched));
+    sched->start_us = timestamp_us();
+    sched->running = 1;
+}
+
+int scheduler_add_periodic(struct scheduler* sched, const char* name, uint32_t period_us,
+        uint32_t phase_us, scheduler_fn run, void* arg) {
+
+    struct scheduler_task* task = scheduler_alloc(sched);
+    struct itimerspec spec;
+    uint64_t first;
+    int ret;
+
+    if (!task)
+        return ERROR_MAX_BUFFER_SIZE_REACHED;
+    if (period_us == 0)
+        return ERROR_INVALID_BUFFER_SIZE;
+
+    task->fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (task->fd < 0) {
+        print_errno("cannot create timerfd");
+        return errno;
+    }
+
+    // armed once on an absolute grid, the kernel keeps it there
+    first = sched->start_us + phase_us;
+    spec.it_value = scheduler_timespec(first);
+    spec.it_interval = scheduler_timespec(period_us);
+    if (timerfd_settime(task->fd, TFD_TIMER_ABSTIME, &spec, NULL) == -1) {
+        ret = errno; // close() may change it
+        print_errno("cannot arm timerfd");
+        close(task->fd);
+        return ret;
+    }
+
+    task->name = name;
+    task->kind = SCHEDULER_PERIODIC;
+    task->period_us = period_us;
+    task->deadline_us = first - period_us;
+    task->run = run;
+    task->arg = arg;
+    sched->n_tasks++;
+
+    return EXIT_SUCCESS;
+}
+
+int scheduler_add_fd(struct scheduler* sched, const char* name, int fd, scheduler_fn run,
+        void* arg) {
+
+    struct scheduler_task* task = scheduler_alloc(sched);
+
+    if (!task)
+        return ERROR_MAX_BUFFER_SIZE_REACHED;
+
+    task->name = name;
+    task->kind = SCHEDULER_ON_DATA;
+    task->fd = fd;
+    task->run = run;
+    task->arg = arg;
+    sched->n_tasks++;
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief collect the previous conversion of a sensor and trigger the next
+ * @param[inout] arg struct scheduler_sensor
+ * @param[in] deadline_us deadline of this run
+ * @return error code
+ */
+static int scheduler_sensor_run(void* arg, uint64_t deadline_us) {
+
+    struct scheduler_sensor* task = arg;
+    struct sensor_raw raw;
+    uint64_t ready_at;
+    int ret = EXIT_SUCCESS;
+
+    (void)deadline_us; // results carry the time of their collect
+
+    if (task->pending) {
+        ret = sensor_ready(task->sensor);
+        if (ret == EXIT_SUCCESS)
+            ret = sensor_collect(task->sensor, &raw);
+        if (ret == EXIT_SUCCESS && task->sink)
+            task->sink(task->sensor, &raw, task->sink_arg);
+        // a result that is not there yet is not an error, just skipped
+        if (ret == ERROR_DATA_NOT_READY)
+            ret = EXIT_SUCCESS;
+    }
+
+    task->pending = sensor_trigger(task->sensor, &ready_at) == EXIT_SUCCESS;
+
+    return ret;
+}
+
+int scheduler_add_sensor(struct scheduler* sched, struct scheduler_sensor* task, uint32_t period_us,
+        uint32_t phase_us) {
+
+    int ret;
+
+    task->pending = 0;
+
+    ret = scheduler_add_periodic(sched, task->sensor->driver->name, period_us, phase_us,
+            scheduler_sensor_run, task);
+    if (ret == EXIT_SUCCESS)
+        sched->tasks[sched->n_tasks - 1].group = task->sensor->mux_mask;
+
+    return ret;
+}
+
+/**
+ * @brief run a task whose descriptor became readable
+ * @param[inout] task task
+ */
+static void scheduler_dispatch(struct scheduler_task* task) {
+
+    uint64_t expirations;
+    uint64_t now;
+    uint64_t late;
+
+    if (task->kind == SCHEDULER_PERIODIC) {
+        if (read(task->fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+            return; // spurious wake up, nothing expired
+        // the run belongs to the latest deadline, the earlier ones are lost
+        task->overruns += expirations - 1;
+        task->deadline_us += expirations * task->period_us;
+    } else {
+        task->deadline_us = timestamp_us();
+    }
+
+    now = timestamp_us();
+    late = now > task->deadline_us ? now - task->deadline_us : 0;
+    if (late > task->late_max_us)
+        task->late_max_us = late > UINT32_MAX ? UINT32_MAX : late;
+    task->late_sum_us += late;
+    task->latency[scheduler_bucket(late)]++;
+
+    task->runs++;
+    if (task->run(task->arg, task->deadline_us) != EXIT_SUCCESS)
+        task->errors++;
+}
+
+/**
+ * @brief sort key of a due task, tasks of the current bus setting go first
+ * @param[in] sched scheduler state
+ * @param[in] task task
+ * @return key, smaller runs earlier
+ */
+static inline unsigned scheduler_key(const struct scheduler* sched,
+        const struct scheduler_task* task) {
+    return task->group == 0 || task->group == sched->group ? 0 : 1u + task->group;
+}
+
+/**
+ * @brief order the due tasks so each bus setting is switched to once
+ * @param[in] sched scheduler state
+ * @param[inout] due task indices, in the order added
+ * @param[in] n_due number of due tasks
+ */
+static void scheduler_order(const struct scheduler* sched, size_t* due, size_t n_due) {
+
+    size_t i;
+    size_t j;
+    size_t index;
+    unsigned key;
+
+    // stable insertion sort, there are a handful at most
+    for (i = 1; i < n_due; ++i) {
+        index = due[i];
+        key = scheduler_key(sched, &sched->tasks[index]);
+        for (j = i; j > 0 && scheduler_key(sched, &sched->tasks[due[j - 1]]) > key; --j)
+            due[j] = due[j - 1];
+        due[j] = index;
+    }
+}
+
+int scheduler_run(struct scheduler* sched) {
+
+    struct pollfd fds[SCHEDULER_MAX_TASKS];
+    size_t due[SCHEDULER_MAX_TASKS];
+    size_t n_due;
+    size_t i;
+
+    for (i = 0; i < sched->n_tasks; ++i) {
+        fds[i].fd = sched->tasks[i].fd;
+        fds[i].events = POLLIN;
+    }
+
+    while (sched->running) {
+
+        if (poll(fds, sched->n_tasks, SCHEDULER_POLL_TIMEOUT) < 0) {
+            if (errno == EINTR)
+                continue;
+            print_errno("poll failed");
+            return errno;
+        }
+
+        n_due = 0;
+        for (i = 0; i < sched->n_tasks; ++i) {
+            if (fds[i].revents & POLLIN)
+                due[n_due++] = i;
+            else if (fds[i].revents & (POLLHUP | POLLERR | POLLNVAL))
+                fds[i].fd = -1; // watched descriptor is gone, stop polling it
+        }
+
+        scheduler_order(sched, due, n_due);
+        for (i = 0; i < n_due && sched->running; ++i) {
+            scheduler_dispatch(&sched->tasks[due[i]]);
+            if (sched->tasks[due[i]].group)
+                sched->group = sched->tasks[due[i]].group;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief thread of scheduler_start()
+ * @param[inout] arg struct scheduler
+ * @return NULL
+ */
+static void* scheduler_thread(void* arg) {
+
+    struct scheduler* sched = arg;
+
+    sched->result = scheduler_run(sched);
+
+    return NULL;
+}
+
+/**
+ * @brief set the real-time attributes of the scheduler thread
+ * @param[out] attr thread attributes, initialized
+ * @param[in] rt thread settings
+ * @return error code
+ */
+static int scheduler_rt_attr(pthread_attr_t* attr, const struct scheduler_rt* rt) {
+
+    struct sched_param param = { .sched_priority = rt->priority };
+    cpu_set_t cpus;
+    int ret = 0;
+
+    if (rt->priority > 0) {
+        ret = pthread_attr_setinheritsched(attr, PTHREAD_EXPLICIT_SCHED);
+        if (ret == 0)
+            ret = pthread_attr_setschedpolicy(attr, SCHED_FIFO);
+        if (ret == 0)
+            ret = pthread_attr_setschedparam(attr, &param);
+    }
+    if (ret == 0 && rt->cpu >= 0) {
+        CPU_ZERO(&cpus);
+        CPU_SET(rt->cpu, &cpus);
+        ret = pthread_attr_setaffinity_np(attr, sizeof(cpus), &cpus);
+    }
+
+    return ret;
+}
+
+int scheduler_start(struct scheduler* sched, const struct scheduler_rt* rt) {
+
+    static const struct scheduler_rt ordinary = { .priority = 0, .cpu = -1 };
+    pthread_attr_t attr;
+    size_t size;
+    int ret;
+
+    if (!rt)
+        rt = &ordinary;
+    size = rt->stack_size ? rt->stack_size : SCHEDULER_STACK_SIZE;
+
+    // locked before the stack exists, so the stack is locked with the rest
+    if (rt->lock_memory && mlockall(MCL_CURRENT | MCL_FUTURE) == -1) {
+        print_errno("cannot lock memory");
+        return errno;
+    }
+
+    ret = posix_memalign(&sched->stack, sysconf(_SC_PAGESIZE), size);
+    if (ret != 0) {
+        print_error(ret, "cannot allocate scheduler stack");
+        sched->stack = NULL;
+        return ret;
+    }
+    // touch every page now, not on the first deep call while sampling
+    memset(sched->stack, 0, size);
+
+    ret = pthread_attr_init(&attr);
+    if (ret == 0)
+        ret = pthread_attr_setstack(&attr, sched->stack, size);
+    if (ret == 0)
+        ret = scheduler_rt_attr(&attr, rt);
+    if (ret == 0)
+        ret = pthread_create(&sched->thread, &attr, scheduler_thread, sched);
+    pthread_attr_destroy(&attr);
+
+    if (ret != 0) {
+        print_error(ret, "cannot start scheduler thread");
+        free(sched->stack);
+        sched->stack = NULL;
+        return ret;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+int scheduler_join(struct scheduler* sched) {
+
+    if (!sched->stack)
+        return ERROR_STATE_MACHINE;
+
+    pthread_join(sched->thread, NULL);
+    free(sched->stack);
+    sched->stack = NULL;
+
+    return sched->result;
+}
+
+void scheduler_stop(struct scheduler* sched) {
+    sched->running = 0;
+}
+
+void scheduler_report(const struct scheduler* sched, FILE* stream) {
+
+    const struct scheduler_task* task;
+    size_t i;
+
+    fprintf(stream, "%-10s %10s %10s %10s %8s %8s %10s\n", "task", "period_us", "runs",
+            "overruns", "errors", "late_avg", "late_max");
+    for (i = 0; i < sched->n_tasks; ++i) {
+        task = &sched->tasks[i];
+        fprintf(stream, "%-10s %10u %10llu %10llu %8u %8llu %10u\n", task->name,
+                task->period_us, (unsigned long long)task->runs,
+                (unsigned long long)task->overruns, task->errors,
+                (unsigned long long)(task->runs ? task->late_sum_us / task->runs : 0),
+                task->late_max_us);
+    }
+}
+
+uint32_t scheduler_latency(const struct scheduler_task* task, uint32_t permille) {
+
+    uint64_t count = 0;
+    uint64_t limit;
+    unsigned i;
+
+    if (task->runs == 0)
+        return 0;
+
+    limit = (task->runs * permille + 999) / 1000;
+    for (i = 0; i < SCHEDULER_LATENCY_BUCKETS - 1; ++i) {
+        count += task->latency[i];
+        if (count >= limit)
+            return UINT32_C(1) << i;
+    }
+
+    return UINT32_MAX;
+}
+
+void scheduler_histogram(const struct scheduler* sched, FILE* stream) {
+
+    const struct scheduler_task* task;
+    uint32_t p999;
+    size_t i;
+    unsigned b;
+
+    for (i = 0; i < sched->n_tasks; ++i) {
+        task = &sched->tasks[i];
+        p999 = scheduler_latency(task, 999);
+
+        fprintf(stream, "%s: p50 <%u us, p99 <%u us, p99.9 <%u us", task->name,
+                scheduler_latency(task, 500), scheduler_latency(task, 990), p999);
+        if (task->kind == SCHEDULER_PERIODIC)
+            fprintf(stream, ", %s period %u us", p999 < task->period_us ? "within" : "OVER",
+                    task->period_us);
+        fputc('\n', stream);
+
+        for (b = 0; b < SCHEDULER_LATENCY_BUCKETS; ++b) {
+            if (task->latency[b] == 0)
+                continue;
+            if (b == SCHEDULER_LATENCY_BUCKETS - 1)
+                fprintf(stream, "  >=%9u us %10u\n", 1u << (b - 1), task->latency[b]);
+            else
+                fprintf(stream, "  <%10u us %10u\n", 1u << b, task->latency[b]);
+        }
+    }
+}
+
+void scheduler_close(struct scheduler* sched) {
+
+    size_t i;
+
+    for (i = 0; i < sched->n_tasks; ++i) {
+        if (sched->tasks[i].kind == SCHEDULER_PERIODIC && sched->tasks[i].fd >= 0)
+            close(sched->tasks[i].fd);
+        sched->tasks[i].fd = -1;
+    }
+    sched->n_tasks = 0;
+}
+
+// vim: expandtab ts=4 sw=4
@@ -0,0 +1,238 @@
+/**
+ * @file    sensor.c
+ * @author  Jie Liu
+ * @version V1.0
+ * @date    2026-10-18
+ * @brief Registry of the sensor drivers behind one acquisition interface
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "sensor.h"
+#include "common.h"
+#include "error.h"
+#include "timestamp.h"
+#include "apds.h"
+#include "bme.h"
+#include "lis2.h"
+#include "mlx.h"
+#include "pi4.h"
+#include "sample.h"
+
+/** BME68x on the shield */
+static struct bme_set bme;
+static struct lis2_duty lis2;
+static struct mlx mlx;
+
+/** addresses and channels of the shield, see topology.h to discover them */
+static struct sensor sensors[SENSOR_COUNT] = {
+    [SENSOR_APDS] = { SENSOR_APDS, &apds_driver, { 0, APDS_ADD }, NULL, 0, 0, PI4_APDS },
+    [SENSOR_BME] = { SENSOR_BME, &bme_driver, { 0, BME_ADD }, &bme, 0, 0, PI4_BME },
+    [SENSOR_LIS2] = { SENSOR_LIS2, &lis2_driver, { 0, LIS2_ADD }, &lis2, 0, 0, PI4_LIS },
+    [SENSOR_MLX] = { SENSOR_MLX, &mlx_driver, { 0, MLX_ADD }, &mlx, 0, 0, PI4_MLX },
+};
+
+/**
+ * @brief  check the active flag, pairs with the store in sensor_publish()
+ * @param[in] sensor sensor
+ * @return non-zero if active
+ */
+static inline uint8_t sensor_active(const struct sensor* sensor) {
+    return __atomic_load_n(&sensor->active, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief  enable the channels of a sensor, a no-op while they are
+ * @param[in] sensor sensor
+ * @return error code
+ */
+static inline int sensor_select(const struct sensor* sensor) {
+
+    if (sensor->mux_mask && pi4_select(sensor->slave.fd, sensor->mux_mask) != EXIT_SUCCESS)
+        return ERROR_WRITE_REGISTER_FAILS;
+
+    return EXIT_SUCCESS;
+}
+
+struct sensor* sensor_get(enum sensor_id id) {
+    return (unsigned)id < SENSOR_COUNT ? &sensors[id] : NULL;
+}
+
+int sensor_open(struct sensor* sensor, uint8_t fd) {
+
+    int ret;
+
+    sensor->slave.fd = fd;
+    ret = sensor_select(sensor);
+    if (ret == EXIT_SUCCESS)
+        ret = sensor->driver->init(sensor);
+    sensor->active = ret == EXIT_SUCCESS;
+
+    return ret;
+}
+
+size_t sensor_plan_mux(void) {
+
+    uint8_t masks[SENSOR_COUNT] = { 0 };
+    int8_t group[SENSOR_COUNT];
+    size_t n_groups = 0;
+    size_t g;
+    int i;
+    int j;
+
+    for (i = 0; i < SENSOR_COUNT; ++i) {
+        group[i] = -1;
+        if (!sensors[i].mux)
+            continue;
+
+        // first setting where no other channel uses the address
+        for (g = 0; g < n_groups; ++g) {
+            for (j = 0; j < i; ++j) {
+                if (group[j] == (int8_t)g && sensors[j].slave.addr == sensors[i].slave.addr
+                    && sensors[j].mux != sensors[i].mux)
+                    break;
+            }
+            if (j == i)
+                break;
+        }
+        if (g == n_groups)
+            n_groups++;
+        group[i] = g;
+        masks[g] |= sensors[i].mux;
+    }
+
+    for (i = 0; i < SENSOR_COUNT; ++i)
+        sensors[i].mux_mask = group[i] < 0 ? 0 : masks[group[i]];
+
+    return n_groups ? n_groups : 1;
+}
+
+void sensor_publish(struct sensor* sensor, const struct sensor* staged) {
+
+    sensor->slave = staged->slave;
+    sensor->timeout_us = staged->timeout_us;
+    // everything above is visible before the flag is
+    __atomic_store_n(&sensor->active, staged->active, __ATOMIC_RELEASE);
+}
+
+int sensor_trigger(struct sensor* sensor, uint64_t* ready_at) {
+
+    if (!sensor_active(sensor))
+        return ERROR_STATE_MACHINE;
+    if (sensor_select(sensor) != EXIT_SUCCESS)
+        return ERROR_WRITE_REGISTER_FAILS;
+    if (!sensor->driver->trigger) {
+        *ready_at = timestamp_us();
+        return EXIT_SUCCESS;
+    }
+
+    return sensor->driver->trigger(sensor, ready_at);
+}
+
+int sensor_ready(struct sensor* sensor) {
+
+    if (!sensor_active(sensor))
+        return ERROR_STATE_MACHINE;
+    if (sensor_select(sensor) != EXIT_SUCCESS)
+        return ERROR_WRITE_REGISTER_FAILS;
+
+    return sensor->driver->ready ? sensor->driver->ready(sensor) : EXIT_SUCCESS;
+}
+
+int sensor_collect(struct sensor* sensor, struct sensor_raw* raw) {
+
+    if (!sensor_active(sensor))
+        return ERROR_STATE_MACHINE;
+    if (sensor_select(sensor) != EXIT_SUCCESS)
+        return ERROR_WRITE_REGISTER_FAILS;
+
+    raw->records = 0;
+    raw->len = 0;
+    raw->stamp_ns = timestamp_ns();
+
+    return sensor->driver->collect(sensor, raw);
+}
+
+int sensor_decode(const struct sensor* sensor, const struct sensor_raw* raw,
+                  int32_t values[SENSOR_MAX_VALUES]) {
+
+    if (raw->records * sensor->driver->n_fields > SENSOR_MAX_VALUES)
+        return ERROR_INVALID_BUFFER_SIZE;
+
+    return sensor->driver->decode(sensor, raw, values);
+}
+
+int sensor_acquire(struct sensor* sensor, struct sensor_raw* raw) {
+
+    uint64_t ready_at;
+    uint64_t deadline;
+    uint64_t now;
+    int ret;
+
+    ret = sensor_trigger(sensor, &ready_at);
+    if (ret != EXIT_SUCCESS)
+        return ret;
+
+    now = timestamp_us();
+    if (ready_at > now)
+        delay_us(ready_at - now, NULL);
+    else
+        ready_at = now;
+
+    // SENSOR_TIMEOUT is in deciseconds
+    deadline = ready_at + (sensor->timeout_us ? sensor->timeout_us : SENSOR_TIMEOUT * 100000);
+    for (;;) {
+        ret = sensor_ready(sensor);
+        if (ret == EXIT_SUCCESS)
+            ret = sensor_collect(sensor, raw);
+        if (ret != ERROR_DATA_NOT_READY)
+            return ret;
+        if (timestamp_us() > deadline)
+            return ERROR_DATA_NOT_READY;
+        delay_us(SENSOR_POLL_US, NULL);
+    }
+}
+
+void sensor_activate(uint8_t slave_activate, uint8_t dev) {
+
+    struct sensor* sensor = sensor_get(slave_activate);
+    int ret;
+
+    if (!sensor)
+        return;
+    ret = sensor_open(sensor, dev);
+    if (ret != EXIT_SUCCESS)
+        print_warning(ret, sensor->driver->name);
+}
+
+void sensor_measure(uint8_t slave_activate, uint8_t dev, char* str, const size_t len) {
+
+    struct sensor* sensor = sensor_get(slave_activate);
+    struct sample_record records[SAMPLE_MAX_RECORDS];
+    struct sensor_raw raw;
+    uint8_t n_records;
+    size_t used = 0;
+
+    if (!sensor || !sensor_active(sensor) || sensor->slave.fd != dev)
+        return;
+    if (sensor_acquire(sensor, &raw) != EXIT_SUCCESS)
+        return; // nothing new, str stays as given
+    if (sample_decode(sensor, &raw, records, &n_records) != EXIT_SUCCESS)
+        return;
+
+    // text only at the very end, one line per record
+    for (uint8_t i = 0; i < n_records && used < len; i++) {
+        sample_format(&records[i], str + used, len - used);
+        used += strlen(str + used);
+        used += snprintf(str + used, len - used, " \n");
+    }
+#ifdef I2C_DEBUG
+    printf("%s: %s", sensor->driver->name, str);
+#endif
+}
+
+// vim: expandtab ts=4 sw=4
@@ -0,0 +1,726 @@
+/**
+ * @file    sim.c
+ * @author  Jie Liu
+ * @version V1.0
+ * @date    2026-10-18
+ * @brief Simulated raspi-sensor-shield, bus side and GNSS receiver
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <termios.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#include <linux/spi/spidev.h>
+
+#include "sim.h"
+#include "common.h"
+#include "error.h"
+#include "timestamp.h"
+
+/** descriptors the table covers, the drivers keep them in a uint8_t */
+#define SIM_MAX_FILES (UINT8_MAX + 1)
+/** messages of one I2C_RDWR, as the kernel allows */
+#define SIM_MAX_MSGS 42
+/** bytes of one transfer */
+#define SIM_MAX_XFER 4096
+/** GNSS position, the NMEA textbook one */
+#define SIM_GNSS_POSITION "4807.038,N,01131.000,E"
+
+/** kind of a simulated file */
+enum sim_file_kind {
+    SIM_FILE_NONE = 0, /// not ours, passed to the system
+    SIM_FILE_I2C,
+    SIM_FILE_SPI
+};
+
+/**
+ * @struct sim_file
+ * @brief an open simulated bus file
+ * @var kind I2C or SPI, SIM_FILE_NONE if free
+ * @var addr I2C: slave selected with I2C_SLAVE
+ * @var mode SPI: mode set
+ * @var bits SPI: bits per word set
+ * @var speed SPI: clock rate set [Hz]
+ */
+struct sim_file {
+    enum sim_file_kind kind;
+    uint8_t addr;
+    uint8_t mode;
+    uint8_t bits;
+    uint32_t speed;
+};
+
+/**
+ * @struct sim_gnss
+ * @brief GNSS receiver on a pseudo terminal
+ * @var master our side
+ * @var slave consumer side, kept open so the terminal stays raw
+ * @var thread emits the sentences
+ * @var lock guards stop
+ * @var wake wakes the thread up to stop
+ * @var stop the thread has to end
+ * @var running thread started
+ */
+struct sim_gnss {
+    int master;
+    int slave;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    int stop;
+    int running;
+};
+
+struct sim_timing sim_timing;
+
+/** bus lock, held through a whole transfer like the adapter lock */
+static pthread_mutex_t sim_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct sim_file sim_files[SIM_MAX_FILES];
+static struct sim_device sim_devices[SIM_MAX_DEVICES];
+static size_t sim_n_devices;
+static struct sim_stats sim_stats;
+static struct sim_gnss sim_gnss = { .master = -1, .slave = -1 };
+
+int32_t sim_noise(struct sim_device* dev, int32_t amplitude) {
+
+    uint32_t x = dev->seed;
+
+    // xorshift32, deterministic per device
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    dev->seed = x;
+
+    return amplitude ? (int32_t)(x % (2 * (uint32_t)amplitude + 1)) - amplitude : 0;
+}
+
+/**
+ * @brief hold the bus for the time the wire takes
+ * @param[in] ns time [ns]
+ */
+static void sim_wire(uint64_t ns) {
+
+    struct timespec t = { ns / 1000000000, ns % 1000000000 };
+
+    if (ns)
+        clock_nanosleep(CLOCK_MONOTONIC, 0, &t, NULL);
+}
+
+/**
+ * @brief channels the mux has enabled
+ * @return PI4 channel mask, 0 without a mux
+ */
+static uint8_t sim_mux_mask(void) {
+
+    size_t i;
+
+    for (i = 0; i < sim_n_devices; ++i) {
+        if (sim_devices[i].model == sim_models[SIM_PI4])
+            return sim_devices[i].regs[0];
+    }
+
+    return 0;
+}
+
+/**
+ * @brief register access of a device, write or read
+ * @param[inout] dev device
+ * @param[inout] buf data
+ * @param[in] len bytes
+ * @param[in] read read, else write
+ */
+static void sim_device_xfer(struct sim_device* dev, uint8_t* buf, size_t len, int read) {
+
+    const struct sim_model* model = dev->model;
+    uint64_t now = timestamp_ns();
+    size_t step = model->wide ? 2 : 1;
+    uint16_t value;
+    size_t i = 0;
+
+    if (model->xfer) {
+        model->xfer(dev, buf, len, read);
+        return;
+    }
+    if (model->sync)
+        model->sync(dev, now);
+
+    if (!read) {
+        // a write without data only moves the pointer
+        if (len < step)
+            return;
+        dev->pointer = model->wide ? (uint16_t)(buf[0] << 8 | buf[1]) : buf[0];
+        i = step;
+    }
+
+    for (; i + step <= len; i += step) {
+        if (read) {
+            value = model->load(dev, dev->pointer, now);
+            if (model->wide) {
+                buf[i] = value >> 8;
+                buf[i + 1] = value & 0xFF;
+            } else {
+                buf[i] = value;
+            }
+        } else if (model->paired && (i / step) % 2 == 0) {
+            dev->pointer = model->wide ? (uint16_t)(buf[i] << 8 | buf[i + 1]) : buf[i];
+            continue;
+        } else {
+            value = model->wide ? (uint16_t)(buf[i] << 8 | buf[i + 1]) : buf[i];
+            model->store(dev, dev->pointer, value, now);
+            if (model->paired)
+                continue;
+        }
+        dev->pointer = model->next ? model->next(dev, dev->pointer)
+                                   : (uint16_t)(dev->pointer + 1);
+        if (!model->wide)
+            dev->pointer &= 0xFF;
+    }
+}
+
+/**
+ * @brief one I2C message, with the bus lock held
+ * @param[in] addr slave address
+ * @param[inout] buf data
+ * @param[in] len bytes
+ * @param[in] read read, else write
+ * @return 0, errno value if nobody answered
+ */
+static int sim_i2c_msg(uint8_t addr, uint8_t* buf, size_t len, int read) {
+
+    struct sim_device* hit[SIM_MAX_DEVICES];
+    uint8_t tmp[SIM_MAX_XFER];
+    uint8_t mask = sim_mux_mask();
+    size_t n_hit = 0;
+    size_t i;
+    size_t b;
+
+    if (len > SIM_MAX_XFER)
+        return EINVAL;
+
+    for (i = 0; i < sim_n_devices; ++i) {
+        if (sim_devices[i].model == sim_models[SIM_LSM] || sim_devices[i].addr != addr)
+            continue;
+        if (sim_devices[i].mux && !(sim_devices[i].mux & mask))
+            continue;
+        hit[n_hit++] = &sim_devices[i];
+    }
+
+    ++sim_stats.transfers;
+    sim_wire((uint64_t)(len + 1) * sim_timing.byte_ns);
+    if (!n_hit) {
+        ++sim_stats.nacks;
+        return ENXIO;
+    }
+    if (n_hit > 1)
+        ++sim_stats.collisions;
+    sim_stats.bytes += len;
+
+    if (read)
+        memset(buf, 0xFF, len);
+    for (i = 0; i < n_hit; ++i) {
+        if (!read) {
+            // a model must not change what the next one gets
+            memcpy(tmp, buf, len);
+            if (hit[i]->model == sim_models[SIM_PI4])
+                ++sim_stats.mux_writes;
+            sim_device_xfer(hit[i], tmp, len, 0);
+            continue;
+        }
+        sim_device_xfer(hit[i], tmp, len, 1);
+        for (b = 0; b < len; ++b)
+            buf[b] &= tmp[b]; // open drain
+    }
+
+    return 0;
+}
+
+/**
+ * @brief one SPI transfer, one chip select frame, with the bus lock held
+ * @param[in] file SPI file
+ * @param[in] xfer transfer
+ */
+static void sim_spi_xfer(const struct sim_file* file, const struct spi_ioc_transfer* xfer) {
+
+    const uint8_t* tx = (const uint8_t*)(uintptr_t)xfer->tx_buf;
+    uint8_t* rx = (uint8_t*)(uintptr_t)xfer->rx_buf;
+    struct sim_device* dev = NULL;
+    uint8_t buf[SIM_MAX_XFER];
+    size_t len = xfer->len < SIM_MAX_XFER ? xfer->len : SIM_MAX_XFER;
+    size_t i;
+
+    for (i = 0; i < sim_n_devices; ++i) {
+        if (sim_devices[i].model == sim_models[SIM_LSM])
+            dev = &sim_devices[i];
+    }
+
+    ++sim_stats.transfers;
+    if (file->speed)
+        sim_wire(sim_timing.byte_ns ? (uint64_t)len * 8000000000ULL / file->speed : 0);
+    if (!len)
+        return;
+
+    // nobody driving: MISO floats high
+    memset(buf, 0xFF, len);
+    if (dev && tx) {
+        sim_stats.bytes += len - 1;
+        if (tx[0] & 0x80) {
+            // the data follows the address byte, as on the wire
+            buf[0] = tx[0] & 0x7F;
+            sim_device_xfer(dev, buf, 1, 0);
+            sim_device_xfer(dev, buf + 1, len - 1, 1);
+        } else {
+            memcpy(buf, tx, len);
+            sim_device_xfer(dev, buf, len, 0);
+            memset(buf, 0xFF, len);
+        }
+        buf[0] = 0xFF;
+    }
+
+    if (rx) {
+        for (i = 0; i < len; ++i)
+            rx[i] = buf[i];
+    }
+}
+
+/**
+ * @brief simulated file of a descriptor
+ * @param[in] fd descriptor
+ * @return file, NULL if not simulated
+ */
+static struct sim_file* sim_file_get(int fd) {
+
+    if (fd < 0 || fd >= SIM_MAX_FILES || sim_files[fd].kind == SIM_FILE_NONE)
+        return NULL;
+
+    return &sim_files[fd];
+}
+
+static int sim_open(const char* path, int flags) {
+
+    enum sim_file_kind kind = SIM_FILE_NONE;
+    int fd;
+
+    if (strncmp(path, "/dev/i2c-", 9) == 0)
+        kind = SIM_FILE_I2C;
+    else if (strncmp(path, "/dev/spidev", 11) == 0)
+        kind = SIM_FILE_SPI;
+    else
+        return open(path, flags);
+
+    // a real descriptor keeps the number unique in the process
+    fd = open("/dev/null", O_RDWR | (flags & O_CLOEXEC));
+    if (fd < 0)
+        return -1;
+    if (fd >= SIM_MAX_FILES) {
+        close(fd);
+        errno = EMFILE;
+        return -1;
+    }
+
+    pthread_mutex_lock(&sim_lock);
+    memset(&sim_files[fd], 0, sizeof(sim_files[fd]));
+    sim_files[fd].kind = kind;
+    sim_files[fd].bits = 8;
+    pthread_mutex_unlock(&sim_lock);
+
+    return fd;
+}
+
+static int sim_close_file(int fd) {
+
+    pthread_mutex_lock(&sim_lock);
+    if (sim_file_get(fd))
+        sim_files[fd].kind = SIM_FILE_NONE;
+    pthread_mutex_unlock(&sim_lock);
+
+    return close(fd);
+}
+
+static ssize_t sim_read(int fd, void* buf, size_t len) {
+
+    struct sim_file* file;
+    int ret;
+
+    pthread_mutex_lock(&sim_lock);
+    file = sim_file_get(fd);
+    if (!file) {
+        pthread_mutex_unlock(&sim_lock);
+        return read(fd, buf, len);
+    }
+    ret = file->kind == SIM_FILE_I2C ? sim_i2c_msg(file->addr, buf, len, 1) : EINVAL;
+    pthread_mutex_unlock(&sim_lock);
+
+    if (ret) {
+        errno = ret;
+        return -1;
+    }
+    return len;
+}
+
+static ssize_t sim_write(int fd, const void* buf, size_t len) {
+
+    uint8_t data[SIM_MAX_XFER];
+    struct sim_file* file;
+    int ret;
+
+    pthread_mutex_lock(&sim_lock);
+    file = sim_file_get(fd);
+    if (!file) {
+        pthread_mutex_unlock(&sim_lock);
+        return write(fd, buf, len);
+    }
+    if (file->kind != SIM_FILE_I2C || len > sizeof(data)) {
+        ret = EINVAL;
+    } else {
+        memcpy(data, buf, len);
+        ret = sim_i2c_msg(file->addr, data, len, 0);
+    }
+    pthread_mutex_unlock(&sim_lock);
+
+    if (ret) {
+        errno = ret;
+        return -1;
+    }
+    return len;
+}
+
+/**
+ * @brief I2C requests, with the bus lock held
+ * @return >= 0, -errno on error
+ */
+static int sim_i2c_ioctl(struct sim_file* file, unsigned long request, void* arg) {
+
+    struct i2c_rdwr_ioctl_data* rdwr = arg;
+    uintptr_t addr = (uintptr_t)arg;
+    int ret;
+    __u32 i;
+
+    switch (request) {
+    case I2C_SLAVE:
+    case I2C_SLAVE_FORCE:
+        if (addr > 0x7F)
+            return -EINVAL;
+        file->addr = addr;
+        return 0;
+    case I2C_FUNCS:
+        *(unsigned long*)arg = I2C_FUNC_I2C;
+        return 0;
+    case I2C_TIMEOUT:
+    case I2C_RETRIES:
+        return 0;
+    case I2C_RDWR:
+        if (rdwr->nmsgs > SIM_MAX_MSGS)
+            return -EINVAL;
+        // the messages go out with repeated starts, nobody comes in between
+        for (i = 0; i < rdwr->nmsgs; ++i) {
+            if (rdwr->msgs[i].flags & I2C_M_TEN)
+                return -EINVAL;
+            ret = sim_i2c_msg(rdwr->msgs[i].addr, rdwr->msgs[i].buf, rdwr->msgs[i].len,
+                              rdwr->msgs[i].flags & I2C_M_RD);
+            if (ret)
+                return -ret;
+        }
+        return rdwr->nmsgs;
+    default:
+        return -ENOTTY;
+    }
+}
+
+/**
+ * @brief SPI requests, with the bus lock held
+ * @return >= 0, -errno on error
+ */
+static int sim_spi_ioctl(struct sim_file* file, unsigned long request, void* arg) {
+
+    const struct spi_ioc_transfer* xfer = arg;
+    size_t n;
+    size_t i;
+    int len = 0;
+
+    if (_IOC_TYPE(request) == SPI_IOC_MAGIC && _IOC_NR(request) == 0
+        && _IOC_DIR(request) == _IOC_WRITE) {
+        n = _IOC_SIZE(request) / sizeof(struct spi_ioc_transfer);
+        for (i = 0; i < n; ++i) {
+            sim_spi_xfer(file, &xfer[i]);
+            len += xfer[i].len;
+        }
+        return len;
+    }
+
+    switch (request) {
+    case SPI_IOC_WR_MODE:
+        file->mode = *(uint8_t*)arg;
+        return 0;
+    case SPI_IOC_RD_MODE:
+        *(uint8_t*)arg = file->mode;
+        return 0;
+    case SPI_IOC_WR_BITS_PER_WORD:
+        if (*(uint8_t*)arg != 8 && *(uint8_t*)arg != 0)
+            return -EINVAL;
+        file->bits = 8;
+        return 0;
+    case SPI_IOC_RD_BITS_PER_WORD:
+        *(uint8_t*)arg = file->bits;
+        return 0;
+    case SPI_IOC_WR_MAX_SPEED_HZ:
+        file->speed = *(uint32_t*)arg;
+        return 0;
+    case SPI_IOC_RD_MAX_SPEED_HZ:
+        *(uint32_t*)arg = file->speed;
+        return 0;
+    default:
+        return -ENOTTY;
+    }
+}
+
+static int sim_ioctl(int fd, unsigned long request, void* arg) {
+
+    struct sim_file* file;
+    int ret;
+
+    pthread_mutex_lock(&sim_lock);
+    file = sim_file_get(fd);
+    if (!file) {
+        pthread_mutex_unlock(&sim_lock);
+        return ioctl(fd, request, arg);
+    }
+    ret = file->kind == SIM_FILE_I2C ? sim_i2c_ioctl(file, request, arg)
+                                     : sim_spi_ioctl(file, request, arg);
+    pthread_mutex_unlock(&sim_lock);
+
+    if (ret < 0) {
+        errno = -ret;
+        return -1;
+    }
+    return ret;
+}
+
+const struct bus_backend sim_backend = {
+    .name = "sim",
+    .open = sim_open,
+    .close = sim_close_file,
+    .read = sim_read,
+    .write = sim_write,
+    .ioctl = sim_ioctl,
+};
+
+/**
+ * @brief take every device off the buses, with the bus lock held
+ */
+static void sim_clear(void) {
+
+    size_t i;
+
+    for (i = 0; i < sim_n_devices; ++i)
+        free(sim_devices[i].state);
+    memset(sim_devices, 0, sizeof(sim_devices));
+    sim_n_devices = 0;
+}
+
+void sim_init(const struct sim_timing* timing) {
+
+    sim_gnss_close();
+
+    pthread_mutex_lock(&sim_lock);
+    sim_clear();
+    sim_timing = timing ? *timing : SIM_TIMING_DATASHEET;
+    memset(&sim_stats, 0, sizeof(sim_stats));
+    pthread_mutex_unlock(&sim_lock);
+}
+
+int sim_add(enum sim_model_id model, uint8_t addr, uint8_t mux) {
+
+    struct sim_device* dev;
+
+    if (model >= SIM_MODEL_COUNT || addr > 0x7F)
+        return ERROR_UNDEFINED_STATE;
+
+    pthread_mutex_lock(&sim_lock);
+    if (sim_n_devices >= SIM_MAX_DEVICES) {
+        pthread_mutex_unlock(&sim_lock);
+        return ERROR_MAX_BUFFER_SIZE_REACHED;
+    }
+
+    dev = &sim_devices[sim_n_devices];
+    memset(dev, 0, sizeof(*dev));
+    dev->model = sim_models[model];
+    dev->addr = addr;
+    dev->mux = mux;
+    dev->seed = 0x9E3779B9u * (sim_n_devices + 1);
+    if (dev->model->state_size && (dev->state = calloc(1, dev->model->state_size)) == NULL) {
+        pthread_mutex_unlock(&sim_lock);
+        return ENOMEM;
+    }
+    if (dev->model->reset)
+        dev->model->reset(dev, timestamp_ns());
+    ++sim_n_devices;
+    pthread_mutex_unlock(&sim_lock);
+
+    return EXIT_SUCCESS;
+}
+
+void sim_get_stats(struct sim_stats* stats) {
+
+    pthread_mutex_lock(&sim_lock);
+    *stats = sim_stats;
+    pthread_mutex_unlock(&sim_lock);
+}
+
+/**
+ * @brief send one NMEA sentence
+ * @param[in] fd master side
+ * @param[in] body sentence between '$' and '*'
+ */
+static void sim_gnss_send(int fd, const char* body) {
+
+    char sentence[128];
+    uint8_t checksum = 0;
+    const char* c;
+    int len;
+
+    for (c = body; *c; ++c)
+        checksum ^= *c;
+    len = snprintf(sentence, sizeof(sentence), "$%s*%02X\r\n", body, checksum);
+
+    // nobody reading: the sentence is lost, like on the wire
+    if (write(fd, sentence, len) < 0 && errno != EAGAIN)
+        print_errno("GNSS simulation cannot write");
+}
+
+/**
+ * @brief emit an RMC and a GGA sentence per fix
+ * @param[in] arg unused
+ */
+static void* sim_gnss_thread(void* arg) {
+
+    uint64_t period_ns = (sim_timing.gnss_us ? sim_timing.gnss_us : 1000000) * 1000ULL;
+    struct timespec next;
+    struct timespec wall;
+    char body[112];
+    char hms[16];  // hhmmss.ss, sized for three digits per field
+    char date[12]; // ddmmyy, likewise
+    struct tm tm;
+
+    (void)arg; // unused
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    pthread_mutex_lock(&sim_gnss.lock);
+    while (!sim_gnss.stop) {
+        clock_gettime(CLOCK_REALTIME, &wall);
+        gmtime_r(&wall.tv_sec, &tm);
+        snprintf(hms, sizeof(hms), "%02u%02u%02u.%02u", (uint8_t)tm.tm_hour, (uint8_t)tm.tm_min,
+                 (uint8_t)tm.tm_sec, (uint8_t)(wall.tv_nsec / 10000000));
+        snprintf(date, sizeof(date), "%02u%02u%02u", (uint8_t)tm.tm_mday, (uint8_t)(tm.tm_mon + 1),
+                 (uint8_t)(tm.tm_year % 100));
+
+        snprintf(body, sizeof(body), "GPRMC,%s,A," SIM_GNSS_POSITION ",000.0,000.0,%s,,,A",
+                 hms, date);
+        sim_gnss_send(sim_gnss.master, body);
+        snprintf(body, sizeof(body), "GPGGA,%s," SIM_GNSS_POSITION ",1,08,0.9,545.4,M,46.9,M,,",
+                 hms);
+        sim_gnss_send(sim_gnss.master, body);
+
+        next.tv_nsec += period_ns % 1000000000;
+        next.tv_sec += period_ns / 1000000000 + next.tv_nsec / 1000000000;
+        next.tv_nsec %= 1000000000;
+        while (!sim_gnss.stop
+               && pthread_cond_timedwait(&sim_gnss.wake, &sim_gnss.lock, &next) != ETIMEDOUT)
+            ;
+    }
+    pthread_mutex_unlock(&sim_gnss.lock);
+
+    return NULL;
+}
+
+int sim_gnss_open(char* path, size_t size) {
+
+    pthread_condattr_t attr;
+    struct termios raw;
+    int ret;
+
+    if (sim_gnss.running)
+        return ERROR_UNDEFINED_STATE;
+
+    sim_gnss.master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (sim_gnss.master < 0 || grantpt(sim_gnss.master) || unlockpt(sim_gnss.master)
+        || ptsname_r(sim_gnss.master, path, size)) {
+        ret = errno;
+        print_errno("GNSS simulation cannot open a pseudo terminal");
+        goto fail;
+    }
+    sim_gnss.slave = open(path, O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (sim_gnss.slave < 0 || tcgetattr(sim_gnss.slave, &raw)) {
+        ret = errno;
+        print_errno("GNSS simulation cannot open a pseudo terminal");
+        goto fail;
+    }
+    // no echo of what the consumer writes, no line editing
+    cfmakeraw(&raw);
+    tcsetattr(sim_gnss.slave, TCSANOW, &raw);
+
+    pthread_mutex_init(&sim_gnss.lock, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&sim_gnss.wake, &attr);
+    pthread_condattr_destroy(&attr);
+    sim_gnss.stop = 0;
+
+    ret = pthread_create(&sim_gnss.thread, NULL, sim_gnss_thread, NULL);
+    if (ret) {
+        print_error(ret, "GNSS simulation cannot start");
+        pthread_cond_destroy(&sim_gnss.wake);
+        pthread_mutex_destroy(&sim_gnss.lock);
+        goto fail;
+    }
+    sim_gnss.running = 1;
+
+    return EXIT_SUCCESS;
+
+fail:
+    if (sim_gnss.slave >= 0)
+        close(sim_gnss.slave);
+    if (sim_gnss.master >= 0)
+        close(sim_gnss.master);
+    sim_gnss.slave = sim_gnss.master = -1;
+    return ret;
+}
+
+void sim_gnss_close(void) {
+
+    if (!sim_gnss.running)
+        return;
+
+    pthread_mutex_lock(&sim_gnss.lock);
+    sim_gnss.stop = 1;
+    pthread_cond_signal(&sim_gnss.wake);
+    pthread_mutex_unlock(&sim_gnss.lock);
+    pthread_join(sim_gnss.thread, NULL);
+
+    pthread_cond_destroy(&sim_gnss.wake);
+    pthread_mutex_destroy(&sim_gnss.lock);
+    close(sim_gnss.slave);
+    close(sim_gnss.master);
+    sim_gnss.slave = sim_gnss.master = -1;
+    sim_gnss.running = 0;
+}
+
+void sim_close(void) {
+
+    sim_gnss_close();
+
+    pthread_mutex_lock(&sim_lock);
+    sim_clear();
+    pthread_mutex_unlock(&sim_lock);
+}
+
+// vim: expandtab ts=4 sw=4
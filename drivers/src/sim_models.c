@@ -0,0 +1,1379 @@
+/**
+ * @file    sim_models.c
+ * @author  Jie Liu
+ * @version V1.0
+ * @date    2026-10-18
+ * @brief Register-level models of the raspi-sensor-shield devices
+ * @note The measured values are smooth, slowly changing signals with a little
+ * noise: a room at about 22.5 °C, 1013 hPa and 45 %rH, a lit desk, a board
+ * lying flat. The BME68x calibration is a typical one, laid out the way the
+ * Bosch API reads it; its raw values are found by inverting the Bosch float
+ * compensation, so the driver reads the room back. The MLX90632 constants
+ * are the example of the Melexis datasheet, its raw values read the room.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "sim.h"
+#include "common.h"
+#include "error.h"
+#include "pi4.h"
+#include "apds.h"
+#include "lis2.h"
+#include "lsm.h"
+#include "mlx.h"
+
+/** period of the slow changes of the signals [s] */
+#define SIM_DRIFT_S 600.0
+
+/**
+ * @brief slow change of a signal
+ * @param[in] now time [ns]
+ * @param[in] amplitude largest deviation
+ * @return deviation at now
+ */
+static double sim_drift(uint64_t now, double amplitude) {
+    return amplitude * sin(2 * M_PI * (now / 1e9) / SIM_DRIFT_S);
+}
+
+/**
+ * @brief conversions done since a start
+ * @param[in] start start [ns]
+ * @param[in] now time [ns]
+ * @param[in] period_ns time per conversion [ns]
+ * @return conversions completed
+ */
+static uint64_t sim_count(uint64_t start, uint64_t now, uint64_t period_ns) {
+    return period_ns && now > start ? (now - start) / period_ns : 0;
+}
+
+/**
+ * @defgroup sim_pi4 PI4MSD5V9548A, one control register, no address
+ * @{
+ */
+
+static void sim_pi4_xfer(struct sim_device* dev, uint8_t* buf, size_t len, int read) {
+
+    size_t i;
+
+    if (read) {
+        for (i = 0; i < len; ++i)
+            buf[i] = dev->regs[0];
+    } else if (len) {
+        dev->regs[0] = buf[len - 1]; // the last byte of a write counts
+    }
+}
+
+static const struct sim_model sim_pi4 = {
+    .name = "pi4",
+    .xfer = sim_pi4_xfer,
+};
+
+///@}
+
+/**
+ * @defgroup sim_apds APDS-9151
+ * @{
+ */
+
+/** MAIN_CTRL: light sensor enabled */
+#define SIM_APDS_LS_EN 0x02
+/** MAIN_CTRL: software reset */
+#define SIM_APDS_SW_RESET 0x10
+/** MAIN_STATUS: power-on, cleared on read */
+#define SIM_APDS_POWER_ON 0x20
+/** INT_CFG: interrupt enabled */
+#define SIM_APDS_INT_EN 0x04
+/** INT_CFG: variance mode */
+#define SIM_APDS_VAR_MODE 0x08
+/** LS_THRES_UP, 3 bytes, then LS_THRES_LOW */
+#define SIM_APDS_THRES_UP 0x21
+/** PART_ID of the APDS-9151 */
+#define SIM_APDS_PART_ID 0xC2
+
+/**
+ * @struct sim_apds
+ * @var start light sensor enabled, or rate set [ns]
+ * @var done conversions done since start
+ * @var last_green green at the last variance interrupt
+ */
+struct sim_apds {
+    uint64_t start;
+    uint64_t done;
+    uint32_t last_green;
+};
+
+static const uint32_t sim_apds_conv_us[8] = { 400000, 200000, 100000, 50000, 25000, 3125,
+                                              3125, 3125 };
+static const uint32_t sim_apds_rate_us[8] = { 25000, 50000, 100000, 200000, 500000, 1000000,
+                                              2000000, 2000000 };
+static const uint8_t sim_apds_bits[8] = { 20, 19, 18, 17, 16, 13, 13, 13 };
+static const uint8_t sim_apds_gain[8] = { 1, 3, 6, 9, 18, 18, 18, 18 };
+
+static void sim_apds_reset(struct sim_device* dev, uint64_t now) {
+
+    struct sim_apds* apds = dev->state;
+
+    memset(dev->regs, 0, sizeof(dev->regs));
+    memset(apds, 0, sizeof(*apds));
+    dev->regs[APDS_LS_MEAS_RATE] = 0x22;
+    dev->regs[APDS_LS_GAIN] = 0x01;
+    dev->regs[APDS_PART_ID] = SIM_APDS_PART_ID;
+    dev->regs[APDS_MAIN_STATUS] = SIM_APDS_POWER_ON;
+    dev->regs[APDS_INT_CFG] = 0x10;
+    dev->regs[SIM_APDS_THRES_UP] = 0xFF;
+    dev->regs[SIM_APDS_THRES_UP + 1] = 0xFF;
+    dev->regs[SIM_APDS_THRES_UP + 2] = 0x0F;
+    apds->start = now;
+}
+
+/**
+ * @brief period of the conversions, the longer of conversion time and rate
+ * @return period [ns]
+ */
+static uint64_t sim_apds_period(const struct sim_device* dev) {
+
+    uint8_t rate = dev->regs[APDS_LS_MEAS_RATE];
+    uint32_t conv = sim_apds_conv_us[(rate >> 4) & 0x7];
+    uint32_t period = sim_apds_rate_us[rate & 0x7];
+
+    if (sim_timing.apds_us)
+        return sim_timing.apds_us * 1000ULL;
+    return (conv > period ? conv : period) * 1000ULL;
+}
+
+/**
+ * @brief store a channel, 20 bit little endian
+ */
+static void sim_apds_put(struct sim_device* dev, uint8_t reg, uint32_t value) {
+    dev->regs[reg] = value & 0xFF;
+    dev->regs[reg + 1] = (value >> 8) & 0xFF;
+    dev->regs[reg + 2] = (value >> 16) & 0x0F;
+}
+
+/**
+ * @brief one conversion, into the data registers and MAIN_STATUS
+ */
+static void sim_apds_convert(struct sim_device* dev, uint64_t now) {
+
+    struct sim_apds* apds = dev->state;
+    uint8_t res = (dev->regs[APDS_LS_MEAS_RATE] >> 4) & 0x7;
+    uint32_t full = (1UL << sim_apds_bits[res]) - 1;
+    double lux = 300 + sim_drift(now, 50);
+    double scale;
+    uint32_t green;
+    uint32_t threshold;
+    uint8_t cfg = dev->regs[APDS_INT_CFG];
+
+    // counts grow with gain and integration time, 3x and 100 ms give ~30/lux
+    scale = lux * 10 * sim_apds_gain[dev->regs[APDS_LS_GAIN] & 0x7]
+            * sim_apds_conv_us[res] / 100000.0;
+    green = scale + sim_noise(dev, 8);
+    green = green > full ? full : green;
+
+    sim_apds_put(dev, APDS_LS_DATA_IR_0, green / 4);
+    sim_apds_put(dev, APDS_LS_DATA_GREEN_0, green);
+    sim_apds_put(dev, APDS_LS_DATA_BLUE_0, green * 6 / 10);
+    sim_apds_put(dev, APDS_LS_DATA_RED_0, green * 8 / 10);
+    dev->regs[APDS_MAIN_STATUS] |= APDS_LS_DATA_STATUS;
+
+    if (!(cfg & SIM_APDS_INT_EN))
+        return;
+    if (cfg & SIM_APDS_VAR_MODE) {
+        threshold = 8U << (dev->regs[APDS_LS_THRES_VAR] & 0x7);
+        if ((green > apds->last_green ? green - apds->last_green : apds->last_green - green)
+            > threshold) {
+            dev->regs[APDS_MAIN_STATUS] |= APDS_LS_INT_STATUS;
+            apds->last_green = green;
+        }
+        return;
+    }
+    threshold = dev->regs[SIM_APDS_THRES_UP] | dev->regs[SIM_APDS_THRES_UP + 1] << 8
+                | (dev->regs[SIM_APDS_THRES_UP + 2] & 0x0F) << 16;
+    if (green > threshold)
+        dev->regs[APDS_MAIN_STATUS] |= APDS_LS_INT_STATUS;
+}
+
+static void sim_apds_sync(struct sim_device* dev, uint64_t now) {
+
+    struct sim_apds* apds = dev->state;
+    uint64_t n;
+
+    if (!(dev->regs[APDS_MAIN_CTRL] & SIM_APDS_LS_EN))
+        return;
+
+    // only the last conversion is visible, and a status bit is just a bit
+    n = sim_count(apds->start, now, sim_apds_period(dev));
+    if (n > apds->done) {
+        apds->done = n;
+        sim_apds_convert(dev, now);
+    }
+}
+
+static uint16_t sim_apds_load(struct sim_device* dev, uint16_t reg, uint64_t now) {
+
+    uint8_t value = dev->regs[reg];
+
+    (void)now; // unused
+    if (reg == APDS_MAIN_STATUS)
+        dev->regs[reg] &= ~(APDS_LS_DATA_STATUS | APDS_LS_INT_STATUS | SIM_APDS_POWER_ON);
+
+    return value;
+}
+
+static void sim_apds_store(struct sim_device* dev, uint16_t reg, uint16_t value, uint64_t now) {
+
+    struct sim_apds* apds = dev->state;
+
+    // PART_ID, MAIN_STATUS and the data are read-only
+    if (reg == APDS_PART_ID || (reg >= APDS_MAIN_STATUS && reg <= APDS_LS_DATA_RED_2))
+        return;
+
+    if (reg == APDS_MAIN_CTRL && (value & SIM_APDS_SW_RESET)) {
+        sim_apds_reset(dev, now);
+        return;
+    }
+    // enabling or new settings restart the conversion cycle
+    if ((reg == APDS_MAIN_CTRL && (value & SIM_APDS_LS_EN)
+         && !(dev->regs[reg] & SIM_APDS_LS_EN))
+        || reg == APDS_LS_MEAS_RATE || reg == APDS_LS_GAIN) {
+        apds->start = now;
+        apds->done = 0;
+    }
+    dev->regs[reg] = value;
+}
+
+static const struct sim_model sim_apds = {
+    .name = "apds",
+    .state_size = sizeof(struct sim_apds),
+    .reset = sim_apds_reset,
+    .sync = sim_apds_sync,
+    .load = sim_apds_load,
+    .store = sim_apds_store,
+};
+
+///@}
+
+/**
+ * @defgroup sim_bme BME68x
+ * @{
+ */
+
+#define SIM_BME_CHIP_ID 0x61
+#define SIM_BME_VARIANT 0x01 /// BME688
+#define SIM_BME_REG_CHIP_ID 0xD0
+#define SIM_BME_REG_VARIANT 0xF0
+#define SIM_BME_REG_RESET 0xE0
+#define SIM_BME_RESET_CMD 0xB6
+#define SIM_BME_REG_CTRL_GAS_1 0x71
+#define SIM_BME_REG_CTRL_HUM 0x72
+#define SIM_BME_REG_CTRL_MEAS 0x74
+#define SIM_BME_REG_GAS_WAIT_0 0x64
+#define SIM_BME_REG_GAS_WAIT_SHARED 0x6E
+/** run_gas of the BME680 and of the BME688 */
+#define SIM_BME_RUN_GAS 0x30
+/** field data blocks, 17 bytes each */
+#define SIM_BME_FIELD_SIZE 17
+/** meas_status: new data, gas measuring, measuring */
+#define SIM_BME_NEW_DATA 0x80
+#define SIM_BME_MEASURING 0x20
+/** gas_r_lsb: gas valid, heater stable */
+#define SIM_BME_GAS_OK 0x30
+/** calibration bytes, as the Bosch API concatenates them */
+#define SIM_BME_COEFF_SIZE 42
+
+static const uint8_t sim_bme_fields[3] = { 0x1D, 0x2E, 0x3F };
+static const uint8_t sim_bme_os_cycles[8] = { 0, 1, 2, 4, 8, 16, 16, 16 };
+
+/**
+ * @struct sim_bme
+ * @var pending forced measurement ends, 0 if none [ns]
+ * @var start parallel mode entered [ns]
+ * @var done parallel measurements since start
+ * @var meas_index measurement counter
+ */
+struct sim_bme {
+    uint64_t pending;
+    uint64_t start;
+    uint64_t done;
+    uint8_t meas_index;
+};
+
+/** calibration, typical values */
+static const struct {
+    uint16_t t1;
+    int16_t t2;
+    int8_t t3;
+    uint16_t p1;
+    int16_t p2;
+    int8_t p3;
+    int16_t p4;
+    int16_t p5;
+    int8_t p6;
+    int8_t p7;
+    int16_t p8;
+    int16_t p9;
+    uint8_t p10;
+    uint16_t h1;
+    uint16_t h2;
+    int8_t h3;
+    int8_t h4;
+    int8_t h5;
+    uint8_t h6;
+    int8_t h7;
+} sim_bme_calib = {
+    26130, 26401, 3,
+    36600, -10450, 88, 7600, -100, 30, 40, -2500, -2100, 30,
+    780, 1010, 0, 45, 20, 120, -100
+};
+
+/**
+ * @brief address of a calibration byte
+ * @param[in] i index in the Bosch coefficient array
+ * @return register
+ */
+static uint8_t sim_bme_coeff_reg(size_t i) {
+    if (i < 23)
+        return 0x8A + i;
+    if (i < 37)
+        return 0xE1 + (i - 23);
+    return 0x00 + (i - 37);
+}
+
+static void sim_bme_reset(struct sim_device* dev, uint64_t now) {
+
+    uint8_t c[SIM_BME_COEFF_SIZE] = { 0 };
+    size_t i;
+
+    (void)now; // unused
+    memset(dev->regs, 0, sizeof(dev->regs));
+    memset(dev->state, 0, sizeof(struct sim_bme));
+
+    c[0] = sim_bme_calib.t2 & 0xFF;
+    c[1] = (uint16_t)sim_bme_calib.t2 >> 8;
+    c[2] = sim_bme_calib.t3;
+    c[4] = sim_bme_calib.p1 & 0xFF;
+    c[5] = sim_bme_calib.p1 >> 8;
+    c[6] = sim_bme_calib.p2 & 0xFF;
+    c[7] = (uint16_t)sim_bme_calib.p2 >> 8;
+    c[8] = sim_bme_calib.p3;
+    c[10] = sim_bme_calib.p4 & 0xFF;
+    c[11] = (uint16_t)sim_bme_calib.p4 >> 8;
+    c[12] = sim_bme_calib.p5 & 0xFF;
+    c[13] = (uint16_t)sim_bme_calib.p5 >> 8;
+    c[14] = sim_bme_calib.p7;
+    c[15] = sim_bme_calib.p6;
+    c[18] = sim_bme_calib.p8 & 0xFF;
+    c[19] = (uint16_t)sim_bme_calib.p8 >> 8;
+    c[20] = sim_bme_calib.p9 & 0xFF;
+    c[21] = (uint16_t)sim_bme_calib.p9 >> 8;
+    c[22] = sim_bme_calib.p10;
+    // H1 and H2 are 12 bit and share a byte
+    c[23] = sim_bme_calib.h2 >> 4;
+    c[24] = (sim_bme_calib.h2 & 0x0F) << 4 | (sim_bme_calib.h1 & 0x0F);
+    c[25] = sim_bme_calib.h1 >> 4;
+    c[26] = sim_bme_calib.h3;
+    c[27] = sim_bme_calib.h4;
+    c[28] = sim_bme_calib.h5;
+    c[29] = sim_bme_calib.h6;
+    c[30] = sim_bme_calib.h7;
+    c[31] = sim_bme_calib.t1 & 0xFF;
+    c[32] = sim_bme_calib.t1 >> 8;
+    c[33] = (uint16_t)-12000 & 0xFF;  // GH2
+    c[34] = (uint16_t)-12000 >> 8;
+    c[35] = (uint8_t)-30;             // GH1
+    c[36] = 18;                       // GH3
+    c[37] = 40;                       // res_heat_val
+    c[39] = 1 << 4;                   // res_heat_range
+    c[41] = 0;                        // range_sw_err
+
+    for (i = 0; i < SIM_BME_COEFF_SIZE; ++i)
+        dev->regs[sim_bme_coeff_reg(i)] = c[i];
+    dev->regs[SIM_BME_REG_CHIP_ID] = SIM_BME_CHIP_ID;
+    dev->regs[SIM_BME_REG_VARIANT] = SIM_BME_VARIANT;
+}
+
+/** Bosch float compensation: t_fine of a raw temperature */
+static double sim_bme_t_fine(double adc_t, double t_fine) {
+
+    double t1 = sim_bme_calib.t1;
+    double var1 = (adc_t / 16384.0 - t1 / 1024.0) * sim_bme_calib.t2;
+    double var2 = (adc_t / 131072.0 - t1 / 8192.0);
+
+    (void)t_fine; // unused
+    return var1 + var2 * var2 * (sim_bme_calib.t3 * 16.0);
+}
+
+/** Bosch float compensation: pressure [Pa] of a raw pressure */
+static double sim_bme_pressure(double adc_p, double t_fine) {
+
+    double var1 = t_fine / 2.0 - 64000.0;
+    double var2;
+    double var3;
+    double calc;
+
+    var2 = var1 * var1 * (sim_bme_calib.p6 / 131072.0);
+    var2 = var2 + var1 * sim_bme_calib.p5 * 2.0;
+    var2 = var2 / 4.0 + sim_bme_calib.p4 * 65536.0;
+    var1 = (sim_bme_calib.p3 * var1 * var1 / 16384.0 + sim_bme_calib.p2 * var1) / 524288.0;
+    var1 = (1.0 + var1 / 32768.0) * sim_bme_calib.p1;
+    calc = 1048576.0 - adc_p;
+    calc = (calc - var2 / 4096.0) * 6250.0 / var1;
+    var1 = sim_bme_calib.p9 * calc * calc / 2147483648.0;
+    var2 = calc * (sim_bme_calib.p8 / 32768.0);
+    var3 = (calc / 256.0) * (calc / 256.0) * (calc / 256.0) * (sim_bme_calib.p10 / 131072.0);
+
+    return calc + (var1 + var2 + var3 + sim_bme_calib.p7 * 128.0) / 16.0;
+}
+
+/** Bosch float compensation: relative humidity [%] of a raw humidity */
+static double sim_bme_humidity(double adc_h, double t_fine) {
+
+    double temp = t_fine / 5120.0;
+    double var1 = adc_h - (sim_bme_calib.h1 * 16.0 + sim_bme_calib.h3 / 2.0 * temp);
+    double var2 = var1 * (sim_bme_calib.h2 / 262144.0
+                          * (1.0 + sim_bme_calib.h4 / 16384.0 * temp
+                             + sim_bme_calib.h5 / 1048576.0 * temp * temp));
+
+    return var2 + (sim_bme_calib.h6 / 16384.0 + sim_bme_calib.h7 / 2097152.0 * temp) * var2 * var2;
+}
+
+/**
+ * @brief raw value that compensates to a target, by bisection
+ * @param[in] f compensation, monotonic in the raw value
+ * @param[in] t_fine temperature term
+ * @param[in] target compensated value
+ * @param[in] max largest raw value
+ * @return raw value
+ */
+static uint32_t sim_bme_raw(double (*f)(double, double), double t_fine, double target,
+                            uint32_t max) {
+
+    uint32_t lo = 0;
+    uint32_t hi = max;
+    uint32_t mid;
+    int rising = f(max, t_fine) > f(0, t_fine);
+
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if ((f(mid, t_fine) < target) == rising)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+/**
+ * @brief TPH and heater time of a measurement
+ * @param[in] forced forced mode, else parallel
+ * @return duration [ns]
+ */
+static uint64_t sim_bme_duration(const struct sim_device* dev, int forced) {
+
+    uint8_t meas = dev->regs[SIM_BME_REG_CTRL_MEAS];
+    uint8_t wait = dev->regs[forced ? SIM_BME_REG_GAS_WAIT_0 : SIM_BME_REG_GAS_WAIT_SHARED];
+    uint64_t us;
+
+    if (sim_timing.bme_us)
+        return sim_timing.bme_us * 1000ULL;
+
+    // as bme68x_get_meas_dur(): cycles, TPH switching, gas measurement, wake up
+    us = (sim_bme_os_cycles[meas >> 5] + sim_bme_os_cycles[(meas >> 2) & 0x7]
+          + sim_bme_os_cycles[dev->regs[SIM_BME_REG_CTRL_HUM] & 0x7]) * 1963
+         + 477 * 4 + 477 * 5 + (forced ? 1000 : 0);
+    if (dev->regs[SIM_BME_REG_CTRL_GAS_1] & SIM_BME_RUN_GAS) {
+        // forced: 1 ms steps; parallel: 0.477 ms steps; factor 1, 4, 16, 64
+        us += (forced ? 1000 : 477) * (uint64_t)(wait & 0x3F) << (2 * (wait >> 6));
+    }
+
+    return us * 1000;
+}
+
+/**
+ * @brief one measurement into a field block
+ * @param[in] field field block, 0 to 2
+ * @param[in] gas_index heater step used
+ */
+static void sim_bme_measure(struct sim_device* dev, uint64_t now, uint8_t field,
+                            uint8_t gas_index) {
+
+    struct sim_bme* bme = dev->state;
+    uint8_t* f = &dev->regs[sim_bme_fields[field]];
+    uint8_t meas = dev->regs[SIM_BME_REG_CTRL_MEAS];
+    double t_fine;
+    uint32_t adc_t;
+    uint32_t adc_p = 0x80000; // skipped
+    uint32_t adc_h = 0x8000;
+    uint32_t gas;
+
+    adc_t = sim_bme_raw(sim_bme_t_fine, 0, (22.5 + sim_drift(now, 0.5)) * 5120.0 + sim_noise(dev, 20),
+                        0xFFFFF);
+    t_fine = sim_bme_t_fine(adc_t, 0);
+    if ((meas >> 2) & 0x7)
+        adc_p = sim_bme_raw(sim_bme_pressure, t_fine,
+                            101325.0 + sim_drift(now, 20) + sim_noise(dev, 2), 0xFFFFF);
+    if (dev->regs[SIM_BME_REG_CTRL_HUM] & 0x7)
+        adc_h = sim_bme_raw(sim_bme_humidity, t_fine,
+                            45.0 + sim_drift(now, 2) + sim_noise(dev, 10) / 100.0, 0xFFFF);
+    if (!(meas >> 5))
+        adc_t = 0x80000;
+    // gas ADC, range 4
+    gas = (600 + sim_noise(dev, 20)) & 0x3FF;
+
+    memset(f, 0, SIM_BME_FIELD_SIZE);
+    f[0] = SIM_BME_NEW_DATA | (gas_index & 0x0F);
+    f[1] = bme->meas_index++;
+    f[2] = adc_p >> 12;
+    f[3] = adc_p >> 4;
+    f[4] = (adc_p & 0xF) << 4;
+    f[5] = adc_t >> 12;
+    f[6] = adc_t >> 4;
+    f[7] = (adc_t & 0xF) << 4;
+    f[8] = adc_h >> 8;
+    f[9] = adc_h & 0xFF;
+    if (dev->regs[SIM_BME_REG_CTRL_GAS_1] & SIM_BME_RUN_GAS) {
+        // where the BME680 and where the BME688 keeps the gas result
+        f[13] = f[15] = gas >> 2;
+        f[14] = f[16] = (gas & 0x3) << 6 | SIM_BME_GAS_OK | 4;
+    }
+}
+
+static void sim_bme_sync(struct sim_device* dev, uint64_t now) {
+
+    struct sim_bme* bme = dev->state;
+    uint8_t steps = (dev->regs[SIM_BME_REG_CTRL_GAS_1] & 0x0F) + 1;
+    uint64_t n;
+
+    if (bme->pending && now >= bme->pending) {
+        bme->pending = 0;
+        sim_bme_measure(dev, now, 0, 0);
+        dev->regs[SIM_BME_REG_CTRL_MEAS] &= ~0x03; // back to sleep
+        return;
+    }
+
+    if ((dev->regs[SIM_BME_REG_CTRL_MEAS] & 0x03) != 0x02)
+        return;
+    // parallel: the fields are written in turn, the last three are visible
+    n = sim_count(bme->start, now, sim_bme_duration(dev, 0));
+    if (n > bme->done + 3)
+        bme->done = n - 3;
+    for (; bme->done < n; ++bme->done)
+        sim_bme_measure(dev, now, bme->done % 3, bme->done % steps);
+}
+
+static uint16_t sim_bme_load(struct sim_device* dev, uint16_t reg, uint64_t now) {
+
+    (void)now; // unused
+    return reg == SIM_BME_REG_RESET ? 0 : dev->regs[reg];
+}
+
+static void sim_bme_store(struct sim_device* dev, uint16_t reg, uint16_t value, uint64_t now) {
+
+    struct sim_bme* bme = dev->state;
+
+    if (reg == SIM_BME_REG_RESET) {
+        if (value == SIM_BME_RESET_CMD)
+            sim_bme_reset(dev, now);
+        return;
+    }
+    // only the heater and control registers can be written
+    if (reg < 0x50 || reg > 0x75)
+        return;
+
+    dev->regs[reg] = value;
+    if (reg != SIM_BME_REG_CTRL_MEAS)
+        return;
+
+    switch (value & 0x03) {
+    case 0x01: // forced: one measurement, then sleep
+        bme->pending = now + sim_bme_duration(dev, 1);
+        dev->regs[sim_bme_fields[0]] = SIM_BME_MEASURING;
+        break;
+    case 0x02: // parallel
+        bme->start = now;
+        bme->done = 0;
+        break;
+    default:
+        bme->pending = 0;
+        break;
+    }
+}
+
+static const struct sim_model sim_bme = {
+    .name = "bme",
+    .paired = 1,
+    .state_size = sizeof(struct sim_bme),
+    .reset = sim_bme_reset,
+    .sync = sim_bme_sync,
+    .load = sim_bme_load,
+    .store = sim_bme_store,
+};
+
+///@}
+
+/**
+ * @defgroup sim_lis2 LIS2DW12
+ * @{
+ */
+
+/** CTRL1: mode[3:2], single conversion on demand */
+#define SIM_LIS2_MODE_SINGLE 0x08
+/** CTRL2: soft reset */
+#define SIM_LIS2_SOFT_RESET 0x40
+/** CTRL2: address auto increment */
+#define SIM_LIS2_IF_ADD_INC 0x04
+/** CTRL3: SLP_MODE_1, starts a single conversion, cleared when done */
+#define SIM_LIS2_SLP_MODE_1 0x01
+/** CTRL3: SLP_MODE_SEL, the conversion is started over I2C */
+#define SIM_LIS2_SLP_MODE_SEL 0x02
+/** STATUS: FIFO threshold reached, sleep state */
+#define SIM_LIS2_STATUS_FTH 0x80
+#define SIM_LIS2_STATUS_SLEEP 0x20
+/** single conversion in low-power mode [us] */
+#define SIM_LIS2_SINGLE_US 2500
+
+/**
+ * @struct sim_lis2
+ * @var last last continuous sample [ns]
+ * @var pending single conversion ends, 0 if none [ns]
+ * @var asleep sleep state: inactivity dropped the rate
+ * @var sleep_at inactivity puts the device to sleep, 0 if never [ns]
+ * @var fifo stored samples
+ * @var head oldest sample
+ * @var n samples stored
+ * @var ovr samples were overwritten
+ */
+struct sim_lis2 {
+    uint64_t last;
+    uint64_t pending;
+    uint8_t asleep;
+    uint64_t sleep_at;
+    uint8_t fifo[LIS2DW12_FIFO_DEPTH][LIS2DW12_SAMPLE_SIZE];
+    uint8_t head;
+    uint8_t n;
+    uint8_t ovr;
+};
+
+/** ODR[7:4] in high-performance mode [mHz] */
+static const uint32_t sim_lis2_odr_mhz[16] = { 0, 12500, 12500, 25000, 50000, 100000, 200000,
+                                               400000, 800000, 1600000, 1600000, 1600000,
+                                               1600000, 1600000, 1600000, 1600000 };
+
+static void sim_lis2_reset(struct sim_device* dev, uint64_t now) {
+
+    memset(dev->regs, 0, sizeof(dev->regs));
+    memset(dev->state, 0, sizeof(struct sim_lis2));
+    dev->regs[LIS2_WHO_AM_I_ADD] = LIS2_WHO_AM_I_DEF;
+    dev->regs[LIS2DW12_CTRL2] = SIM_LIS2_IF_ADD_INC;
+    ((struct sim_lis2*)dev->state)->last = now;
+}
+
+/**
+ * @brief sample period in continuous mode
+ * @return period [ns], 0 if powered down or on demand
+ */
+static uint64_t sim_lis2_period(const struct sim_device* dev) {
+
+    const struct sim_lis2* lis2 = dev->state;
+    uint8_t ctrl1 = dev->regs[LIS2DW12_CTRL1];
+    uint32_t mhz = sim_lis2_odr_mhz[ctrl1 >> 4];
+
+    if (!mhz || (ctrl1 & 0x0C) == SIM_LIS2_MODE_SINGLE)
+        return 0;
+    if (lis2->asleep)
+        mhz = LIS2DW12_SLEEP_RATE_MHZ;
+    else if (sim_timing.lis2_us)
+        return sim_timing.lis2_us * 1000ULL;
+
+    return 1000000000000ULL / mhz;
+}
+
+/**
+ * @brief one sample into the output registers, and the FIFO if enabled
+ */
+static void sim_lis2_sample(struct sim_device* dev) {
+
+    struct sim_lis2* lis2 = dev->state;
+    uint8_t ctrl1 = dev->regs[LIS2DW12_CTRL1];
+    uint8_t mode = dev->regs[LIS2DW12_FIFO_CTRL] >> 5;
+    // 16-bit step at 2 g is 0.061 mg, doubling with every full scale
+    double lsb = 0.061 * (1 << ((dev->regs[LIS2DW12_CTRL6] >> 4) & 0x3));
+    // low-power mode 1 converts 12 bit, every other mode 14 bit
+    uint16_t mask = (ctrl1 & 0x0C) != 0x04 && (ctrl1 & 0x03) == 0 ? 0xFFF0 : 0xFFFC;
+    int16_t axis[3];
+    uint8_t* slot;
+    int i;
+
+    axis[0] = (int16_t)((int16_t)(sim_noise(dev, 8) / lsb) & mask);
+    axis[1] = (int16_t)((int16_t)(sim_noise(dev, 8) / lsb) & mask);
+    axis[2] = (int16_t)((int16_t)((1000 + sim_noise(dev, 8)) / lsb) & mask);
+    for (i = 0; i < 3; ++i) {
+        dev->regs[LIS2DW12_OUT_X_L + 2 * i] = (uint16_t)axis[i] & 0xFF;
+        dev->regs[LIS2DW12_OUT_X_L + 2 * i + 1] = (uint16_t)axis[i] >> 8;
+    }
+    dev->regs[LIS2DW12_STATUS] |= LIS2DW12_STATUS_DRDY;
+
+    if (mode == 0)
+        return;
+    if (lis2->n == LIS2DW12_FIFO_DEPTH) {
+        lis2->ovr = 1;
+        if (mode == 0x1) // FIFO mode stops when full
+            return;
+        lis2->head = (lis2->head + 1) % LIS2DW12_FIFO_DEPTH;
+        --lis2->n;
+    }
+    slot = lis2->fifo[(lis2->head + lis2->n) % LIS2DW12_FIFO_DEPTH];
+    memcpy(slot, &dev->regs[LIS2DW12_OUT_X_L], LIS2DW12_SAMPLE_SIZE);
+    ++lis2->n;
+}
+
+static void sim_lis2_sync(struct sim_device* dev, uint64_t now) {
+
+    struct sim_lis2* lis2 = dev->state;
+    uint64_t period;
+    uint64_t n;
+    uint64_t i;
+
+    if (lis2->pending && now >= lis2->pending) {
+        lis2->pending = 0;
+        sim_lis2_sample(dev);
+        dev->regs[LIS2DW12_CTRL3] &= ~SIM_LIS2_SLP_MODE_1;
+    }
+
+    // a board lying still: with SLEEP_ON it goes to sleep once and stays
+    if (lis2->sleep_at && now >= lis2->sleep_at && !lis2->asleep) {
+        n = sim_count(lis2->last, lis2->sleep_at, sim_lis2_period(dev));
+        for (i = 0; i < n && i <= LIS2DW12_FIFO_DEPTH; ++i)
+            sim_lis2_sample(dev);
+        lis2->last = lis2->sleep_at;
+        lis2->asleep = 1;
+    }
+
+    period = sim_lis2_period(dev);
+    n = sim_count(lis2->last, now, period);
+    if (!n)
+        return;
+    lis2->last += n * period;
+    // more than a FIFO full only overruns
+    for (i = 0; i < n && i <= LIS2DW12_FIFO_DEPTH; ++i)
+        sim_lis2_sample(dev);
+}
+
+static uint16_t sim_lis2_load(struct sim_device* dev, uint16_t reg, uint64_t now) {
+
+    struct sim_lis2* lis2 = dev->state;
+    uint8_t fth = dev->regs[LIS2DW12_FIFO_CTRL] & LIS2DW12_FIFO_FTH_MSK;
+
+    (void)now; // unused
+    switch (reg) {
+    case LIS2DW12_STATUS:
+        return dev->regs[reg] | (lis2->n >= fth && fth ? SIM_LIS2_STATUS_FTH : 0)
+               | (lis2->asleep ? SIM_LIS2_STATUS_SLEEP : 0);
+    case LIS2DW12_FIFO_SAMPLES:
+        return lis2->n | (lis2->n >= fth && fth ? LIS2DW12_FIFO_FTH : 0)
+               | (lis2->ovr ? LIS2DW12_FIFO_OVR : 0);
+    case LIS2DW12_WAKE_UP_SRC:
+        return lis2->asleep ? LIS2DW12_SLEEP_STATE_IA : 0;
+    case LIS2DW12_OUT_X_L:
+        // with the FIFO enabled, every read of a sample pops one
+        if (dev->regs[LIS2DW12_FIFO_CTRL] >> 5 && lis2->n) {
+            memcpy(&dev->regs[LIS2DW12_OUT_X_L], lis2->fifo[lis2->head], LIS2DW12_SAMPLE_SIZE);
+            lis2->head = (lis2->head + 1) % LIS2DW12_FIFO_DEPTH;
+            --lis2->n;
+            lis2->ovr = 0;
+        }
+        return dev->regs[reg];
+    case LIS2DW12_OUT_Z_H:
+        dev->regs[LIS2DW12_STATUS] &= ~LIS2DW12_STATUS_DRDY;
+        return dev->regs[reg];
+    default:
+        return dev->regs[reg];
+    }
+}
+
+static void sim_lis2_store(struct sim_device* dev, uint16_t reg, uint16_t value, uint64_t now) {
+
+    struct sim_lis2* lis2 = dev->state;
+    uint8_t dur;
+
+    switch (reg) {
+    case LIS2_WHO_AM_I_ADD:
+    case LIS2DW12_STATUS:
+    case LIS2DW12_FIFO_SAMPLES:
+    case LIS2DW12_WAKE_UP_SRC:
+        return; // read-only
+    case LIS2DW12_CTRL2:
+        if (value & SIM_LIS2_SOFT_RESET) {
+            sim_lis2_reset(dev, now);
+            return;
+        }
+        break;
+    case LIS2DW12_CTRL1:
+        lis2->last = now;
+        lis2->asleep = 0;
+        break;
+    case LIS2DW12_CTRL3:
+        if ((value & (SIM_LIS2_SLP_MODE_1 | SIM_LIS2_SLP_MODE_SEL))
+                == (SIM_LIS2_SLP_MODE_1 | SIM_LIS2_SLP_MODE_SEL)
+            && (dev->regs[LIS2DW12_CTRL1] & 0x0C) == SIM_LIS2_MODE_SINGLE && !lis2->pending)
+            lis2->pending = now + (sim_timing.lis2_us ? sim_timing.lis2_us
+                                                      : SIM_LIS2_SINGLE_US) * 1000ULL;
+        break;
+    case LIS2DW12_FIFO_CTRL:
+        if (!(value >> 5)) { // bypass empties the FIFO
+            lis2->n = 0;
+            lis2->ovr = 0;
+        }
+        break;
+    case LIS2DW12_WAKE_UP_THS:
+    case LIS2DW12_WAKE_UP_DUR:
+    case LIS2DW12_CTRL7:
+        dev->regs[reg] = value;
+        lis2->asleep = 0;
+        lis2->sleep_at = 0;
+        if ((dev->regs[LIS2DW12_WAKE_UP_THS] & LIS2DW12_SLEEP_ON)
+            && (dev->regs[LIS2DW12_CTRL7] & LIS2DW12_INTERRUPTS_ENABLE)
+            && sim_lis2_period(dev)) {
+            // SLEEP_DUR steps are 512 samples, 0 is 16
+            dur = dev->regs[LIS2DW12_WAKE_UP_DUR] & LIS2DW12_SLEEP_DUR_MSK;
+            lis2->sleep_at = now + sim_lis2_period(dev) * (dur ? 512ULL * dur : 16);
+        }
+        return;
+    default:
+        if (reg >= LIS2DW12_OUT_X_L && reg <= LIS2DW12_OUT_Z_H)
+            return;
+        break;
+    }
+    dev->regs[reg] = value;
+}
+
+static uint16_t sim_lis2_next(struct sim_device* dev, uint16_t reg) {
+
+    // with the FIFO enabled the address wraps from OUT_Z_H back to OUT_X_L
+    if (reg == LIS2DW12_OUT_Z_H && dev->regs[LIS2DW12_FIFO_CTRL] >> 5)
+        return LIS2DW12_OUT_X_L;
+
+    return dev->regs[LIS2DW12_CTRL2] & SIM_LIS2_IF_ADD_INC ? reg + 1 : reg;
+}
+
+static const struct sim_model sim_lis2 = {
+    .name = "lis2",
+    .state_size = sizeof(struct sim_lis2),
+    .reset = sim_lis2_reset,
+    .sync = sim_lis2_sync,
+    .load = sim_lis2_load,
+    .store = sim_lis2_store,
+    .next = sim_lis2_next,
+};
+
+///@}
+
+/**
+ * @defgroup sim_lsm LSM6DSL
+ * @{
+ */
+
+#define SIM_LSM_WHO_AM_I 0x6A
+/** CTRL3_C: software reset, address auto increment */
+#define SIM_LSM_SW_RESET 0x01
+#define SIM_LSM_IF_INC 0x04
+/** STATUS_REG: accelerometer, gyroscope, temperature data available */
+#define SIM_LSM_XLDA 0x01
+#define SIM_LSM_GDA 0x02
+#define SIM_LSM_TDA 0x04
+/** FIFO_STATUS2 flags */
+#define SIM_LSM_FIFO_WTM 0x80
+#define SIM_LSM_FIFO_OVER_RUN 0x40
+#define SIM_LSM_FIFO_FULL 0x20
+#define SIM_LSM_FIFO_EMPTY 0x10
+/** FIFO_CTRL5: FIFO mode, stops when full */
+#define SIM_LSM_FIFO_MODE_FIFO 0x01
+/** FIFO size [16-bit words] */
+#define SIM_LSM_FIFO_WORDS 2048
+
+/**
+ * @struct sim_lsm
+ * @var last_xl last accelerometer sample [ns]
+ * @var last_g last gyroscope sample [ns]
+ * @var last_fifo last FIFO data set [ns]
+ * @var fifo stored words
+ * @var head oldest word
+ * @var n words stored
+ * @var ovr words were overwritten
+ * @var pattern position of the next word read in the data set
+ * @var word word being read
+ */
+struct sim_lsm {
+    uint64_t last_xl;
+    uint64_t last_g;
+    uint64_t last_fifo;
+    uint16_t fifo[SIM_LSM_FIFO_WORDS];
+    uint16_t head;
+    uint16_t n;
+    uint8_t ovr;
+    uint16_t pattern;
+    uint16_t word;
+};
+
+static const double sim_lsm_xl_mg[4] = { 0.061, 0.488, 0.122, 0.244 };
+
+static void sim_lsm_reset(struct sim_device* dev, uint64_t now) {
+
+    (void)now; // unused
+    memset(dev->regs, 0, sizeof(dev->regs));
+    memset(dev->state, 0, sizeof(struct sim_lsm));
+    dev->regs[WHO_AM_I] = SIM_LSM_WHO_AM_I;
+    dev->regs[CTRL3_C] = SIM_LSM_IF_INC;
+}
+
+/**
+ * @brief period of an ODR[7:4] field
+ * @param[in] odr field, 12.5 Hz doubling with every step
+ * @return period [ns], 0 if off
+ */
+static uint64_t sim_lsm_period(uint8_t odr) {
+
+    if (!odr || odr > 10)
+        return 0;
+    if (sim_timing.lsm_us)
+        return sim_timing.lsm_us * 1000ULL;
+
+    return 80000000ULL >> (odr - 1);
+}
+
+/**
+ * @brief words of one FIFO data set
+ */
+static uint16_t sim_lsm_set_words(const struct sim_device* dev) {
+
+    uint8_t dec = dev->regs[FIFO_CTRL3];
+
+    return 3 * (((dec >> 3) & 0x7) != 0) + 3 * ((dec & 0x7) != 0);
+}
+
+static void sim_lsm_push(struct sim_device* dev, uint16_t word) {
+
+    struct sim_lsm* lsm = dev->state;
+
+    if (lsm->n == SIM_LSM_FIFO_WORDS) {
+        lsm->ovr = 1;
+        if ((dev->regs[FIFO_CTRL5] & 0x7) == SIM_LSM_FIFO_MODE_FIFO)
+            return;
+        lsm->head = (lsm->head + 1) % SIM_LSM_FIFO_WORDS;
+        --lsm->n;
+    }
+    lsm->fifo[(lsm->head + lsm->n) % SIM_LSM_FIFO_WORDS] = word;
+    ++lsm->n;
+}
+
+/** new accelerometer sample: flat, 1 g on z */
+static void sim_lsm_xl(struct sim_device* dev) {
+
+    double lsb = sim_lsm_xl_mg[(dev->regs[CTRL1_XL] >> 2) & 0x3];
+    int16_t axis[3] = { sim_noise(dev, 8) / lsb, sim_noise(dev, 8) / lsb,
+                        (1000 + sim_noise(dev, 8)) / lsb };
+    int i;
+
+    for (i = 0; i < 3; ++i) {
+        dev->regs[OUTX_L_XL + 2 * i] = (uint16_t)axis[i] & 0xFF;
+        dev->regs[OUTX_L_XL + 2 * i + 1] = (uint16_t)axis[i] >> 8;
+    }
+    // 25 °C reads 0, 256 LSB/°C
+    dev->regs[OUT_TEMP_L] = (uint8_t)sim_noise(dev, 16);
+    dev->regs[OUT_TEMP_H] = 0;
+    dev->regs[STATUS_REG] |= SIM_LSM_XLDA | SIM_LSM_TDA;
+}
+
+/** new gyroscope sample: still, zero-rate offset only */
+static void sim_lsm_g(struct sim_device* dev) {
+
+    int16_t rate;
+    int i;
+
+    for (i = 0; i < 3; ++i) {
+        rate = sim_noise(dev, 20);
+        dev->regs[OUTX_L_G + 2 * i] = (uint16_t)rate & 0xFF;
+        dev->regs[OUTX_L_G + 2 * i + 1] = (uint16_t)rate >> 8;
+    }
+    dev->regs[STATUS_REG] |= SIM_LSM_GDA;
+}
+
+static void sim_lsm_sync(struct sim_device* dev, uint64_t now) {
+
+    struct sim_lsm* lsm = dev->state;
+    uint64_t period;
+    uint64_t n;
+    uint64_t i;
+    uint16_t words = sim_lsm_set_words(dev);
+    uint8_t dec = dev->regs[FIFO_CTRL3];
+    int a;
+
+    if ((period = sim_lsm_period(dev->regs[CTRL1_XL] >> 4))
+        && (n = sim_count(lsm->last_xl, now, period))) {
+        lsm->last_xl += n * period;
+        sim_lsm_xl(dev);
+    }
+    if ((period = sim_lsm_period(dev->regs[CTRL2_G] >> 4))
+        && (n = sim_count(lsm->last_g, now, period))) {
+        lsm->last_g += n * period;
+        sim_lsm_g(dev);
+    }
+
+    if (!(dev->regs[FIFO_CTRL5] & 0x7) || !words)
+        return;
+    period = sim_lsm_period((dev->regs[FIFO_CTRL5] >> 3) & 0xF);
+    n = sim_count(lsm->last_fifo, now, period);
+    if (!n)
+        return;
+    lsm->last_fifo += n * period;
+    // more than a FIFO full only overruns
+    for (i = 0; i < n && i * words <= SIM_LSM_FIFO_WORDS; ++i) {
+        // gyroscope first, then accelerometer, as the pattern of the datasheet
+        if ((dec >> 3) & 0x7) {
+            sim_lsm_g(dev);
+            for (a = 0; a < 3; ++a)
+                sim_lsm_push(dev, dev->regs[OUTX_L_G + 2 * a] | dev->regs[OUTX_H_G + 2 * a] << 8);
+        }
+        if (dec & 0x7) {
+            sim_lsm_xl(dev);
+            for (a = 0; a < 3; ++a)
+                sim_lsm_push(dev, dev->regs[OUTX_L_XL + 2 * a]
+                                  | dev->regs[OUTX_L_XL + 2 * a + 1] << 8);
+        }
+    }
+}
+
+static uint16_t sim_lsm_load(struct sim_device* dev, uint16_t reg, uint64_t now) {
+
+    struct sim_lsm* lsm = dev->state;
+    uint16_t fth = dev->regs[FIFO_CTRL1] | (dev->regs[FIFO_CTRL2] & 0x7) << 8;
+    uint16_t words = sim_lsm_set_words(dev);
+    uint8_t value = dev->regs[reg];
+
+    (void)now; // unused
+    switch (reg) {
+    case FIFO_STATUS1:
+        return lsm->n & 0xFF;
+    case FIFO_STATUS2:
+        return ((lsm->n >> 8) & 0x7) | (fth && lsm->n >= fth ? SIM_LSM_FIFO_WTM : 0)
+               | (lsm->ovr ? SIM_LSM_FIFO_OVER_RUN : 0)
+               | (lsm->n == SIM_LSM_FIFO_WORDS ? SIM_LSM_FIFO_FULL : 0)
+               | (lsm->n ? 0 : SIM_LSM_FIFO_EMPTY);
+    case FIFO_STATUS3:
+        return lsm->pattern & 0xFF;
+    case FIFO_STATUS4:
+        return (lsm->pattern >> 8) & 0x3;
+    case FIFO_DATA_OUT_L:
+        lsm->word = 0;
+        if (lsm->n) {
+            lsm->word = lsm->fifo[lsm->head];
+            lsm->head = (lsm->head + 1) % SIM_LSM_FIFO_WORDS;
+            --lsm->n;
+            lsm->ovr = 0;
+            lsm->pattern = words ? (lsm->pattern + 1) % words : 0;
+        }
+        return lsm->word & 0xFF;
+    case FIFO_DATA_OUT_H:
+        return lsm->word >> 8;
+    case OUTZ_H_G:
+        dev->regs[STATUS_REG] &= ~SIM_LSM_GDA;
+        return value;
+    case OUTX_L_XL + 5:
+        dev->regs[STATUS_REG] &= ~SIM_LSM_XLDA;
+        return value;
+    case OUT_TEMP_H:
+        dev->regs[STATUS_REG] &= ~SIM_LSM_TDA;
+        return value;
+    default:
+        return value;
+    }
+}
+
+static void sim_lsm_store(struct sim_device* dev, uint16_t reg, uint16_t value, uint64_t now) {
+
+    struct sim_lsm* lsm = dev->state;
+
+    // identification, sources, status, outputs and FIFO data are read-only
+    if (reg == WHO_AM_I || (reg >= WAKE_UP_SRC && reg <= OUTX_L_XL + 5)
+        || (reg >= FIFO_STATUS1 && reg <= FIFO_DATA_OUT_H))
+        return;
+
+    switch (reg) {
+    case CTRL3_C:
+        if (value & SIM_LSM_SW_RESET) {
+            sim_lsm_reset(dev, now);
+            return;
+        }
+        break;
+    case CTRL1_XL:
+        lsm->last_xl = now;
+        break;
+    case CTRL2_G:
+        lsm->last_g = now;
+        break;
+    case FIFO_CTRL5:
+        lsm->last_fifo = now;
+        if (!(value & 0x7)) { // bypass empties the FIFO
+            lsm->n = 0;
+            lsm->ovr = 0;
+            lsm->pattern = 0;
+        }
+        break;
+    default:
+        break;
+    }
+    dev->regs[reg] = value;
+}
+
+static uint16_t sim_lsm_next(struct sim_device* dev, uint16_t reg) {
+
+    // the FIFO output rolls back to its low byte
+    if (reg == FIFO_DATA_OUT_H)
+        return FIFO_DATA_OUT_L;
+
+    return dev->regs[CTRL3_C] & SIM_LSM_IF_INC ? reg + 1 : reg;
+}
+
+static const struct sim_model sim_lsm = {
+    .name = "lsm",
+    .state_size = sizeof(struct sim_lsm),
+    .reset = sim_lsm_reset,
+    .sync = sim_lsm_sync,
+    .load = sim_lsm_load,
+    .store = sim_lsm_store,
+    .next = sim_lsm_next,
+};
+
+///@}
+
+/**
+ * @defgroup sim_mlx MLX90632
+ * @{
+ */
+
+/** EEPROM and RAM covered */
+#define SIM_MLX_EE_WORDS 0x100
+#define SIM_MLX_RAM_WORDS 0x40
+/** MEAS_1 at power-on, refresh rate 2: 500 ms per measurement */
+#define SIM_MLX_MEAS_1 0x820D
+
+/**
+ * @struct sim_mlx
+ * @var ee EEPROM from 0x2400
+ * @var ram RAM from MLX_ADDR_RAM
+ * @var ctrl MLX_REG_CTRL
+ * @var status MLX_REG_STATUS
+ * @var start continuous mode entered [ns]
+ * @var done measurements since start
+ * @var burst_end table pass in sleeping step mode ends, 0 if none [ns]
+ */
+struct sim_mlx {
+    uint16_t ee[SIM_MLX_EE_WORDS];
+    uint16_t ram[SIM_MLX_RAM_WORDS];
+    uint16_t ctrl;
+    uint16_t status;
+    uint64_t start;
+    uint64_t done;
+    uint64_t burst_end;
+};
+
+/** calibration of the Melexis example, 32-bit constants first */
+static const int32_t sim_mlx_calib32[] = {
+    0x00587f5b, // P_R
+    0x04a10289, // P_G
+    (int32_t)0xfff966f8, // P_T
+    0x00001e0f, // P_O
+    0, 0, 0, 0, 0, 0, 0, 0, // Aa up to Db, unused
+    4859535,    // Ea
+    5686508,    // Eb
+    53855361,   // Fa
+    42874149,   // Fb
+    -14556410,  // Ga
+};
+
+static void sim_mlx_put32(struct sim_mlx* mlx, uint16_t addr, int32_t value) {
+    // LSW at the lower address
+    mlx->ee[addr - 0x2400] = (uint32_t)value & 0xFFFF;
+    mlx->ee[addr - 0x2400 + 1] = (uint32_t)value >> 16;
+}
+
+static void sim_mlx_reset(struct sim_device* dev, uint64_t now) {
+
+    struct sim_mlx* mlx = dev->state;
+    size_t i;
+
+    memset(mlx, 0, sizeof(*mlx));
+    for (i = 0; i < ARRAY_SIZE(sim_mlx_calib32); ++i)
+        sim_mlx_put32(mlx, MLX_EE_P_R + 2 * i, sim_mlx_calib32[i]);
+    mlx->ee[MLX_EE_Gb - 0x2400] = 9728;
+    mlx->ee[MLX_EE_Ka - 0x2400] = 10752;
+    mlx->ee[MLX_EE_Ha - 0x2400] = 16384;
+    mlx->ee[MLX_EE_Hb - 0x2400] = 0;
+    mlx->ee[MLX_EE_MEAS_1 - 0x2400] = SIM_MLX_MEAS_1;
+    mlx->ee[MLX_EE_I2C_ADDRESS - 0x2400] = dev->addr;
+    // the chip ID is unique per sensor
+    for (i = 0; i < MLX_ID_WORDS; ++i)
+        mlx->ee[MLX_EE_ID0 - 0x2400 + i] = 0x5A00 + dev->addr * 3 + i;
+
+    mlx->ctrl = MLX_MODE_CONTINUOUS;
+    mlx->start = now;
+}
+
+/**
+ * @brief time of one measurement, half a table pass
+ * @return period [ns]
+ */
+static uint64_t sim_mlx_period(const struct sim_mlx* mlx) {
+
+    uint16_t meas_1 = mlx->ee[MLX_EE_MEAS_1 - 0x2400];
+
+    if (sim_timing.mlx_us)
+        return sim_timing.mlx_us * 1000ULL;
+
+    return (uint64_t)(MLX_MEAS_MAX_TIME >> ((meas_1 & MLX_EE_REFRESH) >> 8)) * 1000;
+}
+
+/**
+ * @brief one measurement into its RAM bank
+ * @param[in] pos cycle position, 1 or 2
+ */
+static void sim_mlx_measure(struct sim_device* dev, uint8_t pos) {
+
+    struct sim_mlx* mlx = dev->state;
+    uint16_t* bank = &mlx->ram[MLX_RAM_1(pos) - MLX_ADDR_RAM];
+    // ~22 °C ambient, an object a little warmer, slightly noisy
+    int16_t object = 60 + sim_noise(dev, 3);
+
+    bank[0] = (uint16_t)object;
+    bank[1] = (uint16_t)(object + sim_noise(dev, 2));
+    bank[2] = (pos == 1 ? 22454 : 26750) + sim_noise(dev, 2);
+    mlx->status = (mlx->status & ~MLX_STAT_CYCLE_POS) | MLX_STAT_DATA_RDY | pos << 2;
+}
+
+static void sim_mlx_sync(struct sim_device* dev, uint64_t now) {
+
+    struct sim_mlx* mlx = dev->state;
+    uint64_t n;
+
+    if (mlx->burst_end) {
+        if (now < mlx->burst_end)
+            return;
+        mlx->burst_end = 0;
+        sim_mlx_measure(dev, 1);
+        sim_mlx_measure(dev, 2);
+        mlx->status &= ~MLX_STAT_BUSY;
+        return;
+    }
+
+    if ((mlx->ctrl & MLX_CTRL_MODE) != MLX_MODE_CONTINUOUS)
+        return;
+    // the positions take turns, only the last two measurements are visible
+    n = sim_count(mlx->start, now, sim_mlx_period(mlx));
+    if (n > mlx->done + 2)
+        mlx->done = n - 2;
+    for (; mlx->done < n; ++mlx->done)
+        sim_mlx_measure(dev, mlx->done % 2 + 1);
+}
+
+static uint16_t sim_mlx_load(struct sim_device* dev, uint16_t reg, uint64_t now) {
+
+    struct sim_mlx* mlx = dev->state;
+
+    (void)now; // unused
+    if (reg >= 0x2400 && reg < 0x2400 + SIM_MLX_EE_WORDS)
+        return mlx->ee[reg - 0x2400];
+    if (reg >= MLX_ADDR_RAM && reg < MLX_ADDR_RAM + SIM_MLX_RAM_WORDS)
+        return mlx->ram[reg - MLX_ADDR_RAM];
+    switch (reg) {
+    case MLX_REG_I2C_ADDR:
+        return mlx->ee[MLX_EE_I2C_ADDRESS - 0x2400];
+    case MLX_REG_CTRL:
+        return mlx->ctrl;
+    case MLX_REG_STATUS:
+        return mlx->status;
+    default:
+        return 0;
+    }
+}
+
+static void sim_mlx_store(struct sim_device* dev, uint16_t reg, uint16_t value, uint64_t now) {
+
+    struct sim_mlx* mlx = dev->state;
+
+    switch (reg) {
+    case MLX_REG_CTRL:
+        if ((value & MLX_CTRL_MODE) == MLX_MODE_CONTINUOUS
+            && (mlx->ctrl & MLX_CTRL_MODE) != MLX_MODE_CONTINUOUS) {
+            mlx->start = now;
+            mlx->done = 0;
+        }
+        if ((value & MLX_CTRL_MODE) == MLX_MODE_SLEEPING_STEP && (value & MLX_CTRL_SOB)
+            && !mlx->burst_end) {
+            mlx->burst_end = now + 2 * sim_mlx_period(mlx);
+            mlx->status |= MLX_STAT_BUSY;
+        }
+        mlx->ctrl = value & ~MLX_CTRL_SOB; // SOB clears itself
+        break;
+    case MLX_REG_STATUS:
+        // only NEW_DATA and brown out can be cleared
+        mlx->status &= value | ~(MLX_STAT_DATA_RDY | MLX_STAT_BROWN_OUT);
+        break;
+    default:
+        // the EEPROM needs an unlock sequence, which is not modelled
+        break;
+    }
+}
+
+static const struct sim_model sim_mlx = {
+    .name = "mlx",
+    .wide = 1,
+    .state_size = sizeof(struct sim_mlx),
+    .reset = sim_mlx_reset,
+    .sync = sim_mlx_sync,
+    .load = sim_mlx_load,
+    .store = sim_mlx_store,
+};
+
+///@}
+
+const struct sim_model* const sim_models[SIM_MODEL_COUNT] = {
+    [SIM_PI4] = &sim_pi4,
+    [SIM_APDS] = &sim_apds,
+    [SIM_BME] = &sim_bme,
+    [SIM_LIS2] = &sim_lis2,
+    [SIM_LSM] = &sim_lsm,
+    [SIM_MLX] = &sim_mlx,
+};
+
+int sim_shield(void) {
+
+    static const struct {
+        enum sim_model_id model;
+        uint8_t addr;
+        uint8_t mux;
+    } shield[] = {
+        { SIM_PI4, PI4_ADDR, 0 },
+        { SIM_APDS, APDS_ADD, PI4_APDS },
+        { SIM_BME, BME_ADD, PI4_BME },
+        { SIM_LIS2, LIS2_ADD, PI4_LIS },
+        { SIM_MLX, MLX_ADD, PI4_MLX },
+        { SIM_LSM, 0, 0 },
+    };
+    size_t i;
+    int ret;
+
+    for (i = 0; i < ARRAY_SIZE(shield); ++i) {
+        ret = sim_add(shield[i].model, shield[i].addr, shield[i].mux);
+        if (ret != EXIT_SUCCESS)
+            return ret;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+// vim: expandtab ts=4 sw=4
@@ -0,0 +1,327 @@
+/**
+ * @file    synth.c
+ * @author  Jie Liu
+ * @version V1.0
+ * @date    2026-10-18
+ * @brief Synthetic load on the acquisition pipeline, to find where it saturates
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "synth.h"
+#include "common.h"
+#include "error.h"
+#include "ring.h"
+#include "sample.h"
+#include "sensor.h"
+#include "timestamp.h"
+#include "writer.h"
+
+/**
+ * @struct synth_generator
+ * @brief a synthetic sensor and the task driving it
+ * @var sensor what the scheduler task and the sink see
+ * @var driver collects generated values, schema borrowed from the registry
+ * @var task scheduler task
+ * @var name label of its rows, "synth" and the index
+ * @var index position among the generators, seeds the values
+ * @var records records per collect
+ * @var sequence records generated so far
+ */
+struct synth_generator {
+    struct sensor sensor;
+    struct sensor_driver driver;
+    struct scheduler_sensor task;
+    char name[12];
+    uint8_t index;
+    uint8_t records;
+    uint32_t sequence;
+};
+
+/**
+ * @struct synth_state
+ * @brief pipeline under load
+ */
+struct synth_state {
+    struct synth_generator generators[SYNTH_MAX_GENERATORS];
+    struct scheduler sched;
+    struct ring ring;
+    struct writer writer;
+};
+
+/**
+ * @brief value of a channel, spread over the range like a real signal
+ * @param[in] index generator, no two generate the same values
+ * @param[in] sequence record number
+ * @param[in] channel channel
+ * @return value
+ */
+static inline int32_t synth_value(uint8_t index, uint32_t sequence, uint8_t channel) {
+    return (int32_t)((sequence * 2654435761u + channel * 40503u + index * 2246822519u)
+        % 200001u) - 100000;
+}
+
+static int synth_collect(struct sensor* sensor, struct sensor_raw* raw) {
+
+    struct synth_generator* gen = sensor->ctx;
+    uint8_t channels = gen->driver.n_fields;
+    int32_t value;
+
+    raw->records = gen->records;
+    for (uint8_t r = 0; r < raw->records; ++r, ++gen->sequence) {
+        for (uint8_t c = 0; c < channels; ++c) {
+            value = synth_value(gen->index, gen->sequence, c);
+            memcpy(&raw->data[(r * channels + c) * sizeof(value)], &value, sizeof(value));
+        }
+    }
+    raw->len = raw->records * channels * sizeof(value);
+
+    return EXIT_SUCCESS;
+}
+
+static int synth_decode(const struct sensor* sensor, const struct sensor_raw* raw,
+                        int32_t values[SENSOR_MAX_VALUES]) {
+    (void)sensor; // the values are in the raw record as they are
+    memcpy(values, raw->data, raw->len);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief registry sensor whose schema fits a number of channels
+ * @param[in] channels values per record
+ * @return narrowest sensor with at least that many columns, NULL if none
+ */
+static const struct sensor* synth_schema(uint8_t channels) {
+
+    const struct sensor* best = NULL;
+    const struct sensor* sensor;
+
+    for (int id = 0; id < SENSOR_COUNT; ++id) {
+        sensor = sensor_get(id);
+        if (sensor->driver->n_fields >= channels
+            && (!best || sensor->driver->n_fields < best->driver->n_fields))
+            best = sensor;
+    }
+    return best;
+}
+
+/**
+ * @brief set the generators up, they stay idle until a step adds their tasks
+ * @return error code
+ */
+static int synth_init(struct synth_state* state, const struct synth_config* config) {
+
+    const struct sensor* schema = synth_schema(config->channels);
+
+    if (!schema)
+        return ERROR_INVALID_BUFFER_SIZE;
+
+    for (uint8_t g = 0; g < config->generators; ++g) {
+        struct synth_generator* gen = &state->generators[g];
+
+        memset(gen, 0, sizeof(*gen));
+        gen->index = g;
+        snprintf(gen->name, sizeof(gen->name), "synth%u", g);
+        gen->driver = (struct sensor_driver){
+            .name = gen->name,
+            .fields = schema->driver->fields,
+            .n_fields = config->channels,
+            .collect = synth_collect,
+            .decode = synth_decode,
+        };
+        // no bus, no mux: trigger and select have nothing to do; the id
+        // only selects the schema, rows are labelled with the driver name
+        gen->sensor = (struct sensor){
+            .id = schema->id,
+            .driver = &gen->driver,
+            .ctx = gen,
+            .active = 1,
+        };
+        gen->records = config->records;
+        gen->task = (struct scheduler_sensor){
+            .sensor = &gen->sensor,
+            .sink = writer_sink,
+            .sink_arg = &state->ring,
+        };
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief run one load step
+ * @param[inout] state pipeline, the writer running
+ * @param[in] config load
+ * @param[in] rate_hz rate of every generator [Hz]
+ * @param[out] step what the step did
+ * @return error code
+ */
+static int synth_step(struct synth_state* state, const struct synth_config* config,
+                      uint32_t rate_hz, struct synth_step* step) {
+
+    uint32_t period_us = rate_hz < 1000000 ? 1000000 / rate_hz : 1;
+    uint32_t drops = atomic_load(&state->ring.drops);
+    uint64_t written = atomic_load(&state->writer.written);
+    uint64_t runs = 0;
+    uint64_t start;
+    double seconds;
+    uint32_t level;
+    int ret;
+
+    memset(step, 0, sizeof(*step));
+    step->rate_hz = rate_hz;
+
+    scheduler_init(&state->sched);
+    for (uint8_t g = 0; g < config->generators; ++g) {
+        // spread over the period, not all at the same deadline
+        ret = scheduler_add_sensor(&state->sched, &state->generators[g].task, period_us,
+                                   period_us * g / config->generators);
+        if (ret != EXIT_SUCCESS) {
+            scheduler_close(&state->sched);
+            return ret;
+        }
+    }
+
+    start = timestamp_ns();
+    ret = scheduler_start(&state->sched, &config->rt);
+    if (ret != EXIT_SUCCESS) {
+        scheduler_close(&state->sched);
+        return ret;
+    }
+    while (timestamp_ns() - start < config->step_ms * 1000000ULL) {
+        usleep(SYNTH_SAMPLE_MS * 1000);
+        level = ring_level(&state->ring);
+        if (level > step->backlog)
+            step->backlog = level;
+    }
+    scheduler_stop(&state->sched);
+    scheduler_join(&state->sched);
+    seconds = (timestamp_ns() - start) / 1e9;
+
+    for (size_t t = 0; t < state->sched.n_tasks; ++t) {
+        const struct scheduler_task* task = &state->sched.tasks[t];
+        uint32_t latency = scheduler_latency(task, 999);
+
+        runs += task->runs;
+        step->misses += task->overruns;
+        if (latency > step->latency_us)
+            step->latency_us = latency;
+    }
+    scheduler_close(&state->sched);
+
+    // what the writer still has belongs to this step
+    for (uint32_t waited = 0; ring_level(&state->ring) && waited < SYNTH_DRAIN_MS;
+         waited += SYNTH_SAMPLE_MS)
+        usleep(SYNTH_SAMPLE_MS * 1000);
+
+    // the tasks run at the whole microsecond period, not at rate_hz
+    step->offered = config->generators * config->records * 1e6 / period_us;
+    step->produced = runs * config->records / seconds;
+    step->written = (atomic_load(&state->writer.written) - written) / seconds;
+    step->drops = atomic_load(&state->ring.drops) - drops;
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief print where a sign of saturation first showed
+ */
+static void synth_report(const struct synth_result* result, int at, const char* what,
+                         FILE* stream) {
+
+    if (at < 0) {
+        fprintf(stream, "synth: no %s up to %.0f records/s\n", what,
+                result->steps[result->n_steps - 1].offered);
+        return;
+    }
+    fprintf(stream, "synth: first %s at %.0f records/s offered (%u Hz per generator), "
+            "%.0f records/s written\n", what, result->steps[at].offered,
+            result->steps[at].rate_hz, result->steps[at].written);
+}
+
+int synth_ramp(const struct synth_config* config, struct synth_result* result, FILE* stream) {
+
+    static struct synth_state state;
+    static struct synth_result local;
+    struct ring* rings[] = { &state.ring };
+    struct synth_step* step;
+    uint32_t rate_hz;
+    int ret;
+
+    if (!config->generators || config->generators > SYNTH_MAX_GENERATORS
+        || !config->channels || config->channels > SAMPLE_MAX_CHANNELS
+        || !config->records || config->records > SAMPLE_MAX_RECORDS
+        || config->records * config->channels > SENSOR_MAX_VALUES
+        || config->records * config->channels * sizeof(int32_t) > SENSOR_RAW_SIZE
+        || !config->rate_hz) {
+        print_error(ERROR_INVALID_BUFFER_SIZE, "synthetic load out of range");
+        return ERROR_INVALID_BUFFER_SIZE;
+    }
+    if (!result)
+        result = &local;
+    memset(result, 0, sizeof(*result));
+    result->drops_at = result->misses_at = result->backlog_at = -1;
+
+    ret = synth_init(&state, config);
+    if (ret != EXIT_SUCCESS)
+        return ret;
+    ret = ring_init(&state.ring, config->ring_depth, sizeof(struct writer_entry));
+    if (ret != EXIT_SUCCESS)
+        return ret;
+    ret = writer_start(&state.writer, config->pattern, rings, ARRAY_SIZE(rings));
+    if (ret != EXIT_SUCCESS) {
+        ring_free(&state.ring);
+        return ret;
+    }
+
+    if (stream)
+        fprintf(stream, "synth: %u generators, %u channels, %u records per collect\n"
+                "%10s %12s %12s %12s %8s %8s %8s %10s\n", config->generators,
+                config->channels, config->records, "Hz", "offered/s", "produced/s",
+                "written/s", "drops", "misses", "backlog", "p99.9 us");
+
+    for (rate_hz = config->rate_hz;
+         rate_hz <= config->max_rate_hz && result->n_steps < SYNTH_MAX_STEPS;
+         rate_hz = rate_hz + (rate_hz * config->step_percent / 100 ?: 1)) {
+        step = &result->steps[result->n_steps];
+        ret = synth_step(&state, config, rate_hz, step);
+        if (ret != EXIT_SUCCESS)
+            break;
+
+        if (result->drops_at < 0 && step->drops)
+            result->drops_at = result->n_steps;
+        if (result->misses_at < 0 && step->misses)
+            result->misses_at = result->n_steps;
+        if (result->backlog_at < 0 && step->backlog > config->ring_depth / SYNTH_BACKLOG_SHARE)
+            result->backlog_at = result->n_steps;
+        result->n_steps++;
+
+        if (stream) {
+            fprintf(stream, "%10u %12.0f %12.0f %12.0f %8u %8llu %8u %10u\n", step->rate_hz,
+                    step->offered, step->produced, step->written, step->drops,
+                    (unsigned long long)step->misses, step->backlog, step->latency_us);
+            fflush(stream);
+        }
+
+        if (result->drops_at >= 0
+            && ((result->misses_at >= 0 && result->backlog_at >= 0)
+                || result->n_steps > (size_t)result->drops_at + SYNTH_STEPS_AFTER_DROPS))
+            break;
+    }
+
+    writer_stop(&state.writer);
+    ring_free(&state.ring);
+
+    if (stream && result->n_steps) {
+        synth_report(result, result->drops_at, "drops", stream);
+        synth_report(result, result->misses_at, "deadline misses", stream);
+        synth_report(result, result->backlog_at, "writer backlog", stream);
+    }
+
+    return ret;
+}
+
+// vim: expandtab ts=4 sw=4
@@ -0,0 +1,36 @@
+/**
+ * @file    timestamp.c
+ * @author  Jie Liu
+ * @version V1.0
+ * @date    2026-10-18
+ * @brief Monotonic time stamps and the anchors that map them to wall-clock time
+ */
+
+#include <stdint.h>
+#include <time.h>
+
+#include "timestamp.h"
+
+void timestamp_anchor(struct timestamp_anchor* anchor) {
+
+    struct timespec real;
+    uint64_t before;
+    uint64_t after;
+    int i;
+
+    anchor->uncertainty_ns = UINT32_MAX;
+    for (i = 0; i < TIMESTAMP_ANCHOR_TRIES; ++i) {
+        before = timestamp_ns();
+        clock_gettime(CLOCK_REALTIME, &real);
+        after = timestamp_ns();
+
+        // a preemption in between shows as a wide bracket
+        if (after - before >= anchor->uncertainty_ns)
+            continue;
+        anchor->monotonic_ns = before + (after - before) / 2;
+        anchor->realtime_ns = (uint64_t)real.tv_sec * 1000000000 + real.tv_nsec;
+        anchor->uncertainty_ns = after - before;
+    }
+}
+
+// vim: expandtab ts=4 sw=4
@@ -0,0 +1,322 @@
+/**
+ * @file    topology.c
+ * @author  Jie Liu
+ * @version V1.0
+ * @date    2026-10-18
+ * @brief Discovery of the sensors on the bus and behind the PI4 mux
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "topology.h"
+#include "sensor.h"
+#include "common.h"
+#include "error.h"
+#include "pi4.h"
+#include "apds.h"
+#include "bme.h"
+#include "lis2.h"
+#include "mlx.h"
+
+/** channels of the PI4MSD5V9548A */
+#define TOPOLOGY_MUX_CHANNELS 8
+
+/**
+ * @struct topology_probe
+ * @brief how a kind of device is recognized
+ * @var name short name, the driver's for registry sensors
+ * @var sensor registry sensor, SENSOR_COUNT if none
+ * @var addr possible slave addresses, 0 if unused
+ * @var reg identification register
+ * @var wide 16-bit register address and value
+ * @var mask bits of the register that identify the device, 0 if any answer does
+ * @var value identification, after mask
+ */
+struct topology_probe {
+    const char* name;
+    enum sensor_id sensor;
+    uint8_t addr[2];
+    uint16_t reg;
+    uint8_t wide;
+    uint16_t mask;
+    uint16_t value;
+};
+
+static const struct topology_probe topology_probes[] = {
+    { "apds", SENSOR_APDS, { APDS_ADD, 0 }, APDS_PART_ID, 0, APDS_PART_ID_MASK, APDS_PART_ID_DEF },
+    { "bme", SENSOR_BME, { BME_ADD, BME2_ADD }, BME68X_REG_CHIP_ID, 0, 0xFF, BME68X_CHIP_ID },
+    // SA0 high, then low
+    { "lis2", SENSOR_LIS2, { LIS2_ADD, LIS2_ADD - 1 }, LIS2_WHO_AM_I_ADD, 0, 0xFF,
+      LIS2_WHO_AM_I_DEF },
+    // the chip ID is unique per sensor, any 16-bit answer is taken; ADDR low, then high
+    { "mlx", SENSOR_MLX, { MLX_ADD, MLX_ADD + 1 }, MLX_EE_ID0, 1, 0, 0 },
+};
+
+/**
+ * @brief look a kind of device up by name
+ * @param[in] name short name
+ * @return probe, NULL if unknown
+ */
+static const struct topology_probe* topology_probe_get(const char* name) {
+
+    size_t i;
+
+    for (i = 0; i < ARRAY_SIZE(topology_probes); ++i) {
+        if (strcmp(topology_probes[i].name, name) == 0)
+            return &topology_probes[i];
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief one quick read of the identification register
+ * @param[in] probe kind of device
+ * @param[in] bus bus device file
+ * @param[in] addr slave address
+ * @return non-zero if the device answered and is of that kind
+ */
+static int topology_identify(const struct topology_probe* probe, int bus, uint8_t addr) {
+
+    i2c_slave slave = { bus, addr };
+    uint16_t value;
+
+    if (i2c_probe(&slave, probe->reg, probe->wide, &value))
+        return 0;
+
+    return (value & probe->mask) == probe->value;
+}
+
+/**
+ * @brief check whether an address was found already
+ * @param[in] topology devices
+ * @param[in] addr slave address
+ * @param[in] mux PI4 channel bit
+ * @return non-zero if found
+ */
+static int topology_has(const struct topology* topology, uint8_t addr, uint8_t mux) {
+
+    size_t i;
+
+    for (i = 0; i < topology->n_devices; ++i) {
+        if (topology->devices[i].addr == addr && topology->devices[i].mux == mux)
+            return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief probe every known address with the current channel setting
+ * @param[inout] topology devices found so far
+ * @param[in] bus bus device file
+ * @param[in] mux PI4 channel bit enabled, 0 if none
+ */
+static void topology_probe_all(struct topology* topology, int bus, uint8_t mux) {
+
+    const struct topology_probe* probe;
+    struct topology_device* device;
+    size_t i;
+    size_t a;
+
+    for (i = 0; i < ARRAY_SIZE(topology_probes); ++i) {
+        probe = &topology_probes[i];
+        for (a = 0; a < ARRAY_SIZE(probe->addr) && probe->addr[a]; ++a) {
+            // devices on the bus itself answer on every channel too
+            if (topology_has(topology, probe->addr[a], 0))
+                continue;
+            if (topology->n_devices >= TOPOLOGY_MAX_DEVICES)
+                return;
+            if (!topology_identify(probe, bus, probe->addr[a]))
+                continue;
+
+            device = &topology->devices[topology->n_devices++];
+            device->name = probe->name;
+            device->sensor = probe->sensor;
+            device->addr = probe->addr[a];
+            device->mux = mux;
+        }
+    }
+}
+
+int topology_scan(struct topology* topology, int bus) {
+
+    uint8_t saved = 0;
+    uint8_t mask = 0;
+    int mux;
+    int c;
+
+    topology->n_devices = 0;
+
+    // without an answering mux there is only the bus itself
+    mux = pi4_get_channel(&bus, &saved) == EXIT_SUCCESS;
+    if (mux && pi4_set_channel(&bus, &mask) != EXIT_SUCCESS)
+        return ERROR_WRITE_REGISTER_FAILS;
+    topology_probe_all(topology, bus, 0);
+
+    for (c = 0; mux && c < TOPOLOGY_MUX_CHANNELS; ++c) {
+        mask = 1 << c;
+        if (pi4_set_channel(&bus, &mask) != EXIT_SUCCESS)
+            return ERROR_WRITE_REGISTER_FAILS;
+        topology_probe_all(topology, bus, mask);
+    }
+
+    if (mux)
+        pi4_set_channel(&bus, &saved);
+
+    return topology->n_devices ? EXIT_SUCCESS : ERROR_NOTHING_TO_READ;
+}
+
+int topology_verify(const struct topology* topology, int bus) {
+
+    const struct topology_device* device;
+    const struct topology_probe* probe;
+    uint8_t saved = 0;
+    uint8_t mask;
+    int mux;
+    int ret = EXIT_SUCCESS;
+    size_t i;
+
+    mux = pi4_get_channel(&bus, &saved) == EXIT_SUCCESS;
+    for (i = 0; i < topology->n_devices && ret == EXIT_SUCCESS; ++i) {
+        device = &topology->devices[i];
+        probe = topology_probe_get(device->name);
+        mask = device->mux;
+        if (device->mux && !mux)
+            ret = ERROR_NOTHING_TO_READ; // the mux is gone
+        else if (mux && pi4_set_channel(&bus, &mask) != EXIT_SUCCESS)
+            ret = ERROR_WRITE_REGISTER_FAILS;
+        else if (!probe || !topology_identify(probe, bus, device->addr))
+            ret = ERROR_NOTHING_TO_READ;
+    }
+
+    if (mux)
+        pi4_set_channel(&bus, &saved);
+
+    return ret;
+}
+
+int topology_load(struct topology* topology, const char* path) {
+
+    const struct topology_probe* probe;
+    struct topology_device* device;
+    char line[64];
+    char name[16];
+    unsigned addr;
+    unsigned mux;
+    FILE* f;
+
+    topology->n_devices = 0;
+    if ((f = fopen(path, "r")) == NULL)
+        return ERROR_NOTHING_TO_READ;
+
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '#' || line[0] == '\n')
+            continue;
+        if (sscanf(line, "%15[^,],%x,%x", name, &addr, &mux) != 3
+            || (probe = topology_probe_get(name)) == NULL
+            || addr > 0x7F || mux > UINT8_MAX
+            || topology->n_devices >= TOPOLOGY_MAX_DEVICES) {
+            fclose(f);
+            topology->n_devices = 0;
+            return ERROR_PARSER;
+        }
+
+        device = &topology->devices[topology->n_devices++];
+        device->name = probe->name;
+        device->sensor = probe->sensor;
+        device->addr = addr;
+        device->mux = mux;
+    }
+    fclose(f);
+
+    return topology->n_devices ? EXIT_SUCCESS : ERROR_NOTHING_TO_READ;
+}
+
+int topology_save(const struct topology* topology, const char* path) {
+
+    char tmp[128];
+    size_t i;
+    FILE* f;
+
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    if ((f = fopen(tmp, "w")) == NULL) {
+        print_errno("cannot write topology cache");
+        return errno;
+    }
+
+    fprintf(f, "# name,address,channel\n");
+    for (i = 0; i < topology->n_devices; ++i)
+        fprintf(f, "%s,0x%02x,0x%02x\n", topology->devices[i].name, topology->devices[i].addr,
+                topology->devices[i].mux);
+
+    if (fclose(f) || rename(tmp, path)) {
+        print_errno("cannot write topology cache");
+        remove(tmp);
+        return errno;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+int topology_discover(struct topology* topology, int bus, const char* path) {
+
+    int ret;
+
+    if (topology_load(topology, path) == EXIT_SUCCESS
+        && topology_verify(topology, bus) == EXIT_SUCCESS)
+        return EXIT_SUCCESS;
+
+    ret = topology_scan(topology, bus);
+    if (ret != EXIT_SUCCESS)
+        return ret;
+
+    // a cache that cannot be written only costs the next start a scan
+    topology_save(topology, path);
+
+    return EXIT_SUCCESS;
+}
+
+void topology_apply(const struct topology* topology) {
+
+    uint8_t applied[SENSOR_COUNT] = { 0 };
+    const struct topology_device* device;
+    struct sensor* sensor;
+    size_t i;
+
+    for (i = 0; i < topology->n_devices; ++i) {
+        device = &topology->devices[i];
+        sensor = sensor_get(device->sensor);
+        if (!sensor || applied[device->sensor])
+            continue;
+        sensor->slave.addr = device->addr;
+        sensor->mux = device->mux;
+        applied[device->sensor] = 1;
+    }
+}
+
+uint8_t topology_channels(const struct topology* topology) {
+
+    uint8_t mask = 0;
+    size_t i;
+
+    for (i = 0; i < topology->n_devices; ++i)
+        mask |= topology->devices[i].mux;
+
+    return mask;
+}
+
+void topology_print(const struct topology* topology, FILE* stream) {
+
+    size_t i;
+
+    fprintf(stream, "%-10s %8s %8s\n", "device", "address", "channel");
+    for (i = 0; i < topology->n_devices; ++i)
+        fprintf(stream, "%-10s %#8x %#8x\n", topology->devices[i].name,
+                topology->devices[i].addr, topology->devices[i].mux);
+}
+
+// vim: expandtab ts=4 sw=4
@@ -0,0 +1,201 @@
+/**
+ * @file    writer.c
+ * @author  Jie Liu
+ * @version V1.0
+ * @date    2026-10-18
+ * @brief Writer thread draining the acquisition rings into the output file
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "writer.h"
+#include "ring.h"
+#include "sensor.h"
+#include "common.h"
+#include "error.h"
+
+/**
+ * @brief write an anchor line mapping the monotonic stamps to wall-clock time
+ * @param[inout] writer writer state
+ */
+static void writer_anchor(struct writer* writer) {
+
+    struct timestamp_anchor anchor;
+
+    timestamp_anchor(&anchor);
+    fprintf(writer->file, "anchor,%llu,%llu,%u\n", (unsigned long long)anchor.monotonic_ns,
+            (unsigned long long)anchor.realtime_ns, anchor.uncertainty_ns);
+    writer->anchor_ns = anchor.monotonic_ns;
+}
+
+/**
+ * @brief close the current file and open the one of next_file
+ * @param[inout] writer writer state
+ * @return error code
+ */
+static int writer_open(struct writer* writer) {
+
+    char name[64];
+
+    if (writer->file)
+        fclose(writer->file);
+    writer->file = NULL;
+
+    writer->file_number = atomic_load(&writer->next_file);
+    snprintf(name, sizeof(name), writer->pattern, writer->file_number);
+    writer->file = fopen(name, "a");
+    if (!writer->file) {
+        print_errno("cannot open output file");
+        return errno;
+    }
+    setvbuf(writer->file, NULL, _IOFBF, WRITER_FILE_BUFFER);
+    writer_anchor(writer);
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief export one record, line: stamp_ns,sensor,values
+ * @param[inout] writer writer state
+ * @param[in] sensor sensor the record came from, names the row
+ * @param[in] record record
+ */
+static void writer_line(struct writer* writer, const struct sensor* sensor,
+                        const struct sample_record* record) {
+
+    char values[SENSOR_STRING_SIZE];
+
+    if (sample_format(record, values, sizeof(values)) != EXIT_SUCCESS) {
+        writer->errors++;
+        return;
+    }
+
+    fprintf(writer->file, "%llu,%s,%s\n", (unsigned long long)record->stamp_ns,
+            sensor->driver->name, values);
+    atomic_fetch_add_explicit(&writer->written, 1, memory_order_relaxed);
+}
+
+/**
+ * @brief decode one collect and export its records
+ * @param[inout] writer writer state
+ * @param[in] entry queued collect
+ */
+static void writer_entry(struct writer* writer, const struct writer_entry* entry) {
+
+    struct sample_record records[SAMPLE_MAX_RECORDS];
+    uint8_t n_records;
+
+    if (!writer->file
+        || sample_decode(entry->sensor, &entry->raw, records, &n_records) != EXIT_SUCCESS) {
+        writer->errors++;
+        return;
+    }
+
+    for (uint8_t i = 0; i < n_records; i++)
+        writer_line(writer, entry->sensor, &records[i]);
+}
+
+/**
+ * @brief drain every ring until stopped and empty
+ * @param[inout] arg struct writer
+ * @return NULL
+ */
+static void* writer_thread(void* arg) {
+
+    struct writer* writer = arg;
+    struct writer_entry batch[WRITER_BATCH];
+    uint32_t total;
+    uint32_t n;
+    size_t r;
+
+    for (;;) {
+        if (atomic_load(&writer->next_file) != writer->file_number)
+            writer_open(writer);
+
+        total = 0;
+        for (r = 0; r < writer->n_rings; ++r) {
+            n = ring_pop(writer->rings[r], batch, WRITER_BATCH);
+            total += n;
+            for (uint32_t i = 0; i < n; ++i)
+                writer_entry(writer, &batch[i]);
+        }
+
+        if (total) {
+            // one clock read per batch
+            if (writer->file && timestamp_ns() - writer->anchor_ns >= TIMESTAMP_ANCHOR_PERIOD_NS)
+                writer_anchor(writer);
+            if (writer->file && fflush(writer->file) == EOF)
+                print_warnno("output file flush failed");
+            continue;
+        }
+        if (!atomic_load(&writer->running))
+            break;
+        usleep(WRITER_IDLE_US);
+    }
+
+    return NULL;
+}
+
+int writer_start(struct writer* writer, const char* pattern, struct ring* rings[],
+        size_t n_rings) {
+
+    int ret;
+
+    if (n_rings > WRITER_MAX_RINGS)
+        return ERROR_MAX_BUFFER_SIZE_REACHED;
+
+    memset(writer, 0, sizeof(*writer));
+    memcpy(writer->rings, rings, n_rings * sizeof(rings[0]));
+    writer->n_rings = n_rings;
+    writer->pattern = pattern;
+    atomic_init(&writer->next_file, 0);
+    atomic_init(&writer->running, 1);
+    atomic_init(&writer->written, 0);
+
+    ret = writer_open(writer);
+    if (ret != EXIT_SUCCESS)
+        return ret;
+
+    ret = pthread_create(&writer->thread, NULL, writer_thread, writer);
+    if (ret != 0) {
+        print_error(ret, "cannot start writer thread");
+        fclose(writer->file);
+        writer->file = NULL;
+        return ret;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+void writer_next_file(struct writer* writer) {
+    atomic_fetch_add(&writer->next_file, 1);
+}
+
+void writer_stop(struct writer* writer) {
+
+    atomic_store(&writer->running, 0);
+    pthread_join(writer->thread, NULL);
+
+    if (writer->file)
+        fclose(writer->file);
+    writer->file = NULL;
+}
+
+int writer_push(struct ring* ring, const struct sensor* sensor, const struct sensor_raw* raw) {
+
+    struct writer_entry entry = { sensor, *raw };
+
+    // decoding is the writer thread's business
+
+    return ring_push(ring, &entry) == EXIT_SUCCESS ? EXIT_SUCCESS : ERROR_MAX_BUFFER_SIZE_REACHED;
+}
+
+void writer_sink(const struct sensor* sensor, const struct sensor_raw* raw, void* ring) {
+    writer_push(ring, sensor, raw);
+}
+
+// vim: expandtab ts=4 sw=4